@@ -0,0 +1,193 @@
+// AsyncFileWriter
+// shared asynchronous persistence backend for the publish connectors: Write() copies a
+// compact record and its timestamp into a lock-free SPSC ring, a background thread
+// formats the records and writes them to the file in large batches
+// one thread publishes to a writer (in main each connector is fed by one pipeline stage)
+// instead of a file the records can go to a sink called on the background thread
+// (the columnar store), which owns its output
+// Type R is the record type, it must be default constructible.
+
+#ifndef ASYNCFILEWRITER_HPP
+#define ASYNCFILEWRITER_HPP
+
+#include "SpscQueue.hpp"
+#include "TimestampFormatter.hpp"
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// when the written data is forced to disk
+enum FsyncPolicy
+{
+	FSYNC_NEVER, // left to the OS
+	FSYNC_ON_CLOSE, // once, when the writer is closed
+	FSYNC_EVERY_BATCH // after every batched write
+};
+
+template<typename R>
+class AsyncFileWriter
+{
+public:
+	// formats one record into the batch
+	typedef std::function<void(const R&, std::string&)> Formatter;
+
+	// consumes one record on the background thread
+	typedef std::function<void(const R&)> Sink;
+
+private:
+	std::FILE* file;
+	Formatter format;
+	Sink sink;
+	bool running;
+	FsyncPolicy policy;
+	std::size_t batchBytes; // the batch is written once it holds this many bytes (or the ring is empty)
+	SpscQueue<R> queue;
+	std::string batch;
+	std::thread worker;
+
+	// Write the batch to the file
+	void Flush();
+
+	// Force the file to disk
+	void Sync();
+
+	// Worker loop
+	void Run();
+
+public:
+	AsyncFileWriter(const std::string& path, const std::string& header, Formatter _format,
+		FsyncPolicy _policy = FSYNC_ON_CLOSE, std::size_t capacity = 1 << 16, std::size_t _batchBytes = 1 << 20); // ctor
+	AsyncFileWriter(Sink _sink, std::size_t capacity = 1 << 16); // ctor on a sink
+	~AsyncFileWriter(); // closes the writer
+
+	// Whether the file is open (or the sink set)
+	bool is_open() const;
+
+	// Queue a record, waits only while the ring is full
+	void Write(R record);
+
+	// Write every queued record, then close the file (the sink has seen every record once this returns)
+	void Close();
+};
+
+template<typename R>
+AsyncFileWriter<R>::AsyncFileWriter(const std::string& path, const std::string& header, Formatter _format,
+	FsyncPolicy _policy, std::size_t capacity, std::size_t _batchBytes) :
+	file(std::fopen(path.c_str(), "wb")), format(_format), running(false), policy(_policy), batchBytes(_batchBytes), queue(capacity)
+{
+	if (file == nullptr)
+	{
+		std::cout << "Cannot open the file!" << std::endl;
+		return;
+	}
+
+	// the batches are the buffering, the stream does not need its own
+	std::setvbuf(file, nullptr, _IONBF, 0);
+	batch.reserve(batchBytes + 4096);
+	batch += header;
+	batch += '\n';
+	running = true;
+	worker = std::thread(&AsyncFileWriter<R>::Run, this);
+}
+
+template<typename R>
+AsyncFileWriter<R>::AsyncFileWriter(Sink _sink, std::size_t capacity) :
+	file(nullptr), sink(_sink), running(true), policy(FSYNC_NEVER), batchBytes(0), queue(capacity)
+{
+	worker = std::thread(&AsyncFileWriter<R>::Run, this);
+}
+
+template<typename R>
+AsyncFileWriter<R>::~AsyncFileWriter()
+{
+	Close();
+}
+
+template<typename R>
+bool AsyncFileWriter<R>::is_open() const
+{
+	return running;
+}
+
+template<typename R>
+void AsyncFileWriter<R>::Write(R record)
+{
+	if (running)
+		queue.Push(std::move(record));
+}
+
+template<typename R>
+void AsyncFileWriter<R>::Flush()
+{
+	if (!batch.empty())
+	{
+		std::fwrite(batch.data(), 1, batch.size(), file);
+		batch.clear();
+		if (policy == FSYNC_EVERY_BATCH)
+			Sync();
+	}
+}
+
+template<typename R>
+void AsyncFileWriter<R>::Sync()
+{
+	std::fflush(file);
+#if defined(_WIN32)
+	_commit(_fileno(file));
+#else
+	fsync(fileno(file));
+#endif
+}
+
+template<typename R>
+void AsyncFileWriter<R>::Run()
+{
+	R record;
+	if (sink)
+	{
+		while (queue.Pop(record))
+			sink(record);
+		return;
+	}
+
+	while (queue.Pop(record))
+	{
+		// take everything that is queued, write when the batch is full or the ring runs dry
+		do
+		{
+			format(record, batch);
+			if (batch.size() >= batchBytes)
+				Flush();
+		} while (queue.TryPop(record));
+		Flush();
+	}
+	Flush();
+}
+
+template<typename R>
+void AsyncFileWriter<R>::Close()
+{
+	if (!running)
+		return;
+
+	queue.Close();
+	if (worker.joinable())
+		worker.join();
+	running = false;
+	if (file == nullptr)
+		return;
+	if (policy != FSYNC_NEVER)
+		Sync();
+	std::fclose(file);
+	file = nullptr;
+}
+
+#endif // !ASYNCFILEWRITER_HPP
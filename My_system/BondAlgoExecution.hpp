@@ -73,6 +73,11 @@ protected:
 public:
 	BondAlgoExecutionListener(BondAlgoExecutionService*); // ctor
 
+	// keep the const and rvalue overloads of ServiceListener visible
+	using ServiceListener<BondOrderBook>::ProcessAdd;
+	using ServiceListener<BondOrderBook>::ProcessRemove;
+	using ServiceListener<BondOrderBook>::ProcessUpdate;
+
 	// Listener callback to process an add event to the Service
 	virtual void ProcessAdd(BondOrderBook &);
 
@@ -81,6 +86,9 @@ public:
 
 	// Listener callback to process an update event to the Service
 	virtual void ProcessUpdate(BondOrderBook &);
+
+	// Listener callback to process an add event to the Service, on a read-only view of its data
+	virtual void ProcessAdd(const BondOrderBook &);
 };
 
 template <typename T>
@@ -95,7 +103,7 @@ const ExecutionOrder<T>& AlgoExecution<T>::GetOrder() const
 
 Bond_AgEx & BondAlgoExecutionService::GetData(string key)
 {
-	return id_AgEx_map[key];
+	return id_AgEx_map.at(key);
 }
 
 void BondAlgoExecutionService::OnMessage(Bond_AgEx &data)
@@ -115,18 +123,20 @@ const BondAlgoExecutionService::listener_container& BondAlgoExecutionService::Ge
 
 void BondAlgoExecutionService::AddOrder(const BondOrderBook& orderBook)
 {
-	auto product = orderBook.GetProduct();
+	const Bond& product = orderBook.GetProduct();
 	string productId = product.GetProductId();
 
 	// Get the best bid and offer in the order book
 	BidOffer bestBidOffer = orderBook.GetBestBidOffer();
 
-	double bestbid = bestBidOffer.GetOfferOrder().GetPrice();
-	double bestoffer = bestBidOffer.GetBidOrder().GetPrice();
+	double bestbid = bestBidOffer.GetBidOrder().GetPrice();
+	double bestoffer = bestBidOffer.GetOfferOrder().GetPrice();
 
-	// Generate an execution order only if the spread is tightest
+	// Generate an execution order only if the spread is tightest, compared exactly in ticks:
+	// the levels sit at mid -/+ a spread of at least 1/128, so the tightest top of book is 1/64 = 4 ticks
 	std::string orderId;
-	if (bestoffer - bestbid <= 1.0 / 128)
+	long spreadTicks = PriceTraits<double>::ToTicks(bestoffer) - PriceTraits<double>::ToTicks(bestbid);
+	if (spreadTicks <= 2 * TICKS_PER_POINT / 128)
 	{
 		// determine the attributes of the execution order
 
@@ -156,16 +166,14 @@ void BondAlgoExecutionService::AddOrder(const BondOrderBook& orderBook)
 		visibleQt = totalQt - hiddenQt;
 
 		// generate the execution order
-		Bond_ExOrder execution(product, side, orderId, type, bestoffer, visibleQt, hiddenQt, parentOrderId, isChild);
+		// at the price of the side it executes against
+		double price = (side == OFFER) ? bestoffer : bestbid;
+		Bond_ExOrder execution(orderBook.GetProductHandle(), side, orderId, type, price, visibleQt, hiddenQt, parentOrderId, isChild);
 
-		// Add an algo execution related to the execution order to the stored data
-		Bond_AgEx algoexecution(execution);
-		if (id_AgEx_map.find(productId) == id_AgEx_map.end()) // if not found this one then create one
-			id_AgEx_map.insert(std::make_pair(productId, algoexecution));
-		else
-			id_AgEx_map[productId] = algoexecution;
+		// Add an algo execution related to the execution order to the stored data (create or replace in one lookup)
+		const Bond_AgEx& algoexecution = id_AgEx_map.insert_or_assign(productId, Bond_AgEx(execution)).first->second;
 
-		// Call the listeners (update)
+		// Call the listeners (update) with a read-only view of the stored algo execution
 		for (auto private_l : listeners)
 			private_l->ProcessUpdate(algoexecution);
 
@@ -180,6 +188,11 @@ BondAlgoExecutionListener::BondAlgoExecutionListener(BondAlgoExecutionService* _
 }
 
 void BondAlgoExecutionListener::ProcessAdd(BondOrderBook &_bondOrderBook)
+{
+	ProcessAdd(static_cast<const BondOrderBook&>(_bondOrderBook));
+}
+
+void BondAlgoExecutionListener::ProcessAdd(const BondOrderBook &_bondOrderBook)
 {
 	bondAlgoExecutionService->AddOrder(_bondOrderBook);
 }
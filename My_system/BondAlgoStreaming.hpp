@@ -30,7 +30,7 @@ typedef AlgoStream<Bond> Bond_Ags;
 // Bond algo streaming service to determine the prices on both sides
 // key on the product identifier
 // value on an AlgoStream object
-class BondAlgoStreamingService : public Service<string, Bond_Ags>
+class BondAlgoStreamingService final : public Service<string, Bond_Ags>
 {
 	typedef ServiceListener<Bond_Ags> myListener;
 	typedef vector<myListener*> Listener_container;
@@ -65,7 +65,7 @@ public:
 
 // Bond algo-streaming service listener
 // register in the bond pricing service to process the price data to BondAlgoStreamingService
-class ToBondAlgoStreamingListener : public ServiceListener<BondPrice>
+class ToBondAlgoStreamingListener final : public ServiceListener<BondPrice>
 {
 protected:
 	BondAlgoStreamingService* bondAlgoStreamingService;
@@ -73,6 +73,11 @@ protected:
 public:
 	ToBondAlgoStreamingListener(BondAlgoStreamingService*);
 
+	// keep the const and rvalue overloads of ServiceListener visible
+	using ServiceListener<BondPrice>::ProcessAdd;
+	using ServiceListener<BondPrice>::ProcessRemove;
+	using ServiceListener<BondPrice>::ProcessUpdate;
+
 	// Listener callback to process an add event to the Service
 	virtual void ProcessAdd(BondPrice &);
 
@@ -81,6 +86,9 @@ public:
 
 	// Listener callback to process an update event to the Service
 	virtual void ProcessUpdate(BondPrice &);
+
+	// Listener callback to process an add event to the Service, on a read-only view of its data
+	virtual void ProcessAdd(const BondPrice &);
 };
 
 template <typename T>
@@ -94,7 +102,7 @@ const PriceStream<T>& AlgoStream<T>::GetStream() const
 
 Bond_Ags & BondAlgoStreamingService::GetData(string key)
 {
-	return algostream_Map[key];
+	return algostream_Map.at(key);
 }
 
 void BondAlgoStreamingService::OnMessage(Bond_Ags &data)
@@ -129,20 +137,15 @@ void BondAlgoStreamingService::AddStream(const BondPrice& _bondPrice)
 	PriceStreamOrder offerOrder(mid + gap, visibleQt, hiddenQt, OFFER);
 
 	// Generate a price stream
-	Bond_Ps stream(_bondPrice.GetProduct(), bidOrder, offerOrder);
-	Bond_Ags algostream(stream);
+	Bond_Ps stream(_bondPrice.GetProductHandle(), bidOrder, offerOrder);
 
-	// Add an algo stream related to the price stream to the stored data
-	string pd_id = _bondPrice.GetProduct().GetProductId();
-	
-	if (algostream_Map.find(pd_id) == algostream_Map.end()) // if not found this one then create one
-		algostream_Map.insert(std::make_pair(pd_id, algostream));
-	else
-		algostream_Map[pd_id] = algostream;
+	// Add an algo stream related to the price stream to the stored data (create or replace in one lookup)
+	const string& pd_id = _bondPrice.GetProduct().GetProductId();
+	const Bond_Ags& algostream = algostream_Map.insert_or_assign(pd_id, Bond_Ags(stream)).first->second;
 
 	counter++;
 
-	// Call the listeners (update)
+	// Call the listeners (update) with a read-only view of the stored algo stream
 	for (auto temp_l : listeners)
 		temp_l->ProcessUpdate(algostream);
 }
@@ -151,6 +154,11 @@ ToBondAlgoStreamingListener::ToBondAlgoStreamingListener(BondAlgoStreamingServic
 	bondAlgoStreamingService(_bondAlgoStreamingService){}
 
 void ToBondAlgoStreamingListener::ProcessAdd(BondPrice &_BondPrice)
+{
+	ProcessAdd(static_cast<const BondPrice&>(_BondPrice));
+}
+
+void ToBondAlgoStreamingListener::ProcessAdd(const BondPrice &_BondPrice)
 {
 	// Add a algo stream based on the data
 	bondAlgoStreamingService->AddStream(_BondPrice);
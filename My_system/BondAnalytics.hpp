@@ -0,0 +1,278 @@
+// BondAnalytics
+// yield, modified duration and pv01 of every bond of the universe from its coupon and
+// maturity date at the current mark (clean price per 100 face, semi-annual coupons,
+// street convention); the terms and results of each bond live in one row of contiguous
+// arrays, a batch of marks recomputes the whole universe in one pass over the arrays,
+// split across threads for large universes, and the new pv01s go to the risk service
+// listens to BondPricingService: a single price recomputes its own bond and stages its
+// pv01, a batch of prices recomputes the universe and applies the staged pv01s to the
+// risk at its end, so the risk follows the marks batch by batch
+
+#ifndef BONDANALYTICS_HPP
+#define BONDANALYTICS_HPP
+
+#include "soa.hpp"
+#include "products.hpp"
+#include "productservice.hpp"
+#include "pricingservice.hpp"
+#include "ProductStore.hpp"
+#include "PV01Engine.hpp" // AlignedDoubles
+#include "BondRisk.hpp"
+#include "boost/date_time/gregorian/gregorian.hpp" // date operation
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <thread>
+#include <unordered_map>
+
+// rows a thread takes at least in a universe pass, smaller universes run on the calling thread
+const std::size_t ANALYTICS_ROWS_PER_THREAD = 1024;
+
+// yield solve: stop when a Newton step moves the yield by less than this, or after so many steps
+const double ANALYTICS_YIELD_TOLERANCE = 1e-12;
+const int ANALYTICS_MAX_ITERATIONS = 20;
+
+// Get the dirty price per 100 face of a bond paying coupon / 2 (coupon in percent) twice a
+// year, with n coupons left and the next one in w of a period, at yield y
+inline double BondDirtyPrice(double coupon, double n, double w, double y)
+{
+	double half = 0.5 * y;
+	double lv = -std::log1p(half); // log of the discount factor of a period
+	double vw = std::exp(w * lv);
+	double vn = std::exp(n * lv);
+	double annuity = (std::abs(half) < 1e-12) ? n : (1.0 - vn) * (1.0 + half) / half; // sum of v^k, k = 0 .. n - 1
+	return vw * (0.5 * coupon * annuity + 100.0 * vn * (1.0 + half));
+}
+
+class BondAnalytics : public ServiceListener<BondPrice>
+{
+private:
+	boost::gregorian::date asOf; // settlement date the bonds are valued on
+	BondRiskService* bondRiskService = nullptr;
+	std::size_t threadCount;
+
+	// one row per bond
+	std::vector<ProductHandle<Bond>> products;
+	AlignedDoubles coupons; // percent
+	AlignedDoubles periods; // # of coupons left
+	AlignedDoubles fractions; // part of a period until the next coupon
+	AlignedDoubles prices; // clean mark
+	AlignedDoubles yields;
+	AlignedDoubles durations; // modified duration
+	AlignedDoubles pv01s; // per 100 face
+	ProductStore<Bond, std::size_t> rows; // slot on the interned product id, value: row of the bond
+
+	// Compute yield, duration and pv01 of rows [first, last) from their marks
+	void ComputeRows(std::size_t first, std::size_t last);
+
+	// Compute every row, on several threads for a large universe
+	void ComputeAll();
+
+	// Stage the pv01 of rows [first, last) in the risk service
+	void PublishRows(std::size_t first, std::size_t last);
+
+	// Set the mark of a bond, the row of the bond (-1 if it is not in the universe)
+	long Mark(const BondPrice &);
+
+public:
+	// ctor, the bonds of a ticker marked at par
+	BondAnalytics(BondProductService*, std::string, boost::gregorian::date, std::size_t _threadCount = std::thread::hardware_concurrency());
+
+	// Send the pv01s to a risk service on every recompute from now on, applied at the end of each batch
+	void SetRiskService(BondRiskService*);
+
+	// Get the pv01 of every bond, key: product identifier
+	std::unordered_map<string, double> GetPV01s() const;
+
+	// Get the yield, modified duration and pv01 of a bond, throws std::out_of_range for an unknown bond
+	double GetYield(const string &);
+	double GetModifiedDuration(const string &);
+	double GetPV01(const string &);
+
+	// keep the const and rvalue overloads of ServiceListener visible
+	using ServiceListener<BondPrice>::ProcessAdd;
+	using ServiceListener<BondPrice>::ProcessRemove;
+	using ServiceListener<BondPrice>::ProcessUpdate;
+
+	// Listener callback to process an add event to the Service, recomputes the bond
+	virtual void ProcessAdd(BondPrice &);
+
+	// Listener callback to process a remove event to the Service
+	virtual void ProcessRemove(BondPrice &);
+
+	// Listener callback to process an update event to the Service
+	virtual void ProcessUpdate(BondPrice &);
+
+	// Listener callback to process an add event to the Service, on a read-only view of its data
+	virtual void ProcessAdd(const BondPrice &);
+
+	// Listener callback to process a batch of add events, recomputes the universe once and
+	// applies the staged pv01s to the risk
+	virtual void ProcessBatch(BondPrice *, std::size_t);
+};
+
+BondAnalytics::BondAnalytics(BondProductService* bondProductService, std::string ticker, boost::gregorian::date _asOf, std::size_t _threadCount) :
+	asOf(_asOf), threadCount(_threadCount == 0 ? 1 : _threadCount)
+{
+	for (const Bond& bond : bondProductService->GetBonds(ticker))
+	{
+		ProductHandle<Bond> product = bondProductService->GetHandle(bond.GetProductId());
+		if (rows.Find(product) != nullptr)
+			continue;
+
+		// coupon schedule: back from the maturity in steps of 6 months to the first coupon after asOf
+		const boost::gregorian::date& maturity = bond.GetMaturityDate();
+		int k = 0;
+		while (maturity - boost::gregorian::months(6 * (k + 1)) > asOf)
+			k++;
+		boost::gregorian::date next = maturity - boost::gregorian::months(6 * k);
+		boost::gregorian::date previous = maturity - boost::gregorian::months(6 * (k + 1));
+		bool matured = !(maturity > asOf);
+
+		rows[product] = products.size();
+		products.push_back(product);
+		coupons.push_back(bond.GetCoupon());
+		periods.push_back(matured ? 0.0 : k + 1.0);
+		fractions.push_back(matured ? 0.0 : static_cast<double>((next - asOf).days()) / (next - previous).days());
+		prices.push_back(100.0);
+		yields.push_back(0.0);
+		durations.push_back(0.0);
+		pv01s.push_back(0.0);
+	}
+	ComputeAll();
+}
+
+void BondAnalytics::ComputeRows(std::size_t first, std::size_t last)
+{
+	const double h = 1e-5; // yield bump of the derivatives
+	for (std::size_t i = first; i < last; i++)
+	{
+		double c = coupons[i], n = periods[i], w = fractions[i];
+		if (n == 0.0)
+		{
+			yields[i] = durations[i] = pv01s[i] = 0.0;
+			continue;
+		}
+
+		// the mark is clean, solve the yield on the dirty price
+		double target = prices[i] + 0.5 * c * (1.0 - w);
+		double y = c / 100.0;
+		for (int iter = 0; iter < ANALYTICS_MAX_ITERATIONS; iter++)
+		{
+			double slope = (BondDirtyPrice(c, n, w, y + h) - BondDirtyPrice(c, n, w, y - h)) / (2.0 * h);
+			if (slope == 0.0 || !std::isfinite(slope))
+				break; // flat price curve, keep the last yield
+			double step = (BondDirtyPrice(c, n, w, y) - target) / slope;
+			y -= step;
+			if (std::abs(step) < ANALYTICS_YIELD_TOLERANCE)
+				break;
+		}
+
+		double dirty = BondDirtyPrice(c, n, w, y);
+		yields[i] = y;
+		durations[i] = -(BondDirtyPrice(c, n, w, y + h) - BondDirtyPrice(c, n, w, y - h)) / (2.0 * h) / dirty;
+		pv01s[i] = (BondDirtyPrice(c, n, w, y - 0.0001) - BondDirtyPrice(c, n, w, y + 0.0001)) / 2.0;
+	}
+}
+
+void BondAnalytics::ComputeAll()
+{
+	std::size_t n = products.size();
+	std::size_t workers = std::min(threadCount, n / ANALYTICS_ROWS_PER_THREAD);
+	if (workers <= 1)
+	{
+		ComputeRows(0, n);
+		return;
+	}
+
+	// the calling thread takes the last chunk
+	std::vector<std::thread> threads;
+	std::size_t chunk = (n + workers - 1) / workers;
+	for (std::size_t first = 0; first + chunk < n; first += chunk)
+		threads.emplace_back(&BondAnalytics::ComputeRows, this, first, first + chunk);
+	ComputeRows(threads.size() * chunk, n);
+	for (auto& thread : threads)
+		thread.join();
+}
+
+void BondAnalytics::PublishRows(std::size_t first, std::size_t last)
+{
+	if (bondRiskService != nullptr && first < last)
+		bondRiskService->UpdatePV01s(products.data() + first, pv01s.data() + first, last - first);
+}
+
+long BondAnalytics::Mark(const BondPrice &price)
+{
+	std::size_t* row = rows.Find(price.GetProductHandle());
+	if (row == nullptr)
+		return -1;
+	prices[*row] = price.GetMid();
+	return static_cast<long>(*row);
+}
+
+void BondAnalytics::SetRiskService(BondRiskService* _bondRiskService)
+{
+	bondRiskService = _bondRiskService;
+}
+
+std::unordered_map<string, double> BondAnalytics::GetPV01s() const
+{
+	std::unordered_map<string, double> result;
+	for (std::size_t i = 0; i < products.size(); i++)
+		result[products[i]->GetProductId()] = pv01s[i];
+	return result;
+}
+
+double BondAnalytics::GetYield(const string &productId)
+{
+	return yields[rows.At(productId)];
+}
+
+double BondAnalytics::GetModifiedDuration(const string &productId)
+{
+	return durations[rows.At(productId)];
+}
+
+double BondAnalytics::GetPV01(const string &productId)
+{
+	return pv01s[rows.At(productId)];
+}
+
+void BondAnalytics::ProcessAdd(BondPrice &price)
+{
+	ProcessAdd(static_cast<const BondPrice&>(price));
+}
+
+void BondAnalytics::ProcessAdd(const BondPrice &price)
+{
+	long row = Mark(price);
+	if (row < 0)
+		return;
+	ComputeRows(row, row + 1);
+	PublishRows(row, row + 1);
+}
+
+void BondAnalytics::ProcessRemove(BondPrice &)
+{
+	// not defined for this service
+}
+
+void BondAnalytics::ProcessUpdate(BondPrice &)
+{
+	// not defined for this service
+}
+
+void BondAnalytics::ProcessBatch(BondPrice *marks, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; i++)
+		Mark(marks[i]);
+	ComputeAll();
+	PublishRows(0, products.size());
+
+	// the end of the batch is where the risk takes the new marks
+	if (bondRiskService != nullptr)
+		bondRiskService->ApplyPendingPV01s();
+}
+
+#endif // !BONDANALYTICS_HPP
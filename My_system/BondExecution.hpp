@@ -5,6 +5,7 @@
 #include "BondAlgoExecution.hpp"
 #include "products.hpp"
 #include "soa.hpp"
+#include "ProductStore.hpp"
 #include <unordered_map>
 #include <random>
 
@@ -16,7 +17,7 @@ class BondExecutionService : public ExecutionService<Bond>
 
 protected:
 	listener_container listeners;
-	std::unordered_map<string, Bond_ExOrder> orderMap; // key on product identifier
+	ProductStore<Bond, Bond_ExOrder> orderMap; // slot on the interned product id
 
 public:
 	BondExecutionService() {} // empty ctor
@@ -49,6 +50,11 @@ protected:
 public:
 	BondExecutionListener(BondExecutionService*); // ctor
 
+	// keep the const and rvalue overloads of ServiceListener visible
+	using ServiceListener<Bond_AgEx>::ProcessAdd;
+	using ServiceListener<Bond_AgEx>::ProcessRemove;
+	using ServiceListener<Bond_AgEx>::ProcessUpdate;
+
 	// Listener callback to process an add event to the Service
 	virtual void ProcessAdd(Bond_AgEx &);
 
@@ -57,12 +63,15 @@ public:
 
 	// Listener callback to process an update event to the Service
 	virtual void ProcessUpdate(Bond_AgEx &);
+
+	// Listener callback to process an update event to the Service, on a read-only view of its data
+	virtual void ProcessUpdate(const Bond_AgEx &);
 };
 
 
 Bond_ExOrder & BondExecutionService::GetData(string key)
 {
-	return orderMap[key];
+	return orderMap.At(key);
 }
 
 void BondExecutionService::OnMessage(Bond_ExOrder &data)
@@ -83,16 +92,11 @@ const BondExecutionService::listener_container& BondExecutionService::GetListene
 void BondExecutionService::ExecuteOrder(const Bond_ExOrder& order, Market market)
 {
 	// execute the order (push data to the map)
-	string pd_id = order.GetProduct().GetProductId();
-	if (orderMap.find(pd_id) == orderMap.end()) // if not found this one then create one
-		orderMap.insert(std::make_pair(pd_id, order));
-	else
-		orderMap[pd_id] = order;
-
-	// call the listeners
-	Bond_ExOrder temp(order);
+	orderMap.Set(order.GetProductHandle(), order);
+
+	// call the listeners, they get a read-only view of the order
 	for (auto private_l : listeners)
-		private_l->ProcessAdd(temp);
+		private_l->ProcessAdd(order);
 }
 
 BondExecutionListener::BondExecutionListener(BondExecutionService* _bondExecutionService) :
@@ -109,13 +113,18 @@ void BondExecutionListener::ProcessRemove(Bond_AgEx &data)
 }
 
 void BondExecutionListener::ProcessUpdate(Bond_AgEx &data)
+{
+	ProcessUpdate(static_cast<const Bond_AgEx&>(data));
+}
+
+void BondExecutionListener::ProcessUpdate(const Bond_AgEx &data)
 {
 	// decide the exchange
 	int val = rand() % 3;
 	Market exg(markets[val]);
 
 	// call the order execution
-	Bond_ExOrder order = data.GetOrder();
+	const Bond_ExOrder& order = data.GetOrder();
 	bondExecutionService->ExecuteOrder(order, exg);
 
 }
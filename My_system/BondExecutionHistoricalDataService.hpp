@@ -5,9 +5,14 @@
 #include "BondExecution.hpp"
 #include "products.hpp"
 #include "soa.hpp"
+#include "AsyncFileWriter.hpp"
+#include "HistoryStore.hpp"
+#include "ColumnarStore.hpp"
+#include "PriceCodec.hpp"
 #include "boost/date_time/posix_time/posix_time.hpp"
 #include "boost/date_time/gregorian/gregorian.hpp"
 #include <unordered_map>
+#include <memory>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -22,9 +27,10 @@ protected:
 	listener_container listeners;
 	Connector<Bond_ExOrder>* bondExecutionHistoricalDataConnector;
 	std::unordered_map<string, Bond_ExOrder> orderMap; // key on product indentifier
+	HistoryStore<Bond_ExOrder> history; // every persisted order by time, key on product indentifier
 
 public:
-	BondExecutionHistoricalDataService(Connector<Bond_ExOrder>*);
+	BondExecutionHistoricalDataService(Connector<Bond_ExOrder>*, std::size_t historyLimit = HISTORY_LIMIT); // keeps about historyLimit orders per product (0 keeps all)
 
 	// Get data on our service given a key
 	virtual Bond_ExOrder & GetData(string);
@@ -41,21 +47,52 @@ public:
 
 	// Persist data to a store
 	virtual void PersistData(string, const Bond_ExOrder&);
+
+	// Get the values persisted for a product with from <= time <= to, oldest first
+	std::vector<TimedValue<Bond_ExOrder>> GetHistory(const string&, RecordTime from, RecordTime to) const;
+
+	// Get the last n values persisted for a product, oldest first
+	std::vector<TimedValue<Bond_ExOrder>> GetLastUpdates(const string&, std::size_t n) const;
 };
 
 // corresponding publish connector
+// execution record queued for the writer
+struct ExecutionRecord
+{
+	RecordTime time;
+	ProductHandle<Bond> product;
+	OrderType orderType;
+	PricingSide side;
+	double price;
+	long visibleQuantity;
+	long hiddenQuantity;
+	bool isChildOrder;
+	std::string orderId;
+	std::string parentOrderId;
+};
+
 class BondExecutionHistoricalDataConnector : public Connector<Bond_ExOrder>
 {
 protected:
-	fstream file;
 	unordered_map<OrderType, string>OrderTypes{ {OrderType::FOK,"FOK"},{OrderType::IOC,"LOC"},{OrderType::LIMIT,"LIMIT"},{OrderType::MARKET,"MARKET"},{OrderType::STOP,"STOP"} };
+	std::unique_ptr<ColumnarWriter> columnar; // columnar output, before the writer that feeds it
+	std::unique_ptr<AsyncFileWriter<ExecutionRecord>> writer; // its thread formats with OrderTypes
+
+	// Format a record into a line of the output file
+	void Format(const ExecutionRecord&, std::string&);
+
+	// Append a record as a row of the columnar output
+	void Append(const ExecutionRecord&, ColumnarWriter&);
 
 public:
-	BondExecutionHistoricalDataConnector(string);
+	BondExecutionHistoricalDataConnector(string, HistoricalFormat = TEXT_FORMAT);
 
 	// Publish data to the Connector
 	virtual void Publish(Bond_ExOrder &);
 
+	// Publish data the service keeps resident to the Connector (only read)
+	virtual void Publish(const Bond_ExOrder &);
+
 };
 
 // corresponding service listener
@@ -67,6 +104,11 @@ protected:
 public:
 	BondExecutionHistoricalDataListener(BondExecutionHistoricalDataService*); // ctor
 
+	// keep the const and rvalue overloads of ServiceListener visible
+	using ServiceListener<Bond_ExOrder>::ProcessAdd;
+	using ServiceListener<Bond_ExOrder>::ProcessRemove;
+	using ServiceListener<Bond_ExOrder>::ProcessUpdate;
+
 	// Listener callback to process an add event to the Service
 	virtual void ProcessAdd(Bond_ExOrder &);
 
@@ -75,15 +117,18 @@ public:
 
 	// Listener callback to process an update event to the Service
 	virtual void ProcessUpdate(Bond_ExOrder &);
+
+	// Listener callback to process an add event to the Service, on a read-only view of its data
+	virtual void ProcessAdd(const Bond_ExOrder &);
 };
 
 BondExecutionHistoricalDataService::BondExecutionHistoricalDataService(
-	Connector<Bond_ExOrder>* _bondExecutionHistoricalDataConnector) :
-	bondExecutionHistoricalDataConnector(_bondExecutionHistoricalDataConnector){}
+	Connector<Bond_ExOrder>* _bondExecutionHistoricalDataConnector, std::size_t historyLimit) :
+	bondExecutionHistoricalDataConnector(_bondExecutionHistoricalDataConnector), history(historyLimit){}
 
 Bond_ExOrder & BondExecutionHistoricalDataService::GetData(string key)
 {
-	return orderMap[key];
+	return orderMap.at(key);
 }
 
 void BondExecutionHistoricalDataService::OnMessage(Bond_ExOrder &data)
@@ -107,49 +152,62 @@ void BondExecutionHistoricalDataService::PersistData(string key, const Bond_ExOr
 	if (orderMap.find(key) == orderMap.end()) // if not found this one then create one
 		orderMap.insert(std::make_pair(key, _bond_ExOrder));
 	else
-		orderMap[key] = _bond_ExOrder;
+		orderMap.at(key) = _bond_ExOrder;
+	history.Append(key, RecordNow(), _bond_ExOrder);
 
 	// publish the data
-	Bond_ExOrder temp(_bond_ExOrder);
-	bondExecutionHistoricalDataConnector->Publish(temp);
+	bondExecutionHistoricalDataConnector->Publish(_bond_ExOrder); // read-only view of the resident data
+
+}
 
+std::vector<TimedValue<Bond_ExOrder>> BondExecutionHistoricalDataService::GetHistory(const string& key, RecordTime from, RecordTime to) const
+{
+	return history.GetRange(key, from, to);
 }
 
-BondExecutionHistoricalDataConnector::BondExecutionHistoricalDataConnector(string _path):
-	file(_path, std::ios::out | std::ios::trunc)
+std::vector<TimedValue<Bond_ExOrder>> BondExecutionHistoricalDataService::GetLastUpdates(const string& key, std::size_t n) const
 {
-	// set the header of the output file
-	file << "Time,OrderType,OrderID,BondIDType,BondID,Side,VisibleQuantity,HiddenQuantity,Price,IsChildOrder,ParentOrderId"<<endl;;
+	return history.GetLast(key, n);
+}
+
+BondExecutionHistoricalDataConnector::BondExecutionHistoricalDataConnector(string _path, HistoricalFormat _format)
+{
+	if (_format == COLUMNAR_FORMAT)
+	{
+		columnar.reset(new ColumnarWriter(_path, { {"Time",COLUMN_TIME},{"OrderType",COLUMN_STRING},{"OrderID",COLUMN_STRING},
+			{"BondIDType",COLUMN_STRING},{"BondID",COLUMN_STRING},{"Side",COLUMN_STRING},{"VisibleQuantity",COLUMN_LONG},
+			{"HiddenQuantity",COLUMN_LONG},{"Price",COLUMN_PRICE},{"IsChildOrder",COLUMN_STRING},{"ParentOrderId",COLUMN_STRING} }, 0, 4));
+		writer.reset(new AsyncFileWriter<ExecutionRecord>([this](const ExecutionRecord& record) { Append(record, *columnar); }));
+	}
+	else
+		writer.reset(new AsyncFileWriter<ExecutionRecord>(
+			_path, "Time,OrderType,OrderID,BondIDType,BondID,Side,VisibleQuantity,HiddenQuantity,Price,IsChildOrder,ParentOrderId",
+			[this](const ExecutionRecord& record, std::string& out) { Format(record, out); }));
 }
 
 void BondExecutionHistoricalDataConnector::Publish(Bond_ExOrder &_bond_ExOrder)
+{
+	Publish(static_cast<const Bond_ExOrder&>(_bond_ExOrder));
+}
+
+void BondExecutionHistoricalDataConnector::Publish(const Bond_ExOrder &_bond_ExOrder)
 {
 	
-	if (file.is_open())
+	if (writer->is_open())
 	{
-		// build output
-		auto time = boost::posix_time::microsec_clock::local_time(); // current time
-		std::string date = DatetoStr(time.date());
-		std::string _time = boost::posix_time::to_simple_string(time.time_of_day());
-		_time.erase(_time.end() - 3, _time.end());
-
-		OrderType type = _bond_ExOrder.GetOrderType(); // 
-		std::string typeStr = OrderTypes[type];
-		// get the product
-		Bond bond = _bond_ExOrder.GetProduct(); 
-		// get the bond id type
-		std::string Idtype = (bond.GetBondIdType() == CUSIP) ? "CUSIP" : "ISIN"; 
-		std::string side = (_bond_ExOrder.GetSide() == BID) ? "BID" : "OFFER";
-		// get price
-		std::string price = PricetoStr(_bond_ExOrder.GetPrice()); 
-		std::string isChild = (_bond_ExOrder.IsChildOrder() == true) ? "TRUE" : "FALSE";
-
-		// make the output
-		file << date << " " << _time << "," << typeStr << "," << _bond_ExOrder.GetOrderId() << "," 
-			<< Idtype << "," << bond.GetProductId() << ","
-			<< side << "," << std::to_string(_bond_ExOrder.GetVisibleQuantity()) << ","
-			<< std::to_string(_bond_ExOrder.GetHiddenQuantity()) << "," << price << ","
-			<< isChild << "," << _bond_ExOrder.GetParentOrderId() << ""<<endl;;
+		// queue the record, the writer thread formats it
+		ExecutionRecord record;
+		record.time = RecordNow();
+		record.product = _bond_ExOrder.GetProductHandle();
+		record.orderType = _bond_ExOrder.GetOrderType();
+		record.side = _bond_ExOrder.GetSide();
+		record.price = _bond_ExOrder.GetPrice();
+		record.visibleQuantity = _bond_ExOrder.GetVisibleQuantity();
+		record.hiddenQuantity = _bond_ExOrder.GetHiddenQuantity();
+		record.isChildOrder = _bond_ExOrder.IsChildOrder();
+		record.orderId = _bond_ExOrder.GetOrderId();
+		record.parentOrderId = _bond_ExOrder.GetParentOrderId();
+		writer->Write(std::move(record));
 	}
 	else
 	{
@@ -157,11 +215,64 @@ void BondExecutionHistoricalDataConnector::Publish(Bond_ExOrder &_bond_ExOrder)
 	}
 }
 
+void BondExecutionHistoricalDataConnector::Format(const ExecutionRecord &record, std::string &out)
+{
+	const Bond& bond = *record.product; // get the product
+	char priceBuf[PRICE_BUFFER_SIZE];
+
+	// make the output
+	AppendTimestamp(out, record.time);
+	out += ',';
+	out += OrderTypes[record.orderType];
+	out += ',';
+	out += record.orderId;
+	out += ',';
+	out += (bond.GetBondIdType() == CUSIP) ? "CUSIP" : "ISIN"; // get the bond id type
+	out += ',';
+	out += bond.GetProductId();
+	out += ',';
+	out += (record.side == BID) ? "BID" : "OFFER";
+	out += ',';
+	out += std::to_string(record.visibleQuantity);
+	out += ',';
+	out += std::to_string(record.hiddenQuantity);
+	out += ',';
+	out.append(priceBuf, FormatPrice(record.price, priceBuf));
+	out += ',';
+	out += record.isChildOrder ? "TRUE" : "FALSE";
+	out += ',';
+	out += record.parentOrderId;
+	out += '\n';
+}
+
+void BondExecutionHistoricalDataConnector::Append(const ExecutionRecord &record, ColumnarWriter &out)
+{
+	const Bond& bond = *record.product; // get the product
+
+	out.SetTime(0, record.time);
+	out.SetString(1, OrderTypes[record.orderType]);
+	out.SetString(2, record.orderId);
+	out.SetString(3, (bond.GetBondIdType() == CUSIP) ? "CUSIP" : "ISIN");
+	out.SetString(4, bond.GetProductId());
+	out.SetString(5, (record.side == BID) ? "BID" : "OFFER");
+	out.SetLong(6, record.visibleQuantity);
+	out.SetLong(7, record.hiddenQuantity);
+	out.SetPrice(8, record.price);
+	out.SetString(9, record.isChildOrder ? "TRUE" : "FALSE");
+	out.SetString(10, record.parentOrderId);
+	out.EndRow();
+}
+
 BondExecutionHistoricalDataListener::BondExecutionHistoricalDataListener(
 	BondExecutionHistoricalDataService* _bondExecutionHistoricalDataService):
 	bondExecutionHistoricalDataService(_bondExecutionHistoricalDataService){}
 
 void BondExecutionHistoricalDataListener::ProcessAdd(Bond_ExOrder &_bond_ExOrder)
+{
+	ProcessAdd(static_cast<const Bond_ExOrder&>(_bond_ExOrder));
+}
+
+void BondExecutionHistoricalDataListener::ProcessAdd(const Bond_ExOrder &_bond_ExOrder)
 {
 	string key = _bond_ExOrder.GetProduct().GetProductId();
 	bondExecutionHistoricalDataService->PersistData(key, _bond_ExOrder);
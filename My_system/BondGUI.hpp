@@ -1,6 +1,8 @@
 // bond GUI service for modeling GUI, 
 // bond GUI connector for publishing data, and
 // bond GUI service listener for data inflow from bond pricing service
+// the GUI conflates: the listener stores the latest price of each product in a slot,
+// a timer thread of the service publishes the slots updated since the last tick
 
 #ifndef BONDGUI_HPP
 #define BONDGUI_HPP
@@ -8,11 +10,19 @@
 #include "pricingservice.hpp"
 #include "GUIService.hpp"
 #include "products.hpp"
+#include "productservice.hpp"
 #include "soa.hpp"
+#include "PriceCodec.hpp"
+#include "AsyncFileWriter.hpp"
+#include "ColumnarStore.hpp"
 #include "boost/date_time/posix_time/posix_time.hpp"
 #include "boost/date_time/gregorian/gregorian.hpp"
 #include <vector>
 #include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include <chrono> // model the throttles
 #include <fstream>
 #include <sstream>
@@ -28,6 +38,16 @@ class BondGUIService : public GUIService<Bond>
 	typedef std::vector<myListener*> Listener_container;
 	typedef Connector<BondPrice> myConnector;
 
+	// latest price of an interned product, a seqlock between the listener and the timer thread
+	struct PriceSlot
+	{
+		std::atomic<unsigned> sequence{ 0 }; // odd while the price is written
+		std::atomic<const Bond*> product{ nullptr };
+		std::atomic<double> mid{ 0.0 };
+		std::atomic<double> spread{ 0.0 };
+		std::atomic<bool> dirty{ false }; // updated since the last tick
+	};
+
 protected:
 	Listener_container listeners;
 	myConnector* bondGuiConnector; // publish connector
@@ -35,9 +55,36 @@ protected:
 
 	// throttles modeling
 	timeUnite interval;
+	std::vector<PriceSlot> slots; // index on product handle id
+	std::unordered_map<string, BondPrice> pending; // latest price of the products that are not interned
+	std::mutex pendingLock;
+	std::thread timer;
+	std::atomic<bool> running;
+	std::atomic<long> received; // one writer, the thread of the pricing flow
+	std::atomic<long> published; // written by the timer thread
+
+	// Publish the prices updated since the last tick
+	void Flush();
 
 public:
-	BondGUIService(int _interval, myConnector* _bondGuiConnector); // ctor
+	BondGUIService(int _interval, myConnector* _bondGuiConnector, BondProductService* _bondProductService = nullptr); // ctor
+	~BondGUIService(); // stops the timer
+
+	// Store the latest price of a product, published at the next tick
+	void UpdatePrice(const BondPrice &price);
+
+	// Start the timer thread
+	void Start();
+
+	// Stop the timer thread, publishing what is left
+	void Stop();
+
+	// Get the # of prices received by UpdatePrice
+	long GetReceivedCount() const;
+
+	// Get the # of prices published, the others were replaced by a later price of their product
+	// before the next tick
+	long GetPublishedCount() const;
 
 	// Get data on our service given a key
 	virtual BondPrice & GetData(string);
@@ -60,31 +107,49 @@ public:
 };
 
 // corresponding publish connector
+// GUI price record queued for the writer
+struct GUIRecord
+{
+	RecordTime time;
+	ProductHandle<Bond> product;
+	double mid;
+};
+
 class BondGUIConnector : public Connector<BondPrice>
 {
 protected:
-	fstream file;
+	std::unique_ptr<ColumnarWriter> columnar; // columnar output, before the writer that feeds it
+	std::unique_ptr<AsyncFileWriter<GUIRecord>> writer;
+
+	// Format a record into a line of the output file
+	static void Format(const GUIRecord&, std::string&);
+
+	// Append a record as a row of the columnar output
+	static void Append(const GUIRecord&, ColumnarWriter&);
 public:
-	BondGUIConnector(string _path); // ctor
+	BondGUIConnector(string _path, HistoricalFormat _format = TEXT_FORMAT); // ctor
 
 	// Publish data to the Connector
 	virtual void Publish(BondPrice &data);
+
+	// Publish data the service keeps resident to the Connector (only read)
+	virtual void Publish(const BondPrice &data);
 };
 
 // corresponding service listener
-class ToBondGUIListener : public ServiceListener<BondPrice>
+class ToBondGUIListener final : public ServiceListener<BondPrice>
 {
 protected:
 	BondGUIService* bondGuiService;
 
-	// model throttle
-	std::chrono::system_clock::time_point start;
-	timeUnite interval;
-	int counter = 0; // only update 100 times
-
 public:
 	ToBondGUIListener(BondGUIService* _bondGuiService); // ctor
 
+	// keep the const and rvalue overloads of ServiceListener visible
+	using ServiceListener<BondPrice>::ProcessAdd;
+	using ServiceListener<BondPrice>::ProcessRemove;
+	using ServiceListener<BondPrice>::ProcessUpdate;
+
 	// Listener callback to process an add event to the Service
 	virtual void ProcessAdd(BondPrice &data);
 
@@ -93,16 +158,25 @@ public:
 
 	// Listener callback to process an update event to the Service
 	virtual void ProcessUpdate(BondPrice &data);
+
+	// Listener callback to process an add event to the Service, on a read-only view of its data
+	virtual void ProcessAdd(const BondPrice &);
 };
 
-BondGUIService::BondGUIService(int _interval, myConnector* _bondGuiConnector) :
-	interval(_interval), bondGuiConnector(_bondGuiConnector)
+BondGUIService::BondGUIService(int _interval, myConnector* _bondGuiConnector, BondProductService* _bondProductService) :
+	bondGuiConnector(_bondGuiConnector), interval(_interval),
+	slots(_bondProductService ? _bondProductService->GetProductCount() : 0), running(false), received(0), published(0)
 {
 }
 
+BondGUIService::~BondGUIService()
+{
+	Stop();
+}
+
 BondPrice & BondGUIService::GetData(string key)
 {
-	return id_price_map[key];
+	return id_price_map.at(key);
 }
 
 void BondGUIService::OnMessage(BondPrice &data)
@@ -126,11 +200,10 @@ void BondGUIService::AddPrice(const BondPrice &price)
 	if (id_price_map.find(productId) == id_price_map.end()) // if not found this one then create one
 		id_price_map.insert(std::make_pair(productId, price));
 	else
-		id_price_map[productId] = price;
+		id_price_map.at(productId) = price;
 
 	// publish it
-	BondPrice temp(price);
-	bondGuiConnector->Publish(temp);
+	bondGuiConnector->Publish(price); // read-only view of the resident data
 
 }
 
@@ -139,28 +212,126 @@ const timeUnite& BondGUIService::GetTimeInterval() const
 	return interval;
 }
 
-BondGUIConnector::BondGUIConnector(string _path) :
-	file(_path, std::ios::out | std::ios::trunc)
+void BondGUIService::UpdatePrice(const BondPrice &price)
+{
+	received.store(received.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	const ProductHandle<Bond>& product = price.GetProductHandle();
+	int id = product.GetId();
+	if (id < 0 || id >= static_cast<int>(slots.size()))
+	{
+		std::lock_guard<std::mutex> guard(pendingLock);
+		pending.insert_or_assign(product->GetProductId(), price);
+		return;
+	}
+
+	// one writer per slot (the listener thread)
+	PriceSlot& slot = slots[id];
+	unsigned sequence = slot.sequence.load(std::memory_order_relaxed);
+	slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.product.store(&product.GetProduct(), std::memory_order_relaxed);
+	slot.mid.store(price.GetMid(), std::memory_order_relaxed);
+	slot.spread.store(price.GetBidOfferSpread(), std::memory_order_relaxed);
+	slot.sequence.store(sequence + 2, std::memory_order_release);
+	slot.dirty.store(true, std::memory_order_release);
+}
+
+void BondGUIService::Flush()
+{
+	for (std::size_t id = 0; id < slots.size(); id++)
+	{
+		PriceSlot& slot = slots[id];
+		if (!slot.dirty.exchange(false, std::memory_order_acquire))
+			continue;
+
+		// retry while the listener is writing the slot
+		const Bond* product;
+		double mid, spread;
+		unsigned before, after;
+		do
+		{
+			before = slot.sequence.load(std::memory_order_acquire);
+			product = slot.product.load(std::memory_order_relaxed);
+			mid = slot.mid.load(std::memory_order_relaxed);
+			spread = slot.spread.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = slot.sequence.load(std::memory_order_relaxed);
+		} while ((before & 1) || before != after);
+
+		AddPrice(BondPrice(ProductHandle<Bond>(static_cast<int>(id), product), mid, spread));
+		published.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	std::unordered_map<string, BondPrice> prices;
+	{
+		std::lock_guard<std::mutex> guard(pendingLock);
+		prices.swap(pending);
+	}
+	for (auto& entry : prices)
+		AddPrice(entry.second);
+	published.fetch_add(static_cast<long>(prices.size()), std::memory_order_relaxed);
+}
+
+void BondGUIService::Start()
 {
-	// set the header of the output file
-	file << "Time,BondIDType,BondID,Price"<<endl;;
+	if (running.exchange(true))
+		return;
+
+	timer = std::thread([this]()
+	{
+		while (running.load(std::memory_order_acquire))
+		{
+			std::this_thread::sleep_for(interval);
+			Flush();
+		}
+	});
+}
+
+void BondGUIService::Stop()
+{
+	if (!running.exchange(false))
+		return;
+
+	timer.join();
+	Flush();
+}
+
+long BondGUIService::GetReceivedCount() const
+{
+	return received.load(std::memory_order_relaxed);
+}
+
+long BondGUIService::GetPublishedCount() const
+{
+	return published.load(std::memory_order_relaxed);
+}
+
+BondGUIConnector::BondGUIConnector(string _path, HistoricalFormat _format)
+{
+	if (_format == COLUMNAR_FORMAT)
+	{
+		columnar.reset(new ColumnarWriter(_path, { {"Time",COLUMN_TIME},{"BondIDType",COLUMN_STRING},{"BondID",COLUMN_STRING},{"Price",COLUMN_PRICE} }, 0, 2));
+		writer.reset(new AsyncFileWriter<GUIRecord>([this](const GUIRecord& record) { Append(record, *columnar); }));
+	}
+	else
+		writer.reset(new AsyncFileWriter<GUIRecord>(_path, "Time,BondIDType,BondID,Price", &BondGUIConnector::Format));
 }
 
 void BondGUIConnector::Publish(BondPrice &data)
 {
-	if (file.is_open())
+	Publish(static_cast<const BondPrice&>(data));
+}
+
+void BondGUIConnector::Publish(const BondPrice &data)
+{
+	if (writer->is_open())
 	{
-		// make the ingredent of the outout
-		auto time = boost::posix_time::microsec_clock::local_time(); // current time
-		std::string date = DatetoStr(time.date());
-		std::string timeofDay = boost::posix_time::to_simple_string(time.time_of_day());
-		timeofDay.erase(timeofDay.end() - 3, timeofDay.end());
-		Bond bond = data.GetProduct(); // get the product
-		std::string Idtype = (bond.GetBondIdType() == CUSIP) ? "CUSIP" : "ISIN"; // get the bond id type
-		std::string priceStr = PricetoStr(data.GetMid());
-		// make the output
-		file << date << " " << timeofDay << "," << Idtype << ","
-			<< bond.GetProductId() << "," << priceStr << ""<<endl;;
+		// queue the record, the writer thread formats it
+		GUIRecord record;
+		record.time = RecordNow();
+		record.product = data.GetProductHandle();
+		record.mid = data.GetMid();
+		writer->Write(std::move(record));
 	}
 	else
 	{
@@ -168,22 +339,47 @@ void BondGUIConnector::Publish(BondPrice &data)
 	}
 }
 
+void BondGUIConnector::Format(const GUIRecord &record, std::string &out)
+{
+	const Bond& bond = *record.product; // get the product
+	char priceBuf[PRICE_BUFFER_SIZE];
+
+	// make the output
+	AppendTimestamp(out, record.time);
+	out += ',';
+	out += (bond.GetBondIdType() == CUSIP) ? "CUSIP" : "ISIN"; // get the bond id type
+	out += ',';
+	out += bond.GetProductId();
+	out += ',';
+	out.append(priceBuf, FormatPrice(record.mid, priceBuf));
+	out += '\n';
+}
+
+void BondGUIConnector::Append(const GUIRecord &record, ColumnarWriter &out)
+{
+	const Bond& bond = *record.product; // get the product
+
+	out.SetTime(0, record.time);
+	out.SetString(1, (bond.GetBondIdType() == CUSIP) ? "CUSIP" : "ISIN");
+	out.SetString(2, bond.GetProductId());
+	out.SetPrice(3, record.mid);
+	out.EndRow();
+}
+
 ToBondGUIListener::ToBondGUIListener(BondGUIService* _bondGuiService) :
 	bondGuiService(_bondGuiService)
 {
-	interval = bondGuiService->GetTimeInterval();
-	start = std::chrono::system_clock::now(); // start the clock
 }
 
 void ToBondGUIListener::ProcessAdd(BondPrice &data)
 {
-	// throttle control
-	if (std::chrono::system_clock::now() - start >= interval && counter < 100)
-	{
-		bondGuiService->AddPrice(data);
-		start = std::chrono::system_clock::now(); // restart the clock
-		counter++;
-	}
+	ProcessAdd(static_cast<const BondPrice&>(data));
+}
+
+void ToBondGUIListener::ProcessAdd(const BondPrice &data)
+{
+	// conflate: the service publishes the latest price at its next tick
+	bondGuiService->UpdatePrice(data);
 }
 
 void ToBondGUIListener::ProcessRemove(BondPrice &data)
@@ -7,6 +7,8 @@
 #include "inquiryservice.hpp"
 #include "products.hpp"
 #include "productservice.hpp"
+#include "LineTokenizer.hpp"
+#include "PriceCodec.hpp"
 #include "soa.hpp"
 #include "boost/date_time/gregorian/gregorian.hpp" 
 #include "boost/algorithm/string.hpp" 
@@ -63,7 +65,7 @@ protected:
 	unordered_map<string, InquiryState>states{ {"CUSTOMER_REJECTED",InquiryState::CUSTOMER_REJECTED},{"DONE",InquiryState::DONE,},{"QUOTED",InquiryState::QUOTED},{"RECEIVED",InquiryState::RECEIVED},{"REJECTED",InquiryState::REJECTED} };
 
 public:
-	BondInquiryConnector(string , BondInquiryService*,BondProductService*);
+	BondInquiryConnector(string , BondInquiryService*,BondProductService*, IngestionMode = STREAMED);
 
 	// Publish data to the Connector
 	virtual void Publish(BondInq &);
@@ -96,7 +98,7 @@ void BondInquiryService::SetConnector(Connector<BondInq>* _bondInquiryConnector)
 
 BondInq & BondInquiryService::GetData(string key)
 {
-	return inquiryMap[key];
+	return inquiryMap.at(key);
 }
 
 void BondInquiryService::OnMessage(BondInq &_bondInq)
@@ -106,7 +108,7 @@ void BondInquiryService::OnMessage(BondInq &_bondInq)
 	if (inquiryMap.find(orderId) == inquiryMap.end()) // if not found this one then create one
 		inquiryMap.insert(std::make_pair(orderId, _bondInq));
 	else
-		inquiryMap[orderId] = _bondInq;
+		inquiryMap.at(orderId) = _bondInq;
 
 	// call the listeners
 	for (auto private_l : listeners)
@@ -126,10 +128,10 @@ const BondInquiryService::listener_container& BondInquiryService::GetListeners()
 void BondInquiryService::SendQuote(const string &inquiryId, double price)
 {
 	// send back the quote to the connector
-	BondInq inquiry = inquiryMap[inquiryId]; // retrieve the corresponding inquiry
+	BondInq inquiry = inquiryMap.at(inquiryId); // retrieve the corresponding inquiry
 
 	// create a new inquiry with the new info
-	BondInq newInquiry(inquiryId, inquiry.GetProduct(), inquiry.GetSide(), inquiry.GetQuantity(),
+	BondInq newInquiry(inquiryId, inquiry.GetProductHandle(), inquiry.GetSide(), inquiry.GetQuantity(),
 		price, inquiry.GetState()); 
 
 	bondInquiryConnector->Publish(newInquiry);
@@ -137,10 +139,10 @@ void BondInquiryService::SendQuote(const string &inquiryId, double price)
 
 void BondInquiryService::RejectInquiry(const string &inquiryId)
 {
-	BondInq inquiry = inquiryMap[inquiryId]; // get the corresponding inquiry
+	BondInq inquiry = inquiryMap.at(inquiryId); // get the corresponding inquiry
 
 	/// transition the inquiry state to REJECTION
-	BondInq newInquiry(inquiryId, inquiry.GetProduct(), inquiry.GetSide(), inquiry.GetQuantity(),
+	BondInq newInquiry(inquiryId, inquiry.GetProductHandle(), inquiry.GetSide(), inquiry.GetQuantity(),
 		inquiry.GetPrice(), REJECTED); 
 
 	//send it back
@@ -148,51 +150,39 @@ void BondInquiryService::RejectInquiry(const string &inquiryId)
 }
 
 BondInquiryConnector::BondInquiryConnector(string path, BondInquiryService* _bondInquiryService,
-	BondProductService* _bondProductService) :
+	BondProductService* _bondProductService, IngestionMode mode) :
 	bondInquiryService(_bondInquiryService)
 {
 	bondInquiryService->SetConnector(this);
 
-	fstream file(path, std::ios::in);
-	string line;
+	// inquiry id, id type, id, side, quantity, price, state
+	LineTokenizer<7> tempData(path, mode);
 
-	char sep = ','; // comma seperator
-
-	if (file.is_open())
+	if (tempData.is_open())
 	{
 		std::cout << "Inquiry: Begin to read data" << endl;
-		getline(file, line); // discard header
+		tempData.Next(); // discard header
 		
-		while (getline(file, line))
+		while (tempData.Next())
 		{
-			stringstream sin(line);
-
-			// save all trimmed data into a vector of strings
-			std::vector<string> tempData;
-			string info;
-			while (getline(sin, info, sep))
-			{
-				boost::algorithm::trim(info);
-				tempData.push_back(info);
-			}
+			if (tempData.Size() < 7) // truncated line
+				continue;
 
 			// make the corresponding inquiry object
 			// inquiry Id
-			string inquiryId = tempData[0];
-			// bond Id
-			BondIdType type = (boost::algorithm::to_upper_copy(tempData[1]) == "CUSIP") ? CUSIP : ISIN;
-			string bondId = tempData[2];
+			string inquiryId(tempData[0]);
 			// the bond product
-			Bond bond = _bondProductService->GetData(bondId); // bond id, bond id type, ticker, coupon, maturity
+			ProductHandle<Bond> bond = _bondProductService->GetHandle(string(tempData[2])); // interned bond: id, bond id type, ticker, coupon, maturity
 			// inquiry side
-			Side side = (boost::algorithm::to_upper_copy(tempData[3]) == "BUY") ? BUY : SELL;
+			Side side = boost::algorithm::iequals(tempData[3], "BUY") ? BUY : SELL;
 			// inquiry quantity
-			long quantity = std::stol(tempData[4]);
+			long quantity = FieldtoLong(tempData[4]);
 			// inquiry price
-			double price = StrtoPrice(tempData[5]);
+			double price = ParsePrice(tempData[5]);
 			// inquiry state
-			boost::algorithm::to_upper(tempData[6]);
-			InquiryState state = states[tempData[6]];
+			string stateStr(tempData[6]);
+			boost::algorithm::to_upper(stateStr);
+			InquiryState state = states[stateStr];
 
 			// inquiry object
 			BondInq inquiry(inquiryId, bond, side, quantity, price, state);
@@ -216,13 +206,13 @@ void BondInquiryConnector::Publish(BondInq &data)
 	else // if not rejected by the service
 	{
 		// transition the inquiry to the QUOTED state
-		BondInq _quoted(data.GetInquiryId(), data.GetProduct(), data.GetSide(), data.GetQuantity(),data.GetPrice(), QUOTED);
+		BondInq _quoted(data.GetInquiryId(), data.GetProductHandle(), data.GetSide(), data.GetQuantity(),data.GetPrice(), QUOTED);
 
 		// send it back to the service
 		bondInquiryService->OnMessage(_quoted);
 
 		// transition the inquiry to the DONE state (or the customer can reject it)
-		BondInq _done(data.GetInquiryId(), data.GetProduct(), data.GetSide(), data.GetQuantity(),data.GetPrice(), DONE);
+		BondInq _done(data.GetInquiryId(), data.GetProductHandle(), data.GetSide(), data.GetQuantity(),data.GetPrice(), DONE);
 
 		// send it back to the service
 		bondInquiryService->OnMessage(_done);
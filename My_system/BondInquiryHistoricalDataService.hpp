@@ -11,7 +11,12 @@
 #include "boost/date_time/posix_time/posix_time.hpp"
 #include "boost/date_time/gregorian/gregorian.hpp"
 #include "soa.hpp"
+#include "AsyncFileWriter.hpp"
+#include "HistoryStore.hpp"
+#include "ColumnarStore.hpp"
+#include "PriceCodec.hpp"
 #include <unordered_map>
+#include <memory>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -24,9 +29,10 @@ protected:
 	std::vector<ServiceListener<BondInq>*> listeners;
 	Connector<BondInq>* bondInquiryHistoricalDataConnector;
 	std::unordered_map<string, BondInq> inquiryMap; // key on inquiry indentifier
+	HistoryStore<BondInq> history; // every persisted state of an inquiry by time, key on inquiry indentifier
 
 public:
-	BondInquiryHistoricalDataService(Connector<BondInq>*); 
+	BondInquiryHistoricalDataService(Connector<BondInq>*, std::size_t historyLimit = HISTORY_LIMIT); // keeps about historyLimit states per inquiry (0 keeps all)
 
 	// Get data on our service given a key
 	virtual BondInq & GetData(string);
@@ -43,20 +49,47 @@ public:
 
 	// Persist data to a store
 	virtual void PersistData(string, const BondInq&);
+
+	// Get the values persisted for a inquiry with from <= time <= to, oldest first
+	std::vector<TimedValue<BondInq>> GetHistory(const string&, RecordTime from, RecordTime to) const;
+
+	// Get the last n values persisted for a inquiry, oldest first
+	std::vector<TimedValue<BondInq>> GetLastUpdates(const string&, std::size_t n) const;
 };
 
 // corresponding publish connector
+// inquiry record queued for the writer
+struct InquiryRecord
+{
+	RecordTime time;
+	ProductHandle<Bond> product;
+	std::string inquiryId;
+	long quantity;
+	double price;
+	InquiryState state;
+};
+
 class BondInquiryHistoricalDataConnector : public Connector<BondInq>
 {
 protected:
-	fstream file;
 	unordered_map<InquiryState, string>states{ {InquiryState::CUSTOMER_REJECTED,"CUSTOMER_REJECTED"},{InquiryState::DONE,"DONE"},{InquiryState::QUOTED,"QUOTED"},{InquiryState::RECEIVED,"RECEIVED"},{InquiryState::REJECTED,"REJECTED"} };
+	std::unique_ptr<ColumnarWriter> columnar; // columnar output, before the writer that feeds it
+	std::unique_ptr<AsyncFileWriter<InquiryRecord>> writer; // its thread formats with states
+
+	// Format a record into a line of the output file
+	void Format(const InquiryRecord&, std::string&);
+
+	// Append a record as a row of the columnar output
+	void Append(const InquiryRecord&, ColumnarWriter&);
 public:
-	BondInquiryHistoricalDataConnector(string); // ctor
+	BondInquiryHistoricalDataConnector(string, HistoricalFormat = TEXT_FORMAT); // ctor
 
 	// Publish data to the Connector
 	virtual void Publish(Inquiry <Bond> &);
 
+	// Publish data the service keeps resident to the Connector (only read)
+	virtual void Publish(const Inquiry <Bond> &);
+
 };
 
 // corresponding service listener
@@ -79,13 +112,13 @@ public:
 };
 
 BondInquiryHistoricalDataService::BondInquiryHistoricalDataService(Connector<BondInq>* 
-	_bondInquiryHistoricalDataConnector): 
-	bondInquiryHistoricalDataConnector(_bondInquiryHistoricalDataConnector){}
+	_bondInquiryHistoricalDataConnector, std::size_t historyLimit): 
+	bondInquiryHistoricalDataConnector(_bondInquiryHistoricalDataConnector), history(historyLimit){}
 
 
 BondInq & BondInquiryHistoricalDataService::GetData(string key)
 {
-	return inquiryMap[key];
+	return inquiryMap.at(key);
 }
 
 void BondInquiryHistoricalDataService::OnMessage(BondInq &_bondInq)
@@ -110,53 +143,55 @@ void BondInquiryHistoricalDataService::PersistData(string key, const BondInq& _b
 		// if not found this one then create one
 		inquiryMap.insert(std::make_pair(key, _bondInq));
 	else
-		inquiryMap[key] = _bondInq;
+		inquiryMap.at(key) = _bondInq;
+	history.Append(key, RecordNow(), _bondInq);
 
 	// publish the data
-	BondInq temp(_bondInq);
-	bondInquiryHistoricalDataConnector->Publish(temp);
+	bondInquiryHistoricalDataConnector->Publish(_bondInq); // read-only view of the resident data
 
 }
 
-BondInquiryHistoricalDataConnector::BondInquiryHistoricalDataConnector(string _path) : 
-	file(_path, std::ios::out | std::ios::trunc)
+std::vector<TimedValue<BondInq>> BondInquiryHistoricalDataService::GetHistory(const string& key, RecordTime from, RecordTime to) const
 {
-	// set the header of the output file
-	file << "Time,InquiryID,BondIDType,BondID,Side,Quantity,Price,State"<<endl;;
+	return history.GetRange(key, from, to);
 }
 
-void BondInquiryHistoricalDataConnector::Publish(Inquiry <Bond> &_bondInq)
+std::vector<TimedValue<BondInq>> BondInquiryHistoricalDataService::GetLastUpdates(const string& key, std::size_t n) const
 {
-	std::stringstream ss;
-	
-	if (file.is_open())
-	{
-		// make the ingredent of the outout
-		auto time = boost::posix_time::microsec_clock::local_time(); // current time
-		std::string date = DatetoStr(time.date());
-		std::string _time = boost::posix_time::to_simple_string(time.time_of_day());
-		_time.erase(_time.end() - 3, _time.end());
-
-		//collect the attributes needed to build the output
-		// get the product
-		Bond bond = _bondInq.GetProduct(); 
-
-		// get the bond id type
-		std::string Idtype = (bond.GetBondIdType() == CUSIP) ? "CUSIP" : "ISIN"; 
-		std::string side = (_bondInq.GetSide() == BUY) ? "BUY" : "SELL";
-
-		// get price
-		std::string priceStr = PricetoStr(_bondInq.GetPrice()); 
+	return history.GetLast(key, n);
+}
 
-		// get the state
-		InquiryState state = _bondInq.GetState(); 
+BondInquiryHistoricalDataConnector::BondInquiryHistoricalDataConnector(string _path, HistoricalFormat _format)
+{
+	if (_format == COLUMNAR_FORMAT)
+	{
+		columnar.reset(new ColumnarWriter(_path, { {"Time",COLUMN_TIME},{"InquiryID",COLUMN_STRING},{"BondIDType",COLUMN_STRING},
+			{"BondID",COLUMN_STRING},{"Side",COLUMN_STRING},{"Quantity",COLUMN_LONG},{"Price",COLUMN_PRICE},{"State",COLUMN_STRING} }, 0, 3));
+		writer.reset(new AsyncFileWriter<InquiryRecord>([this](const InquiryRecord& record) { Append(record, *columnar); }));
+	}
+	else
+		writer.reset(new AsyncFileWriter<InquiryRecord>(_path, "Time,InquiryID,BondIDType,BondID,Side,Quantity,Price,State",
+			[this](const InquiryRecord& record, std::string& out) { Format(record, out); }));
+}
 
-		std::string stateStr = states[state];
+void BondInquiryHistoricalDataConnector::Publish(Inquiry <Bond> &_bondInq)
+{
+	Publish(static_cast<const Inquiry <Bond>&>(_bondInq));
+}
 
-		// make the output
-		file << date << " " << _time << "," << _bondInq.GetInquiryId() << "," << Idtype << "," 
-			<< bond.GetProductId() << "," << bond.GetTicker() << ","
-			<< std::to_string(_bondInq.GetQuantity()) << "," << priceStr << "," << stateStr << ""<<endl;;
+void BondInquiryHistoricalDataConnector::Publish(const Inquiry <Bond> &_bondInq)
+{
+	if (writer->is_open())
+	{
+		// queue the record, the writer thread formats it
+		InquiryRecord record;
+		record.time = RecordNow();
+		record.product = _bondInq.GetProductHandle();
+		record.inquiryId = _bondInq.GetInquiryId();
+		record.quantity = _bondInq.GetQuantity();
+		record.price = _bondInq.GetPrice();
+		record.state = _bondInq.GetState();
+		writer->Write(std::move(record));
 	}
 	else
 	{
@@ -164,6 +199,45 @@ void BondInquiryHistoricalDataConnector::Publish(Inquiry <Bond> &_bondInq)
 	}
 }
 
+void BondInquiryHistoricalDataConnector::Format(const InquiryRecord &record, std::string &out)
+{
+	const Bond& bond = *record.product; // get the product
+	char priceBuf[PRICE_BUFFER_SIZE];
+
+	// make the output
+	AppendTimestamp(out, record.time);
+	out += ',';
+	out += record.inquiryId;
+	out += ',';
+	out += (bond.GetBondIdType() == CUSIP) ? "CUSIP" : "ISIN"; // get the bond id type
+	out += ',';
+	out += bond.GetProductId();
+	out += ',';
+	out += bond.GetTicker();
+	out += ',';
+	out += std::to_string(record.quantity);
+	out += ',';
+	out.append(priceBuf, FormatPrice(record.price, priceBuf));
+	out += ',';
+	out += states[record.state];
+	out += '\n';
+}
+
+void BondInquiryHistoricalDataConnector::Append(const InquiryRecord &record, ColumnarWriter &out)
+{
+	const Bond& bond = *record.product; // get the product
+
+	out.SetTime(0, record.time);
+	out.SetString(1, record.inquiryId);
+	out.SetString(2, (bond.GetBondIdType() == CUSIP) ? "CUSIP" : "ISIN");
+	out.SetString(3, bond.GetProductId());
+	out.SetString(4, bond.GetTicker());
+	out.SetLong(5, record.quantity);
+	out.SetPrice(6, record.price);
+	out.SetString(7, states[record.state]);
+	out.EndRow();
+}
+
 ToBondInquiryHistoricalDataListener::ToBondInquiryHistoricalDataListener(BondInquiryHistoricalDataService*
 	_bondInquiryHistoricalDataService) :
 	bondInquiryHistoricalDataService(_bondInquiryHistoricalDataService)
@@ -8,22 +8,42 @@
 #include "products.hpp"
 #include "soa.hpp"
 #include "productservice.hpp"
+#include "LineTokenizer.hpp"
+#include "PriceCodec.hpp"
+#include "ProductStore.hpp"
+#include "OrderBookEngine.hpp"
+#include "BookDelta.hpp"
 #include "boost/algorithm/string.hpp"
 #include "boost/date_time/gregorian/gregorian.hpp"
-#include <unordered_map>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <string_view>
 
 // Bond market data service
 class BondMarketDataService : public MarketDataService<Bond>
 {
 	typedef ServiceListener<BondOrderBook> myListener;
 	typedef std::vector<myListener*> listener_container;
+	typedef std::vector<ServiceListener<BondBookDelta>*> delta_listener_container;
 
 protected:
 	listener_container listeners;
-	std::unordered_map<string, BondOrderBook> id_orderbook_map; // key: bond ID value: Bond order book
+	delta_listener_container deltaListeners; // told which levels changed
+	ProductStore<Bond, BondOrderBook> id_orderbook_map; // slot on the interned product id, value: Bond order book
+	ProductStore<Bond, OrderBookEngine> engines; // sorted, aggregated levels of each book
+	ProductStore<Bond, BidOffer> bestBidOffers; // best bid/offer of each book, kept on every update
+	ProductStore<Bond, bool> staleBooks; // the engine has deltas not yet in the stored book
+	long rejectedInserts = 0; // level inserts at a price that already had a level
+
+	// Refresh the cached best bid/offer of a product from its engine
+	void UpdateBestBidOffer(const ProductHandle<Bond>&, const OrderBookEngine&);
+
+	// Rebuild a stored book from the aggregated levels of its engine, into the stacks it already has
+	BondOrderBook& RebuildBook(BondOrderBook&);
+
+	// Store a full snapshot book and reload its engine
+	void StoreBook(const BondOrderBook&);
 public:
 	BondMarketDataService() {}
 
@@ -33,6 +53,22 @@ public:
 	// The callback that a Connector should invoke for any new or updated data
 	virtual void OnMessage(BondOrderBook &);
 
+	// The callback for a batch of order books: the books and engines are updated for the
+	// whole batch, then each listener gets the batch in one call
+	virtual void OnMessageBatch(BondOrderBook *, std::size_t);
+
+	// The callback that a delta Connector should invoke for incremental level changes
+	// an insert creates a level and is rejected (and counted) if its price already has one,
+	// an update sets the quantity of a level (creating it if needed), a delete removes it;
+	// the listeners get the rebuilt book with ProcessAdd, as for a full book
+	void OnDelta(BondBookDelta &);
+
+	// Add a listener for level changes, called with ProcessAdd on snapshots and ProcessUpdate on deltas
+	void AddDeltaListener(ServiceListener<BondBookDelta> *);
+
+	// Get the # of level inserts rejected because their price already had a level
+	long GetRejectedInsertCount() const;
+
 	// Add a listener to the Service for callbacks on add, remove, and update events
 	// for data to the Service.
 	virtual void AddListener(myListener *);
@@ -45,6 +81,9 @@ public:
 
 	// Aggregate the order book
 	virtual const BondOrderBook& AggregateDepth(const string &);
+
+	// Copy up to maxLevels aggregated levels of a side into out without allocating, returns the # copied
+	std::size_t GetDepth(const string &, PricingSide, BookLevel*, std::size_t);
 };
 
 // Corresponding subscribe connector
@@ -52,180 +91,281 @@ class BondMarketDataConnector : public Connector<BondOrderBook>
 {
 protected:
 	Service<string, BondOrderBook>* bondMarketDataService;
+	long rowCount = 0; // # of order book rows handed to the service
 
 public:
-	BondMarketDataConnector(string, Service<string, BondOrderBook>*, BondProductService*); // ctor
+	BondMarketDataConnector(string, Service<string, BondOrderBook>*, BondProductService*, IngestionMode = STREAMED, std::size_t batchSize = 256); // ctor, rows reach the service batchSize at a time
 
 	// Publish data to the Connector
 	virtual void Publish(BondOrderBook &);
 
+	// Get the number of order book rows read from the file
+	long GetRowCount() const;
+
+};
+
+// Corresponding subscribe connector for the incremental format
+// each line is BondID,Action,Side,Price,Quantity with Action one of SNAPSHOT (clears the book,
+// no level), INSERT, UPDATE or DELETE; consecutive lines of a product form one delta
+class BondMarketDataDeltaConnector : public Connector<BondBookDelta>
+{
+protected:
+	BondMarketDataService* bondMarketDataService;
+	long rowCount = 0; // # of delta lines read
+	long deltaCount = 0; // # of deltas handed to the service
+
+public:
+	BondMarketDataDeltaConnector(string, BondMarketDataService*, BondProductService*, IngestionMode = STREAMED); // ctor
+
+	// Publish data to the Connector
+	virtual void Publish(BondBookDelta &);
+
+	// Get the number of delta lines read from the file
+	long GetRowCount() const;
+
+	// Get the number of deltas handed to the service
+	long GetDeltaCount() const;
 };
 
 BondOrderBook & BondMarketDataService::GetData(string key)
 {
-	return id_orderbook_map[key];
+	// books fed by deltas without listeners are only materialized when they are asked for
+	BondOrderBook& book = id_orderbook_map.At(key);
+	bool* stale = staleBooks.Find(key);
+	if (stale != nullptr && *stale)
+		return RebuildBook(book);
+	return book;
 }
 
 void BondMarketDataService::OnMessage(BondOrderBook &_bondOrderBook)
 {
-	// push the _bondOrderBook into map
-	string pd_id = _bondOrderBook.GetProduct().GetProductId();
-	if (id_orderbook_map.find(pd_id) == id_orderbook_map.end()) // if not found this one then create one
-		id_orderbook_map.insert(std::make_pair(pd_id, _bondOrderBook));
-	else
-		id_orderbook_map[pd_id] = _bondOrderBook;
+	StoreBook(_bondOrderBook);
 
 	// call the listeners
 	for (auto private_l : listeners)
 		private_l->ProcessAdd(_bondOrderBook);
 }
 
-void BondMarketDataService::AddListener(myListener *_listener)
+void BondMarketDataService::OnMessageBatch(BondOrderBook *books, std::size_t count)
 {
-	listeners.push_back(_listener);
-}
+	for (std::size_t i = 0; i < count; i++)
+		StoreBook(books[i]);
 
-const BondMarketDataService::listener_container& BondMarketDataService::GetListeners() const
-{
-	return listeners;
+	// call the listeners
+	for (auto private_l : listeners)
+		private_l->ProcessBatch(books, count);
 }
 
-const BidOffer& BondMarketDataService::GetBestBidOffer(const string &pd_id)
+void BondMarketDataService::StoreBook(const BondOrderBook &_bondOrderBook)
 {
-	return id_orderbook_map[pd_id].GetBestBidOffer();
+	// push the _bondOrderBook into map
+	const ProductHandle<Bond>& product = _bondOrderBook.GetProductHandle();
+	id_orderbook_map.Set(product, _bondOrderBook);
+
+	// the book is a full snapshot, reload the levels of the engine
+	OrderBookEngine& engine = engines[product];
+	engine.Load(_bondOrderBook.GetBidStack(), _bondOrderBook.GetOfferStack());
+	UpdateBestBidOffer(product, engine);
+
+	staleBooks.Set(product, false);
 }
 
-const BondOrderBook& BondMarketDataService::AggregateDepth(const string &pd_id)
+void BondMarketDataService::OnDelta(BondBookDelta &_delta)
 {
-	BondOrderBook orderbook = id_orderbook_map[pd_id];
-	std::vector<Order> bidOrders = orderbook.GetBidStack();
-	std::vector<Order> offerOrders = orderbook.GetOfferStack();
-
-	// aggregation
-	std::unordered_map<double, long> bidMap;
-	std::unordered_map<double, long> offerMap;
+	const ProductHandle<Bond>& product = _delta.GetProductHandle();
+	BondOrderBook* book = id_orderbook_map.Find(product);
+	if (book == nullptr)
+		book = &id_orderbook_map.Set(product, BondOrderBook(product, std::vector<Order>(), std::vector<Order>()));
+
+	// apply the level changes to the resident book
+	OrderBookEngine& engine = engines[product];
+	if (_delta.IsSnapshot())
+		engine.Clear();
+	for (const LevelDelta& level : _delta.GetLevels())
+	{
+		switch (level.action)
+		{
+		case LEVEL_INSERT:
+			if (!engine.InsertLevel(level.side, level.ticks, level.quantity))
+				++rejectedInserts;
+			break;
+		case LEVEL_UPDATE:
+			engine.ModifyLevel(level.side, level.ticks, level.quantity);
+			break;
+		case LEVEL_DELETE:
+			engine.DeleteLevel(level.side, level.ticks);
+			break;
+		}
+	}
+	UpdateBestBidOffer(product, engine);
+	staleBooks.Set(product, true);
 
-	double temp_price; // temp price
-	double temp_quantity;
-	// for bid orders
-	for (auto iter = bidOrders.begin(); iter != bidOrders.end(); iter++)
+	// call the listeners with the book the delta leads to
+	if (!listeners.empty())
 	{
-		temp_price = iter->GetPrice();
-		temp_quantity = iter->GetQuantity();
-		if (bidMap.find(temp_price) != bidMap.end())
-			bidMap[temp_price] += temp_quantity;
-		else
-			bidMap.insert(std::make_pair(temp_price, temp_quantity));
+		BondOrderBook& rebuilt = RebuildBook(*book);
+		for (auto private_l : listeners)
+			private_l->ProcessAdd(rebuilt);
 	}
 
-	// for offer orders
-	for (auto iter = offerOrders.begin(); iter != offerOrders.end(); iter++)
+	// call the delta listeners
+	for (auto private_l : deltaListeners)
 	{
-		temp_price = iter->GetPrice();
-		temp_quantity = iter->GetQuantity();
-		if (offerMap.find(temp_price) != offerMap.end())
-			offerMap[temp_price] += temp_quantity;
+		if (_delta.IsSnapshot())
+			private_l->ProcessAdd(_delta);
 		else
-			offerMap.insert(std::make_pair(temp_price, temp_quantity));
+			private_l->ProcessUpdate(_delta);
 	}
+}
+
+void BondMarketDataService::AddListener(myListener *_listener)
+{
+	listeners.push_back(_listener);
+}
+
+void BondMarketDataService::AddDeltaListener(ServiceListener<BondBookDelta> *_listener)
+{
+	deltaListeners.push_back(_listener);
+}
+
+const BondMarketDataService::listener_container& BondMarketDataService::GetListeners() const
+{
+	return listeners;
+}
+
+long BondMarketDataService::GetRejectedInsertCount() const
+{
+	return rejectedInserts;
+}
+
+void BondMarketDataService::UpdateBestBidOffer(const ProductHandle<Bond>& product, const OrderBookEngine& engine)
+{
+	Order bid(0.0, 0, BID);
+	Order offer(0.0, 0, OFFER);
+	if (engine.HasBest(BID))
+		bid = Order(PriceTraits<double>::FromTicks(engine.Best(BID).ticks), engine.Best(BID).quantity, BID);
+	if (engine.HasBest(OFFER))
+		offer = Order(PriceTraits<double>::FromTicks(engine.Best(OFFER).ticks), engine.Best(OFFER).quantity, OFFER);
+	bestBidOffers.Set(product, BidOffer(bid, offer));
+}
+
+const BidOffer& BondMarketDataService::GetBestBidOffer(const string &pd_id)
+{
+	return bestBidOffers[pd_id];
+}
 
-	std::vector<Order> newBorders;
-	std::vector<Order> newOorders;
+const BondOrderBook& BondMarketDataService::AggregateDepth(const string &pd_id)
+{
+	return RebuildBook(id_orderbook_map.At(pd_id));
+}
 
-	// rebuild the bid and offer orders
-	for (auto iter = bidMap.begin(); iter != bidMap.end(); iter++)
+BondOrderBook& BondMarketDataService::RebuildBook(BondOrderBook& book)
+{
+	const ProductHandle<Bond>& product = book.GetProductHandle();
+	const OrderBookEngine& engine = engines[product];
+
+	// the engine already holds the aggregated levels, best first; the stacks only
+	// allocate when a side grows past their capacity
+	std::vector<Order>& bids = book.GetBidStack();
+	std::vector<Order>& offers = book.GetOfferStack();
+	bids.clear();
+	offers.clear();
+	for (std::size_t i = 0; i < engine.LevelCount(BID); i++)
 	{
-		newBorders.push_back(Order(iter->first, iter->second, BID));
+		const BookLevel& level = engine.Level(BID, i);
+		bids.push_back(Order(PriceTraits<double>::FromTicks(level.ticks), level.quantity, BID));
 	}
-	for (auto iter = offerMap.begin(); iter != offerMap.end(); iter++)
+	for (std::size_t i = 0; i < engine.LevelCount(OFFER); i++)
 	{
-		newOorders.push_back(Order(iter->first, iter->second, OFFER));
+		const BookLevel& level = engine.Level(OFFER, i);
+		offers.push_back(Order(PriceTraits<double>::FromTicks(level.ticks), level.quantity, OFFER));
 	}
 
-	// re-construct the order book
-	BondOrderBook neworderbook(orderbook.GetProduct(), newBorders, newOorders);
+	staleBooks.Set(product, false);
+	return book;
+}
 
-	id_orderbook_map[pd_id] = neworderbook;
-	return id_orderbook_map[pd_id];
+std::size_t BondMarketDataService::GetDepth(const string &pd_id, PricingSide side, BookLevel* out, std::size_t maxLevels)
+{
+	const BondOrderBook* orderbook = id_orderbook_map.Find(pd_id);
+	if (orderbook == nullptr)
+		return 0;
+	return engines[orderbook->GetProductHandle()].Depth(side, out, maxLevels);
 }
 
 BondMarketDataConnector::BondMarketDataConnector(
-	string path, Service<string, BondOrderBook>* _bondMarketDataService, BondProductService* _bondProductService) :
+	string path, Service<string, BondOrderBook>* _bondMarketDataService, BondProductService* _bondProductService,
+	IngestionMode mode, std::size_t batchSize) :
 	bondMarketDataService(_bondMarketDataService)
 {
-	fstream file(path, std::ios::in);
-	string line;
-
-	char sep = ',';
+	// id type, id, mid, 5 spreads, 5 sizes
+	LineTokenizer<13> cells(path, mode);
 
-	if (file.is_open())
+	if (cells.is_open())
 	{
 		std::cout << "Market data: Begin to read data..." << endl;
-		getline(file, line); // discard header
+		cells.Next(); // discard header
 
 		int temp_count = 0;
 		int count_percentage = 1;
 
-		while (getline(file, line))
-		{
-			++temp_count;
+		// the stacks are reused across rows, the book copies them on construction
+		std::vector<Order> bidOrders;
+		std::vector<Order> offerOrders;
+		bidOrders.reserve(5);
+		offerOrders.reserve(5);
 
-			stringstream lineStream(line);
+		// rows are handed to the service a batch at a time
+		if (batchSize == 0)
+			batchSize = 1;
+		std::vector<BondOrderBook> batch;
+		batch.reserve(batchSize);
 
-			// save all trimmed data
-			std::vector<string> cells;
-			string cell;
-			while (getline(lineStream, cell, sep))
-			{
-				boost::algorithm::trim(cell);
-				cells.push_back(cell);
-			}
+		while (cells.Next())
+		{
+			if (cells.Size() < 13) // truncated line
+				continue;
+
+			++temp_count;
 
-			// make the corresponding trade object
-			// bond Id
-			BondIdType type = (boost::algorithm::to_upper_copy(cells[0]) == "CUSIP") ? CUSIP : ISIN;
-			string bondId = cells[1];
 			// the bond product
-			Bond bond = _bondProductService->GetData(bondId); // bond id, bond id type, ticker, coupon, maturity
+			ProductHandle<Bond> bond = _bondProductService->GetHandle(string(cells[1])); // interned bond: id, bond id type, ticker, coupon, maturity
 			// mid price
-			double midprice = StrtoPrice(cells[2]);
-			// 5 bid orders and 5 offer orders
-			std::vector<Order> bidOrders;
-			std::vector<Order> offerOrders;
-
-			long temp_quantity;
-			double temp_price;
+			double midprice = ParsePrice(cells[2]);
 
+			// 5 bid orders and 5 offer orders
+			bidOrders.clear();
+			offerOrders.clear();
 			for (int i = 1; i <= 5; i++)
 			{
-				temp_quantity = std::stol(cells[7 + i]);
-
-				temp_price = midprice - StrtoPrice(cells[2 + i]);
-				Order bid(temp_price, temp_quantity, BID);
-				temp_quantity = std::stol(cells[7 + i]);
-				temp_price = midprice + StrtoPrice(cells[2 + i]);
-				Order offer(temp_price, temp_quantity, OFFER);
-				bidOrders.push_back(bid);
-				offerOrders.push_back(offer);
+				long temp_quantity = FieldtoLong(cells[7 + i]);
+				double temp_spread = ParsePrice(cells[2 + i]);
+				bidOrders.push_back(Order(midprice - temp_spread, temp_quantity, BID));
+				offerOrders.push_back(Order(midprice + temp_spread, temp_quantity, OFFER));
 			}
 
 			// order book object
-			BondOrderBook orderbook(bond, bidOrders, offerOrders);
-
-			bondMarketDataService->OnMessage(orderbook);
+			batch.push_back(BondOrderBook(bond, bidOrders, offerOrders));
+			if (batch.size() == batchSize)
+			{
+				bondMarketDataService->OnMessageBatch(batch.data(), batch.size());
+				batch.clear();
+			}
+			++rowCount;
 
 			if ((temp_count) % (6 * 1000) == 0)
 			{
 				std::cout << "%" << count_percentage << " completed" << endl;
 				++count_percentage;
 			}
-
 		}
+		if (!batch.empty())
+			bondMarketDataService->OnMessageBatch(batch.data(), batch.size());
 		std::cout << "Market data: finished!" << endl;
 	}
 	else
 	{
-		std::cout << "Cannot open the file!" << endl;;
+		std::cout << "Cannot open the file!" << endl;
 	}
 }
 
@@ -234,5 +374,103 @@ void BondMarketDataConnector::Publish(BondOrderBook &data)
 	// undefined publish() for subsribe connector
 }
 
+long BondMarketDataConnector::GetRowCount() const
+{
+	return rowCount;
+}
+
+BondMarketDataDeltaConnector::BondMarketDataDeltaConnector(
+	string path, BondMarketDataService* _bondMarketDataService, BondProductService* _bondProductService,
+	IngestionMode mode) :
+	bondMarketDataService(_bondMarketDataService)
+{
+	// id, action, side, price, quantity
+	LineTokenizer<5> cells(path, mode);
+
+	if (cells.is_open())
+	{
+		std::cout << "Market data: Begin to read deltas..." << endl;
+		cells.Next(); // discard header
+
+		// the delta is reused across products, it keeps its level storage
+		BondBookDelta delta;
+		string pd_id;
+		bool pending = false;
+
+		while (cells.Next())
+		{
+			if (cells.Size() < 2) // truncated line
+				continue;
+
+			++rowCount;
+
+			// a new product closes the current delta
+			if (!pending || cells[0] != pd_id)
+			{
+				if (pending)
+				{
+					bondMarketDataService->OnDelta(delta);
+					++deltaCount;
+				}
+				pd_id.assign(cells[0].data(), cells[0].size());
+				delta.Reset(_bondProductService->GetHandle(pd_id));
+				pending = true;
+			}
+
+			std::string_view action = cells[1];
+			if (boost::algorithm::iequals(action, "SNAPSHOT"))
+			{
+				// a snapshot starts a new delta that replaces the book
+				if (!delta.GetLevels().empty() || delta.IsSnapshot())
+				{
+					bondMarketDataService->OnDelta(delta);
+					++deltaCount;
+				}
+				delta.Reset(delta.GetProductHandle(), true);
+				continue;
+			}
+			if (cells.Size() < 5) // level without price or quantity
+				continue;
+
+			PricingSide side = boost::algorithm::iequals(cells[2], "BID") ? BID : OFFER;
+			long ticks = ParseTicks(cells[3].data(), cells[3].data() + cells[3].size());
+			long quantity = FieldtoLong(cells[4]);
+
+			if (boost::algorithm::iequals(action, "DELETE"))
+				delta.AddLevel(LEVEL_DELETE, side, ticks, 0);
+			else if (boost::algorithm::iequals(action, "INSERT"))
+				delta.AddLevel(LEVEL_INSERT, side, ticks, quantity);
+			else
+				delta.AddLevel(LEVEL_UPDATE, side, ticks, quantity);
+		}
+
+		if (pending)
+		{
+			bondMarketDataService->OnDelta(delta);
+			++deltaCount;
+		}
+		std::cout << "Market data: deltas finished!" << endl;
+	}
+	else
+	{
+		std::cout << "Cannot open the file!" << endl;
+	}
+}
+
+void BondMarketDataDeltaConnector::Publish(BondBookDelta &)
+{
+	// undefined publish() for subsribe connector
+}
+
+long BondMarketDataDeltaConnector::GetRowCount() const
+{
+	return rowCount;
+}
+
+long BondMarketDataDeltaConnector::GetDeltaCount() const
+{
+	return deltaCount;
+}
+
 #endif // !BONDMARKETDATA_HPP
 
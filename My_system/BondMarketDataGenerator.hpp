@@ -5,12 +5,14 @@
 
 #include "productservice.hpp"
 #include "products.hpp"
+#include "PriceCodec.hpp"
 #include <string>
 #include <iostream>
 #include <vector>
 #include <fstream>
 #include <sstream>
 #include<algorithm>
+#include <map>
 
 // generate the market data (orderbook) and write it to the file specified by path
 void bond_market_data_generator(std::string path, BondProductService* bondProductService, std::string ticker)
@@ -73,6 +75,90 @@ void bond_market_data_generator(std::string path, BondProductService* bondProduc
 }
 
 
+// write the level changes turning one side of a book (ticks -> size) into another
+void write_level_deltas(std::fstream& file, const std::string& productId, const std::string& side,
+	const std::map<long, long>& before, const std::map<long, long>& after)
+{
+	char priceBuf[PRICE_BUFFER_SIZE];
+	for (auto& level : before)
+	{
+		if (after.find(level.first) == after.end())
+			file << productId << ",DELETE," << side << "," << std::string_view(priceBuf, FormatTicks(level.first, priceBuf)) << ",0" << "\n";
+	}
+	for (auto& level : after)
+	{
+		auto iter = before.find(level.first);
+		if (iter == before.end())
+			file << productId << ",INSERT," << side << "," << std::string_view(priceBuf, FormatTicks(level.first, priceBuf)) << "," << level.second << "\n";
+		else if (iter->second != level.second)
+			file << productId << ",UPDATE," << side << "," << std::string_view(priceBuf, FormatTicks(level.first, priceBuf)) << "," << level.second << "\n";
+	}
+}
+
+// generate the same market data as bond_market_data_generator in the incremental format:
+// a snapshot of each book every snapshotInterval updates, level changes in between
+void bond_market_data_delta_generator(std::string path, BondProductService* bondProductService, std::string ticker,
+	long updatesPerProduct = 100000, int snapshotInterval = 100)
+{
+	std::fstream file(path, std::ios::out | std::ios::trunc); // open the file
+	std::vector<Bond> bondVec = bondProductService->GetBonds(ticker);
+
+	if (file.is_open())
+	{
+		std::cout << "Market data: Simulating the market data deltas" << endl;
+		// header
+		file << "BondID,Action,Side,Price,Quantity" << endl;
+
+		int n = bondVec.size(); // # of bonds
+		std::vector< std::map<long, long> > bids(n), offers(n); // current book of each product, in ticks
+		std::map<long, long> newBids, newOffers;
+		const long sizes[5]{ 10000000, 20000000, 30000000, 40000000, 50000000 };
+
+		int temp_count = 1;
+		for (long i = 0; i < n * updatesPerProduct; ++i)
+		{
+			int bondIndex = i % n;
+			const std::string& productId = bondVec[bondIndex].GetProductId();
+
+			// same price path as the snapshot generator, in ticks of 1/256
+			int temp = (i / n) % 1024;
+			long mid = 99 * TICKS_PER_POINT + ((temp < 512) ? temp : (1024 - temp));
+			int temp2 = (i / n) % 6;
+			long pre_spread = 2 * ((temp2 < 3) ? temp2 : (6 - temp2));
+
+			newBids.clear();
+			newOffers.clear();
+			for (int k = 0; k < 5; k++)
+			{
+				long spread = 2 * (k + 1) + pre_spread;
+				newBids[mid - spread] += sizes[k];
+				newOffers[mid + spread] += sizes[k];
+			}
 
+			if ((i / n) % snapshotInterval == 0)
+			{
+				// periodic snapshot
+				file << productId << ",SNAPSHOT,,," << "\n";
+				bids[bondIndex].clear();
+				offers[bondIndex].clear();
+			}
+			write_level_deltas(file, productId, "BID", bids[bondIndex], newBids);
+			write_level_deltas(file, productId, "OFFER", offers[bondIndex], newOffers);
+			bids[bondIndex].swap(newBids);
+			offers[bondIndex].swap(newOffers);
+
+			if (((i + 1)) % std::max(1L, n * updatesPerProduct / 10) == 0)
+			{
+				std::cout << "%" << temp_count * 10 << " completed" << endl;
+				++temp_count;
+			}
+		}
+		std::cout << "Market data: Simulation finished!" << endl;
+	}
+	else
+	{
+		std::cout << "Cannot open the file!" << endl;
+	}
+}
 
 #endif // !BONDMARKETDATAGENERATOR_HPP
@@ -8,22 +8,59 @@
 #include "tradebookingservice.hpp"
 #include "products.hpp"
 #include "soa.hpp"
+#include "ProductStore.hpp"
+#include "MpscQueue.hpp" // trade queue of each shard
 #include <unordered_map>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <iostream>
 
 // Bond position service
+// products are partitioned across shards on a hash of their identifier; once started,
+// each shard applies its trades on its own worker thread in the order they were added,
+// so the trades of a product stay in order while different products update in parallel
+// with more than one shard the listeners are called from the shard threads concurrently
+// (for different products), so the shards only run in parallel when every listener was
+// added as thread-safe; otherwise, and with one shard, trades are applied inline
 class BondPositionService : public PositionService<Bond>
 {
 	typedef ServiceListener<BondPos> myListener;
 	typedef std::vector<myListener*> listener_container;
 
 protected:
+	struct Shard
+	{
+		ProductStore<Bond, BondPos> id_pos_map; // slot on the interned product id
+		MpscQueue<BondTrade> trades;
+		std::thread worker;
+		std::atomic<long> queued{ 0 }; // written by the threads adding trades
+		std::atomic<long> applied{ 0 }; // written by the worker
+
+		Shard() : trades(1 << 12) {}
+	};
+
 	listener_container listeners;
-	std::unordered_map<string, BondPos> id_pos_map; // key on product identifier
+	bool threadSafeListeners = true; // every listener may be called from several shards at once
+	std::vector<std::unique_ptr<Shard>> shards;
+	bool running = false;
+
+	// Get the shard owning a product
+	Shard& ShardOf(const string& productId);
+
+	// Update the position of a trade in its shard and call the listeners
+	void ApplyTrade(Shard&, const BondTrade&);
+
+	// Worker loop of a shard
+	void RunShard(Shard&);
 
 public:
-	BondPositionService(BondProductService*, std::string); 
+	BondPositionService(BondProductService*, std::string, std::size_t shardCount = 1); // ctor
+	~BondPositionService(); // stops the shard workers
 
-	// Get data on our service given a key
+	// Get data on our service given a key, consistent once the shards are drained
 	virtual BondPos & GetData(string);
 
 	// The callback that a Connector should invoke for any new or updated data
@@ -33,12 +70,28 @@ public:
 	// for data to the Service.
 	virtual void AddListener(myListener *);
 
+	// Add a listener, threadSafe if it may be called for different products at once
+	void AddListener(myListener *, bool threadSafe);
+
 	// Get all listeners on the Service.
 	virtual const listener_container& GetListeners() const;
 
 	// Add a trade to the service
 	virtual void AddTrade(const BondTrade&);
 
+	// Start the shard workers, trades are applied inline until then (and with one shard or
+	// a listener that is not thread-safe); true if the workers run
+	bool Start();
+
+	// Wait until every trade added so far was applied
+	void Drain();
+
+	// Apply the queued trades and join the shard workers
+	void Stop();
+
+	// Get the # of shards
+	std::size_t GetShardCount() const;
+
 };
 
 //from BondTradeBookingService to BondPositionService
@@ -51,6 +104,11 @@ protected:
 public:
 	ToBondPositionListener(BondPositionService*); //constructor
 
+	// keep the const and rvalue overloads of ServiceListener visible
+	using ServiceListener<BondTrade>::ProcessAdd;
+	using ServiceListener<BondTrade>::ProcessRemove;
+	using ServiceListener<BondTrade>::ProcessUpdate;
+
 	// Listener callback to process an add event to the Service
 	virtual void ProcessAdd(BondTrade &);
 
@@ -59,23 +117,43 @@ public:
 
 	// Listener callback to process an update event to the Service
 	virtual void ProcessUpdate(BondTrade &);
+
+	// Listener callback to process an update event to the Service, on a read-only view of its data
+	virtual void ProcessUpdate(const BondTrade &);
 };
 
-BondPositionService::BondPositionService(BondProductService* bondProductService, std::string ticker)
+BondPositionService::BondPositionService(BondProductService* bondProductService, std::string ticker, std::size_t shardCount)
 {
+	if (shardCount == 0)
+		shardCount = 1;
+	for (std::size_t i = 0; i < shardCount; i++)
+		shards.push_back(std::unique_ptr<Shard>(new Shard()));
+
 	std::vector<Bond> _products = bondProductService->GetBonds(ticker);
 
-	// initialize the position map
+	// initialize the position map of each shard
 	for (auto bd:_products)
 	{
-		BondPos position(bd);
-		id_pos_map.insert(std::make_pair(bd.GetProductId(), position));
+		BondPos position(bondProductService->GetHandle(bd.GetProductId()));
+		ShardOf(bd.GetProductId()).id_pos_map.Set(position.GetProductHandle(), position);
 	}
 }
 
+BondPositionService::~BondPositionService()
+{
+	Stop();
+}
+
+BondPositionService::Shard& BondPositionService::ShardOf(const string& productId)
+{
+	if (shards.size() == 1)
+		return *shards[0];
+	return *shards[std::hash<string>()(productId) % shards.size()];
+}
+
 BondPos & BondPositionService::GetData(string key)
 {
-	return id_pos_map[key];
+	return ShardOf(key).id_pos_map.At(key);
 }
 
 void BondPositionService::OnMessage(BondPos &data)
@@ -85,7 +163,18 @@ void BondPositionService::OnMessage(BondPos &data)
 
 void BondPositionService::AddListener(myListener *listener)
 {
+	AddListener(listener, false);
+}
+
+void BondPositionService::AddListener(myListener *listener, bool threadSafe)
+{
+	if (running)
+	{
+		std::cout << "Cannot add a listener while the shards run!" << std::endl;
+		return;
+	}
 	listeners.push_back(listener);
+	threadSafeListeners = threadSafeListeners && threadSafe;
 }
 
 const BondPositionService::listener_container& BondPositionService::GetListeners() const
@@ -94,19 +183,88 @@ const BondPositionService::listener_container& BondPositionService::GetListeners
 }
 
 void BondPositionService::AddTrade(const BondTrade &trade)
+{
+	Shard& shard = ShardOf(trade.GetProduct().GetProductId());
+	if (!running)
+	{
+		ApplyTrade(shard, trade);
+		return;
+	}
+
+	shard.queued.fetch_add(1, std::memory_order_release);
+	shard.trades.Push(trade);
+}
+
+void BondPositionService::ApplyTrade(Shard& shard, const BondTrade &trade)
 {
 	// Update the position based on this trade
-	string pd_id = trade.GetProduct().GetProductId();
-	string book = trade.GetBook();
+	const ProductHandle<Bond>& product = trade.GetProductHandle();
 	long tmp_qt = trade.GetQuantity();
 	long qt= (trade.GetSide() == BUY) ? tmp_qt : -tmp_qt;
-	BondPos pos = id_pos_map[pd_id];
-	pos.AddNewPosition(book, qt);
-	id_pos_map[pd_id] = pos;
+	BondPos* pos = shard.id_pos_map.Find(product); // update the resident position in place
+	if (pos == nullptr) // a bond that was not in the universe at start
+		pos = &shard.id_pos_map.Set(product, BondPos(product));
+	pos->AddNewPosition(trade.GetBook(), qt);
 
-	// Send this pos to the listeners
+	// Send a read-only view of this pos to the listeners
+	const BondPos& view = *pos;
 	for (auto private_l : listeners)
-		private_l->ProcessUpdate(pos);
+		private_l->ProcessUpdate(view);
+}
+
+void BondPositionService::RunShard(Shard& shard)
+{
+	std::vector<BondTrade> trades;
+	trades.reserve(256);
+	std::size_t count;
+	while ((count = shard.trades.PopBatch(trades, 256)) > 0)
+	{
+		for (const BondTrade& trade : trades)
+			ApplyTrade(shard, trade);
+		trades.clear();
+		shard.applied.fetch_add(static_cast<long>(count), std::memory_order_release);
+	}
+}
+
+bool BondPositionService::Start()
+{
+	if (running || shards.size() == 1)
+		return running;
+	if (!threadSafeListeners)
+	{
+		std::cout << "Cannot run the shards in parallel, a listener is not thread-safe!" << std::endl;
+		return false;
+	}
+	running = true;
+	for (auto& shard : shards)
+		shard->worker = std::thread(&BondPositionService::RunShard, this, std::ref(*shard));
+	return true;
+}
+
+void BondPositionService::Drain()
+{
+	for (auto& shard : shards)
+	{
+		unsigned spins = 0;
+		while (shard->applied.load(std::memory_order_acquire) != shard->queued.load(std::memory_order_acquire))
+			SpscBackoff(spins);
+	}
+}
+
+void BondPositionService::Stop()
+{
+	if (!running)
+		return;
+	for (auto& shard : shards)
+		shard->trades.Close();
+	for (auto& shard : shards)
+		shard->worker.join();
+	running = false;
+}
+
+std::size_t BondPositionService::GetShardCount() const
+{
+	return shards.size();
 }
 
 ToBondPositionListener::ToBondPositionListener(BondPositionService* _bondPositionService) :
@@ -123,6 +281,11 @@ void ToBondPositionListener::ProcessRemove(BondTrade &_bondTrade)
 }
 
 void ToBondPositionListener::ProcessUpdate(BondTrade &_bondTrade)
+{
+	ProcessUpdate(static_cast<const BondTrade&>(_bondTrade));
+}
+
+void ToBondPositionListener::ProcessUpdate(const BondTrade &_bondTrade)
 {
 	bondPositionService->AddTrade(_bondTrade);
 }
@@ -9,6 +9,10 @@
 #include "BondPosition.hpp"
 #include "products.hpp"
 #include "soa.hpp"
+#include "AsyncFileWriter.hpp"
+#include "HistoryStore.hpp"
+#include "ColumnarStore.hpp"
+#include <memory>
 #include "boost/date_time/posix_time/posix_time.hpp"
 #include "boost/date_time/gregorian/gregorian.hpp"
 #include <unordered_map>
@@ -27,9 +31,10 @@ protected:
 	listener_container listeners;
 	myConnector* bondPositionHistoricalDataConnector;
 	std::unordered_map<string, BondPos> id_pos_map; // key on product indentifier
+	HistoryStore<BondPos> history; // every persisted position by time, key on product indentifier
 
 public:
-	BondPositionHistoricalDataService(myConnector*); // ctor
+	BondPositionHistoricalDataService(myConnector*, std::size_t historyLimit = HISTORY_LIMIT); // ctor, keeps about historyLimit positions per product (0 keeps all)
 
 	// Get data on our service given a key
 	virtual BondPos & GetData(string);
@@ -46,19 +51,46 @@ public:
 
 	// Persist data to a store
 	virtual void PersistData(string, const BondPos&);
+
+	// Get the values persisted for a product with from <= time <= to, oldest first
+	std::vector<TimedValue<BondPos>> GetHistory(const string&, RecordTime from, RecordTime to) const;
+
+	// Get the last n values persisted for a product, oldest first
+	std::vector<TimedValue<BondPos>> GetLastUpdates(const string&, std::size_t n) const;
 };
 
 // corresponding publish connector
+// position record queued for the writer: the positions of the three books and the aggregate
+struct PositionRecord
+{
+	RecordTime time;
+	ProductHandle<Bond> product;
+	long positions[4];
+};
+
 class BondPositionHistoricalDataConnector : public Connector<BondPos>
 {
 protected:
-	fstream file;
+	std::unique_ptr<ColumnarWriter> columnar; // columnar output, before the writer that feeds it
+	std::unique_ptr<AsyncFileWriter<PositionRecord>> writer;
+
+	// Format a record into the lines of the output file
+	static void Format(const PositionRecord&, std::string&);
+
+	// Append a record as a row of the columnar output (one row for the three books and the aggregate)
+	static void Append(const PositionRecord&, ColumnarWriter&);
 public:
-	BondPositionHistoricalDataConnector(string); // ctor
+	BondPositionHistoricalDataConnector(string, HistoricalFormat = TEXT_FORMAT); // ctor
+
+	// Convert a columnar position file to the text output (one line per book)
+	static void ToCsv(const string& storePath, const string& csvPath);
 
 	// Publish data to the Connector
 	virtual void Publish(BondPos &);
 
+	// Publish data the service keeps resident to the Connector (only read)
+	virtual void Publish(const BondPos &);
+
 };
 
 // corresponding service listener
@@ -70,6 +102,11 @@ protected:
 public:
 	ToBondPositionHistoricalDataListener(BondPositionHistoricalDataService*); // ctor
 
+	// keep the const and rvalue overloads of ServiceListener visible
+	using ServiceListener<BondPos>::ProcessAdd;
+	using ServiceListener<BondPos>::ProcessRemove;
+	using ServiceListener<BondPos>::ProcessUpdate;
+
 	// Listener callback to process an add event to the Service
 	virtual void ProcessAdd(BondPos &);
 
@@ -78,15 +115,18 @@ public:
 
 	// Listener callback to process an update event to the Service
 	virtual void ProcessUpdate(BondPos &);
+
+	// Listener callback to process an update event to the Service, on a read-only view of its data
+	virtual void ProcessUpdate(const BondPos &);
 };
 
-BondPositionHistoricalDataService::BondPositionHistoricalDataService(myConnector*_bondPositionHistoricalDataConnector) :
-	bondPositionHistoricalDataConnector(_bondPositionHistoricalDataConnector){}
+BondPositionHistoricalDataService::BondPositionHistoricalDataService(myConnector*_bondPositionHistoricalDataConnector, std::size_t historyLimit) :
+	bondPositionHistoricalDataConnector(_bondPositionHistoricalDataConnector), history(historyLimit){}
 
 
 BondPos & BondPositionHistoricalDataService::GetData(string key)
 {
-	return id_pos_map[key];
+	return id_pos_map.at(key);
 }
 
 void BondPositionHistoricalDataService::OnMessage(BondPos &data)
@@ -109,48 +149,56 @@ void BondPositionHistoricalDataService::PersistData(string key, const BondPos& d
 	if (id_pos_map.find(key) == id_pos_map.end()) // if not found this one then create one
 		id_pos_map.insert(std::make_pair(key, data));
 	else
-		id_pos_map[key] = data;
+		id_pos_map.at(key) = data;
+	history.Append(key, RecordNow(), data);
 
 	// publish the data
-	BondPos temp(data);
-	bondPositionHistoricalDataConnector->Publish(temp);
+	bondPositionHistoricalDataConnector->Publish(data); // read-only view of the resident data
+
+}
+
+std::vector<TimedValue<BondPos>> BondPositionHistoricalDataService::GetHistory(const string& key, RecordTime from, RecordTime to) const
+{
+	return history.GetRange(key, from, to);
+}
 
+std::vector<TimedValue<BondPos>> BondPositionHistoricalDataService::GetLastUpdates(const string& key, std::size_t n) const
+{
+	return history.GetLast(key, n);
 }
 
-BondPositionHistoricalDataConnector::BondPositionHistoricalDataConnector(string _path) : 
-	file(_path, std::ios::out | std::ios::trunc)
+BondPositionHistoricalDataConnector::BondPositionHistoricalDataConnector(string _path, HistoricalFormat _format)
 {
-	// set the header of the output file
-	file << "Time,BondIDType,BondID,BookId,Positions"<<endl;;
+	if (_format == COLUMNAR_FORMAT)
+	{
+		columnar.reset(new ColumnarWriter(_path, { {"Time",COLUMN_TIME},{"BondIDType",COLUMN_STRING},{"BondID",COLUMN_STRING},
+			{"TRSY1",COLUMN_LONG},{"TRSY2",COLUMN_LONG},{"TRSY3",COLUMN_LONG},{"AGGREGATED",COLUMN_LONG} }, 0, 2));
+		writer.reset(new AsyncFileWriter<PositionRecord>([this](const PositionRecord& record) { Append(record, *columnar); }));
+	}
+	else
+		writer.reset(new AsyncFileWriter<PositionRecord>(_path, "Time,BondIDType,BondID,BookId,Positions", &BondPositionHistoricalDataConnector::Format));
 }
 
 void BondPositionHistoricalDataConnector::Publish(BondPos &data)
 {
-	std::stringstream ss;
-	// hard-coded the book id
-	std::string book1 = "TRSY1";
-	std::string book2 = "TRSY2";
-	std::string book3 = "TRSY3";
+	Publish(static_cast<const BondPos&>(data));
+}
 
+void BondPositionHistoricalDataConnector::Publish(const BondPos &data)
+{
+	// hard-coded the book id
+	static std::string books[3]{ "TRSY1","TRSY2","TRSY3" };
 
-	if (file.is_open())
+	if (writer->is_open())
 	{
-		// make the ingredent of the outout
-		auto time = boost::posix_time::microsec_clock::local_time(); // current time
-		std::string date = DatetoStr(time.date());
-		std::string timeofDay = boost::posix_time::to_simple_string(time.time_of_day());
-		timeofDay.erase(timeofDay.end() - 3, timeofDay.end());
-		Bond bond = data.GetProduct(); // get the product
-		std::string Idtype = (bond.GetBondIdType() == CUSIP) ? "CUSIP" : "ISIN"; // get the bond id type
-		// make the output
-		file << date << " " << timeofDay << "," << Idtype << "," << bond.GetProductId() << ","
-			<< book1 << "," << std::to_string(data.GetPosition(book1)) << ""<<endl;;
-		file << date << " " << timeofDay << "," << Idtype << "," << bond.GetProductId() << ","
-			<< book2 << "," << std::to_string(data.GetPosition(book2)) << ""<<endl;;
-		file << date << " " << timeofDay << "," << Idtype << "," << bond.GetProductId() << ","
-			<< book3 << "," << std::to_string(data.GetPosition(book3)) << ""<<endl;;
-		file << date << " " << timeofDay << "," << Idtype << "," << bond.GetProductId() << ","
-			<< "AGGREGATED" << "," << std::to_string(data.GetAggregatePosition()) << ""<<endl;;
+		// queue the record, the writer thread formats it
+		PositionRecord record;
+		record.time = RecordNow();
+		record.product = data.GetProductHandle();
+		for (int i = 0; i < 3; i++)
+			record.positions[i] = data.GetPosition(books[i]);
+		record.positions[3] = data.GetAggregatePosition();
+		writer->Write(std::move(record));
 	}
 	else
 	{
@@ -158,6 +206,87 @@ void BondPositionHistoricalDataConnector::Publish(BondPos &data)
 	}
 }
 
+void BondPositionHistoricalDataConnector::Format(const PositionRecord &record, std::string &out)
+{
+	static const char* books[4]{ "TRSY1","TRSY2","TRSY3","AGGREGATED" };
+
+	char time[TIMESTAMP_BUFFER_SIZE];
+	int timeLength = FormatTimestamp(record.time, time);
+	const Bond& bond = *record.product; // get the product
+	const char* Idtype = (bond.GetBondIdType() == CUSIP) ? "CUSIP" : "ISIN"; // get the bond id type
+
+	// one line per book and one for the aggregate
+	for (int i = 0; i < 4; i++)
+	{
+		out.append(time, timeLength);
+		out += ',';
+		out += Idtype;
+		out += ',';
+		out += bond.GetProductId();
+		out += ',';
+		out += books[i];
+		out += ',';
+		out += std::to_string(record.positions[i]);
+		out += '\n';
+	}
+}
+
+void BondPositionHistoricalDataConnector::Append(const PositionRecord &record, ColumnarWriter &out)
+{
+	const Bond& bond = *record.product; // get the product
+
+	out.SetTime(0, record.time);
+	out.SetString(1, (bond.GetBondIdType() == CUSIP) ? "CUSIP" : "ISIN");
+	out.SetString(2, bond.GetProductId());
+	for (int i = 0; i < 4; i++)
+		out.SetLong(3 + i, record.positions[i]);
+	out.EndRow();
+}
+
+void BondPositionHistoricalDataConnector::ToCsv(const string& storePath, const string& csvPath)
+{
+	static const char* books[4]{ "TRSY1","TRSY2","TRSY3","AGGREGATED" };
+
+	ColumnarReader reader(storePath);
+	std::ofstream csv(csvPath, std::ios::binary);
+	if (!reader.is_open() || !csv.is_open())
+	{
+		std::cout << "Cannot open the file!" << endl;
+		return;
+	}
+
+	std::string out = "Time,BondIDType,BondID,BookId,Positions\n";
+	std::vector<std::int64_t> columns[7];
+	char time[TIMESTAMP_BUFFER_SIZE];
+	for (std::size_t b = 0; b < reader.GetBlocks().size(); b++)
+	{
+		for (int c = 0; c < 7; c++)
+			reader.ReadLongs(b, c, columns[c]);
+
+		for (std::size_t r = 0; r < columns[0].size(); r++)
+		{
+			int timeLength = FormatTimestamp(RecordTime(std::chrono::duration_cast<RecordTime::duration>(
+				std::chrono::microseconds(columns[0][r]))), time);
+			for (int i = 0; i < 4; i++)
+			{
+				out.append(time, timeLength);
+				out += ',';
+				out += reader.GetString(static_cast<std::uint32_t>(columns[1][r]));
+				out += ',';
+				out += reader.GetString(static_cast<std::uint32_t>(columns[2][r]));
+				out += ',';
+				out += books[i];
+				out += ',';
+				out += std::to_string(columns[3 + i][r]);
+				out += '\n';
+			}
+		}
+		csv.write(out.data(), out.size());
+		out.clear();
+	}
+	csv.write(out.data(), out.size());
+}
+
 ToBondPositionHistoricalDataListener::ToBondPositionHistoricalDataListener(BondPositionHistoricalDataService* 
 	_bondPositionHistoricalDataService): bondPositionHistoricalDataService(_bondPositionHistoricalDataService)
 {
@@ -172,6 +301,11 @@ void ToBondPositionHistoricalDataListener::ProcessRemove(BondPos &data)
 }
 
 void ToBondPositionHistoricalDataListener::ProcessUpdate(BondPos &data)
+{
+	ProcessUpdate(static_cast<const BondPos&>(data));
+}
+
+void ToBondPositionHistoricalDataListener::ProcessUpdate(const BondPos &data)
 {
 	string key = data.GetProduct().GetProductId();
 	bondPositionHistoricalDataService->PersistData(key, data);
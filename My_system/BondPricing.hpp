@@ -8,6 +8,10 @@
 #include "products.hpp"
 #include "soa.hpp"
 #include "productservice.hpp"
+#include "ProductStore.hpp" // dense product-keyed store
+#include "StaticListeners.hpp" // listeners wired at compile time
+#include "LineTokenizer.hpp" // shared line tokenizer
+#include "PriceCodec.hpp" // fractional price parsing
 #include "boost/algorithm/string.hpp" // string algorithm
 #include "boost/date_time/gregorian/gregorian.hpp" // date operation
 #include <string>
@@ -18,18 +22,22 @@
 #include <iostream>
 
 // Bond pricing service
+// Type Fixed is the set of listeners wired at compile time (StaticListeners), they are
+// called before the listeners added at runtime; BondPricingService has none
 
 
-class BondPricingService : public PricingService<Bond>
+template<typename Fixed = NoListeners<BondPrice>>
+class BondPricingServiceT : public PricingService<Bond>
 {
 	typedef ServiceListener<BondPrice> myListener;
 	typedef vector<myListener*> Listener_container;
 protected:
+	Fixed fixedListeners;
 	Listener_container listeners;
-	std::unordered_map<string, BondPrice> id_price_map; // key on product identifier
+	ProductStore<Bond, BondPrice> id_price_map; // slot on the interned product id
 
 public:
-	BondPricingService() {} // empty ctor
+	BondPricingServiceT(Fixed _fixedListeners = Fixed()) : fixedListeners(_fixedListeners) {} // ctor
 
 	// Get data on our service given a key
 	virtual BondPrice & GetData(string);
@@ -40,14 +48,20 @@ public:
 	*/
 	virtual void OnMessage(BondPrice &);
 
+	// The callback for a batch of prices: the map is updated for the whole batch, then each
+	// listener gets the batch in one call
+	virtual void OnMessageBatch(BondPrice *, std::size_t);
+
 	// Add a listener to the Service for callbacks on add, remove, and update events
 	// for data to the Service.
 	virtual void AddListener(myListener *);
 
-	// Get all listeners on the Service.
+	// Get all listeners added at runtime on the Service.
 	virtual const Listener_container& GetListeners() const;
 };
 
+typedef BondPricingServiceT<> BondPricingService;
+
 // Corresponding subscribe connector
 class BondPricingConnector : public Connector<BondPrice>
 {
@@ -57,87 +71,100 @@ protected:
 	Service<string, BondPrice>* bondPricingService;
 
 public:
-	BondPricingConnector(const string&, Service<string, BondPrice>*, BondProductService*);
+	BondPricingConnector(const string&, Service<string, BondPrice>*, BondProductService*, IngestionMode = STREAMED, std::size_t batchSize = 256); // ctor, rows reach the service batchSize at a time
 
 	// Publish data to the Connector
 	virtual void Publish(BondPrice &);
 
 };
 
-BondPrice & BondPricingService::GetData(string key)
+template<typename Fixed>
+BondPrice & BondPricingServiceT<Fixed>::GetData(string key)
 {
-	return id_price_map[key];
+	return id_price_map.At(key);
 }
 
-void BondPricingService::OnMessage(BondPrice &_BondPrice)
+template<typename Fixed>
+void BondPricingServiceT<Fixed>::OnMessage(BondPrice &_BondPrice)
 {
 	// push the data into map
-	string pd_id = _BondPrice.GetProduct().GetProductId();
-	if (id_price_map.find(pd_id) == id_price_map.end())
-		id_price_map.insert(std::make_pair(pd_id, _BondPrice));
-	else
-		id_price_map[pd_id] = _BondPrice;
+	id_price_map.Set(_BondPrice.GetProductHandle(), _BondPrice);
 
 	// call the listeners
+	fixedListeners.Add(_BondPrice);
 	for (auto private_l : listeners)
 
 		private_l->ProcessAdd(_BondPrice);
 }
 
-void BondPricingService::AddListener(myListener * _myListener)
+template<typename Fixed>
+void BondPricingServiceT<Fixed>::OnMessageBatch(BondPrice *prices, std::size_t count)
+{
+	// push the data into map
+	for (std::size_t i = 0; i < count; i++)
+		id_price_map.Set(prices[i].GetProductHandle(), prices[i]);
+
+	// call the listeners
+	fixedListeners.Batch(prices, count);
+	for (auto private_l : listeners)
+		private_l->ProcessBatch(prices, count);
+}
+
+template<typename Fixed>
+void BondPricingServiceT<Fixed>::AddListener(myListener * _myListener)
 {
 	listeners.push_back(_myListener);
 }
 
-const BondPricingService::Listener_container& BondPricingService::GetListeners() const
+template<typename Fixed>
+const typename BondPricingServiceT<Fixed>::Listener_container& BondPricingServiceT<Fixed>::GetListeners() const
 {
 	return listeners;
 }
 
 BondPricingConnector::BondPricingConnector(const string& path,
-	Service<string, BondPrice>* _bondPricingService, BondProductService* _bondProductService) :
+	Service<string, BondPrice>* _bondPricingService, BondProductService* _bondProductService, IngestionMode mode, std::size_t batchSize) :
 	bondPricingService(_bondPricingService)
 {
-	fstream file(path, std::ios::in);
-	string line;
-	char sep = ','; // comma seperator
+	// id type, id, mid, spread
+	LineTokenizer<4> cells(path, mode);
 
-	if (file.is_open())
+	if (cells.is_open())
 	{
 		std::cout << "Price: Begin to read data..." << endl;
-		getline(file, line); // discard header
+		cells.Next(); // discard header
 
 		int temp_count = 0;
 		int count_percentage = 1;
 
-		while (getline(file, line))
-		{
-			++temp_count;
+		// rows are handed to the service a batch at a time
+		if (batchSize == 0)
+			batchSize = 1;
+		std::vector<BondPrice> batch;
+		batch.reserve(batchSize);
 
-			stringstream lineStream(line);
+		while (cells.Next())
+		{
+			if (cells.Size() < 4) // truncated line
+				continue;
 
-			// save all trimmed data into a vector of strings
-			std::vector<string> cells;
-			string cell;
-			while (getline(lineStream, cell, sep))
-			{
-				boost::algorithm::trim(cell);
-				cells.push_back(cell);
-			}
+			++temp_count;
 
-			BondIdType type = (boost::algorithm::to_upper_copy(cells[0]) == "ISIN") ? ISIN : CUSIP;
-			string pd_id = cells[1];
+			string pd_id(cells[1]);
 			// the bond product
-			Bond bond = _bondProductService->GetData(pd_id); // bond id, bond id type, ticker, coupon, maturity
+			ProductHandle<Bond> bond = _bondProductService->GetHandle(pd_id); // interned bond: id, bond id type, ticker, coupon, maturity
 			// bond price
-			double mid = StrtoPrice(cells[2]);
+			double mid = ParsePrice(cells[2]);
 			// bond price spread
-			double spread = StrtoPrice(cells[3]);
+			double spread = ParsePrice(cells[3]);
 
 			// price object
-			BondPrice price(bond, mid, spread);
-
-			bondPricingService->OnMessage(price);
+			batch.push_back(BondPrice(bond, mid, spread));
+			if (batch.size() == batchSize)
+			{
+				bondPricingService->OnMessageBatch(batch.data(), batch.size());
+				batch.clear();
+			}
 
 			if ((temp_count) % (6 * 10000) == 0)
 			{
@@ -145,6 +172,8 @@ BondPricingConnector::BondPricingConnector(const string& path,
 				++count_percentage;
 			}
 		}
+		if (!batch.empty())
+			bondPricingService->OnMessageBatch(batch.data(), batch.size());
 		std::cout << "Price: finished!" << endl;
 	}
 	else
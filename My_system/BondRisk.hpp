@@ -6,11 +6,19 @@
 
 #include<vector>
 #include<unordered_map>
+#include<cmath>
+#include<algorithm>
+#include<iostream>
+#include<mutex>
+#include<cassert>
 #include "riskservice.hpp"
 #include "positionservice.hpp"
 #include "productservice.hpp"
 #include "products.hpp"
 #include "soa.hpp"
+#include "ProductStore.hpp"
+#include "RiskTree.hpp"
+#include "PV01Engine.hpp"
 
 // Bond risk service
 class BondRiskService : public RiskService<Bond>
@@ -20,13 +28,36 @@ class BondRiskService : public RiskService<Bond>
 protected:
 	BondProductService* bondProductService;
 	listener_container listeners;
-	std::unordered_map<string, BondPV01> pv01Map; // key on product identifier
+	ProductStore<Bond, BondPV01> pv01Map; // slot on the interned product id
+	PV01Engine engine; // the same pv01 and quantities as arrays, for portfolio and scenario risk
 
-	// key: sector name, value: sector	PV01
-	std::unordered_map<string, PV01<BucketedSector<Bond>>> bucketpv01Map; 
+	// running totals of a bucketed sector, moved by the delta of every position change
+	struct BucketTotals
+	{
+		ProductHandle<BucketedSector<Bond>> sector; // one copy of the sector, shared by its PV01 values
+		long long quantity; // sum of the quantities
+		double pv01; // sum of pv01 * quantity
+		double gross; // sum of the magnitudes moved into pv01, bounds its rounding error
+		PV01<BucketedSector<Bond>> risk; // bucketed risk of the last update
+	};
+	std::vector<BucketTotals> bucketTotals;
+	RiskTree* riskTree = nullptr; // hierarchy the book positions roll up into, if any
+	std::mutex lock; // positions and pv01 marks arrive on different threads
+	std::unordered_map<string, std::size_t> bucketIds; // key: sector name, value: its totals
+	ProductStore<Bond, std::vector<std::size_t>> productBuckets; // slot on the interned product id, value: the sectors it is in
+
+	// Sum the quantity and pv01 * quantity of a sector over its products
+	void SumBucket(const BucketedSector<Bond> &, long long &, double &);
+
+	// Move the totals of the sectors of a product by the change of its pv01 and quantity
+	void ApplyBucketDelta(const ProductHandle<Bond> &, double, long, double, long);
+
+	// marks staged by UpdatePV01s
+	std::vector<double> pendingPv01s; // slot on the engine row, NaN if the product has no staged mark
+	std::vector<ProductHandle<Bond>> pendingProducts; // the products with a staged mark, once each
 
 public:
-	BondRiskService(BondProductService*, std::unordered_map<string, double>&);
+	BondRiskService(BondProductService*, const std::unordered_map<string, double>&); // ctor, pv01 of each product at its first mark
 
 	// Get data on our service given a key
 	virtual BondPV01 & GetData(string);
@@ -44,9 +75,39 @@ public:
 	// Add a position that the service will risk
 	virtual void AddPosition(BondPos &);
 
-	// Update the bucketed risk for the bucket sector
+	// Add a position that the service will risk, on a read-only view of it
+	virtual void AddPosition(const BondPos &);
+
+	// Get the array view of the risk, in step with the BondPV01 values
+	const PV01Engine& GetEngine() const;
+
+	// Roll the book positions up into an aggregation tree on every position from now on
+	void SetRiskTree(RiskTree *);
+
+	// Register a bucket sector, its totals are kept up to date on every position from then on
+	// (done on the first update of a sector that was not registered); returns its totals id
+	std::size_t AddBucket(const BucketedSector<Bond> &);
+
+	// Stage the pv01 of products at new marks, the latest of each product is kept until
+	// ApplyPendingPV01s; the pricing flow applies them at the end of each batch of marks, so
+	// a batch moves the risk in one step rather than product by product
+	void UpdatePV01s(const ProductHandle<Bond>*, const double*, std::size_t);
+
+	// Set the staged pv01s, keeping the quantities; the bucket totals, the engine and the tree
+	// follow at once, listeners see the new pv01 with the next position
+	void ApplyPendingPV01s();
+
+	// Get the ids of the sectors a product is in, in the order they were registered (an id
+	// repeats for a product listed twice in its sector); nullptr if it is in none
+	const std::vector<std::size_t>* GetBuckets(const ProductHandle<Bond> &) const;
+
+	// Update the bucketed risk for the bucket sector from its running totals; debug builds
+	// check the totals against a full recompute
 	virtual void UpdateBucketedRisk(const BucketedSector<Bond> &);
 
+	// Update the bucketed risk of a registered sector by its id, and get it
+	const PV01<BucketedSector<Bond>>& UpdateBucketedRisk(std::size_t);
+
 	// Get the bucketed risk for the bucket sector
 	virtual const PV01<BucketedSector<Bond>>& GetBucketedRisk(const BucketedSector<Bond> &) const;
 };
@@ -60,6 +121,11 @@ protected:
 public:
 	BondRiskListener(BondRiskService*); // ctor
 
+	// keep the const and rvalue overloads of ServiceListener visible
+	using ServiceListener<BondPos>::ProcessAdd;
+	using ServiceListener<BondPos>::ProcessRemove;
+	using ServiceListener<BondPos>::ProcessUpdate;
+
 	// Listener callback to process an add event to the Service
 	virtual void ProcessAdd(BondPos &);
 
@@ -68,22 +134,26 @@ public:
 
 	// Listener callback to process an update event to the Service
 	virtual void ProcessUpdate(BondPos &);
+
+	// Listener callback to process an update event to the Service, on a read-only view of its data
+	virtual void ProcessUpdate(const BondPos &);
 };
 
-BondRiskService::BondRiskService(BondProductService* _bondProductService, std::unordered_map<string, double>& _pv01) :
+BondRiskService::BondRiskService(BondProductService* _bondProductService, const std::unordered_map<string, double>& _pv01) :
 	bondProductService(_bondProductService)
 {
 	for (auto& item:_pv01)
 	{
 		string productId = item.first;
-		auto _bond = bondProductService->GetData(productId);
-		pv01Map.insert(std::make_pair(productId,BondPV01(_bond, item.second, 0)));
+		ProductHandle<Bond> _bond = bondProductService->GetHandle(productId);
+		pv01Map.Set(_bond, BondPV01(_bond, item.second, 0));
+		engine.AddProduct(_bond, item.second, 0);
 	}
 }
 
 BondPV01 & BondRiskService::GetData(string key)
 {
-	return pv01Map[key];
+	return pv01Map.At(key);
 }
 
 void BondRiskService::OnMessage(BondPV01 &data)
@@ -103,58 +173,181 @@ const BondRiskService::listener_container& BondRiskService::GetListeners() const
 
 void BondRiskService::AddPosition(BondPos &position)
 {
-	// get the corresponding pv01
-	string productId = position.GetProduct().GetProductId();
-	BondPV01 productPv = pv01Map[productId];
+	AddPosition(static_cast<const BondPos&>(position));
+}
+
+void BondRiskService::AddPosition(const BondPos &position)
+{
+	std::lock_guard<std::mutex> guard(lock);
 
-	// Update the pv01 object
-	long long newQt = position.GetAggregatePosition() + productPv.GetQuantity();
-	BondPV01 new_productPV(productPv.GetProduct(), productPv.GetPV01(), newQt);
-	pv01Map[productId] = new_productPV;
+	// get the corresponding pv01
+	const ProductHandle<Bond>& product = position.GetProductHandle();
+	const BondPV01* found = pv01Map.Find(product);
+	const BondPV01& productPv = (found != nullptr) ? *found : pv01Map.Set(product, BondPV01(product, 0.0, 0));
+	double oldPv01 = productPv.GetPV01();
+	long oldQt = productPv.GetQuantity();
+
+	// Update the pv01 object in place, with the same quantity the books add up to in the tree
+	long newQt = position.GetAggregatePosition();
+	const BondPV01& new_productPV = pv01Map.Set(product, BondPV01(productPv.GetProductHandle(), productPv.GetPV01(), newQt));
+	ApplyBucketDelta(product, oldPv01, oldQt, new_productPV.GetPV01(), new_productPV.GetQuantity());
+	engine.Set(engine.AddProduct(product), new_productPV.GetPV01(), new_productPV.GetQuantity());
+
+	// only the books whose position changed move their path of the tree
+	if (riskTree != nullptr)
+	{
+		for (const auto& book : position.GetPositions())
+			riskTree->Update(product, book.first, book.second, new_productPV.GetPV01());
+	}
 
-	// call the listeners to update
+	// call the listeners to update, with a read-only view of the stored pv01
 	for (auto listener : listeners)
 		listener->ProcessUpdate(new_productPV);
 }
 
-void BondRiskService::UpdateBucketedRisk(const BucketedSector<Bond> &sector)
+const PV01Engine& BondRiskService::GetEngine() const
+{
+	return engine;
+}
+
+void BondRiskService::SetRiskTree(RiskTree *_riskTree)
 {
-	std::vector<Bond> products = sector.GetProducts();
-	string productId;
-	long long sum_qt = 0;
-	double sum_pv01 = 0.0;
+	riskTree = _riskTree;
+}
 
-	// calculate the overall pv01 and the overall quantity
-	for (Bond product : products)
+void BondRiskService::UpdatePV01s(const ProductHandle<Bond>* products, const double* pv01s, std::size_t count)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	for (std::size_t i = 0; i < count; i++)
+	{
+		const ProductHandle<Bond>& product = products[i];
+		if (pv01Map.Find(product) == nullptr)
+			continue; // not a product of this service
+
+		std::size_t row = engine.AddProduct(product);
+		if (row >= pendingPv01s.size())
+			pendingPv01s.resize(row + 1, std::nan(""));
+		if (std::isnan(pendingPv01s[row]))
+			pendingProducts.push_back(product);
+		pendingPv01s[row] = pv01s[i];
+	}
+}
+
+void BondRiskService::ApplyPendingPV01s()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	for (const ProductHandle<Bond>& product : pendingProducts)
 	{
-		productId = product.GetProductId();
+		std::size_t row = engine.AddProduct(product);
+		double pv01 = pendingPv01s[row];
+		pendingPv01s[row] = std::nan("");
+
+		BondPV01* productPv = pv01Map.Find(product);
+		double oldPv01 = productPv->GetPV01();
+		long qt = productPv->GetQuantity();
+		*productPv = BondPV01(productPv->GetProductHandle(), pv01, qt);
+		ApplyBucketDelta(product, oldPv01, qt, pv01, qt);
+		engine.Set(row, pv01, qt);
+		if (riskTree != nullptr)
+			riskTree->Reprice(product, pv01);
+	}
+	pendingProducts.clear();
+}
 
-		auto tempPV = pv01Map.at(productId);
-		auto tempQt = tempPV.GetQuantity();
+void BondRiskService::ApplyBucketDelta(const ProductHandle<Bond> &product, double oldPv01, long oldQt, double newPv01, long newQt)
+{
+	std::vector<std::size_t>* ids = productBuckets.Find(product);
+	if (ids == nullptr)
+		return;
+
+	for (std::size_t id : *ids)
+	{
+		BucketTotals& totals = bucketTotals[id];
+		totals.quantity += static_cast<long long>(newQt) - oldQt;
+		totals.pv01 += newPv01 * newQt - oldPv01 * oldQt;
+		totals.gross += std::abs(newPv01 * newQt) + std::abs(oldPv01 * oldQt);
+	}
+}
+
+void BondRiskService::SumBucket(const BucketedSector<Bond> &sector, long long &sum_qt, double &sum_pv01)
+{
+	sum_qt = 0;
+	sum_pv01 = 0.0;
+
+	// calculate the overall pv01 and the overall quantity
+	for (const Bond& product : sector.GetProducts())
+	{
+		const BondPV01& tempPV = pv01Map.At(product.GetProductId());
+		long tempQt = tempPV.GetQuantity();
 		sum_qt += tempQt;
 		sum_pv01 += tempPV.GetPV01() * tempQt;
 	}
+}
 
-	double unit_pv01 = 0.0;
-	if (sum_qt != 0)
-		unit_pv01 = sum_pv01 / sum_qt;
+std::size_t BondRiskService::AddBucket(const BucketedSector<Bond> &sector)
+{
+	auto iter = bucketIds.find(sector.GetName());
+	if (iter != bucketIds.end())
+		return iter->second;
+
+	// the totals start from a full sum, then only move by deltas
+	std::size_t id = bucketTotals.size();
+	ProductHandle<BucketedSector<Bond>> handle(sector);
+	BucketTotals totals{ handle, 0, 0.0, 0.0, PV01<BucketedSector<Bond>>(handle, 0.0, 0) };
+	SumBucket(sector, totals.quantity, totals.pv01);
+	totals.gross = std::abs(totals.pv01);
+	bucketTotals.push_back(totals);
+	bucketIds.emplace(sector.GetName(), id);
+
+	// a product listed twice adds to the totals twice, as in the full sum
+	for (const Bond& bond : sector.GetProducts())
+	{
+		const string& productId = bond.GetProductId();
+		ProductHandle<Bond> product = bondProductService->GetHandle(productId);
+		if (product.IsInterned())
+		{
+			productBuckets[product].push_back(id);
+			engine.AddToBucket(engine.AddProduct(product), id);
+		}
+		else
+			productBuckets[productId].push_back(id);
+	}
+	return id;
+}
 
-	PV01<BucketedSector<Bond>> bucketpv01(sector, unit_pv01, sum_qt);
+const std::vector<std::size_t>* BondRiskService::GetBuckets(const ProductHandle<Bond> &product) const
+{
+	return productBuckets.Find(product);
+}
 
-	// insert the data to the map
-	string name = sector.GetName();
-	if (bucketpv01Map.find(name) == bucketpv01Map.end()) 
-		// if this product does not exist before, creat one
-		bucketpv01Map.insert(std::make_pair(name, bucketpv01));
-	else
-		bucketpv01Map[name] = bucketpv01;
+void BondRiskService::UpdateBucketedRisk(const BucketedSector<Bond> &sector)
+{
+	UpdateBucketedRisk(AddBucket(sector));
 }
 
-const PV01<BucketedSector<Bond>>& BondRiskService::GetBucketedRisk(const BucketedSector<Bond> &sector) const
+const PV01<BucketedSector<Bond>>& BondRiskService::UpdateBucketedRisk(std::size_t id)
 {
-	std::string name = sector.GetName();
-	return bucketpv01Map.at(name);
+	BucketTotals& totals = bucketTotals[id];
+
+#ifndef NDEBUG
+	// the running totals agree with a full recompute, up to the rounding of the deltas
+	long long sum_qt;
+	double sum_pv01;
+	SumBucket(*totals.sector, sum_qt, sum_pv01);
+	assert(sum_qt == totals.quantity && std::abs(sum_pv01 - totals.pv01) <= 1e-9 * std::max(1.0, totals.gross));
+#endif
+
+	double unit_pv01 = 0.0;
+	if (totals.quantity != 0)
+		unit_pv01 = totals.pv01 / totals.quantity;
 
+	totals.risk = PV01<BucketedSector<Bond>>(totals.sector, unit_pv01, totals.quantity);
+	return totals.risk;
+}
+
+const PV01<BucketedSector<Bond>>& BondRiskService::GetBucketedRisk(const BucketedSector<Bond> &sector) const
+{
+	return bucketTotals[bucketIds.at(sector.GetName())].risk;
 }
 
 BondRiskListener::BondRiskListener(BondRiskService* _bondRiskService) :
@@ -171,6 +364,11 @@ void BondRiskListener::ProcessRemove(BondPos &_bondPos)
 }
 
 void BondRiskListener::ProcessUpdate(BondPos &_bondPos)
+{
+	ProcessUpdate(static_cast<const BondPos&>(_bondPos));
+}
+
+void BondRiskListener::ProcessUpdate(const BondPos &_bondPos)
 {
 	bondRiskService->AddPosition(_bondPos);
 }
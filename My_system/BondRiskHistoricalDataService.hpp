@@ -9,6 +9,10 @@
 #include "BondRisk.hpp"
 #include "products.hpp"
 #include "soa.hpp"
+#include "AsyncFileWriter.hpp"
+#include "HistoryStore.hpp"
+#include "ColumnarStore.hpp"
+#include <memory>
 #include "boost/date_time/posix_time/posix_time.hpp"
 #include "boost/date_time/gregorian/gregorian.hpp"
 #include <unordered_map>
@@ -29,9 +33,11 @@ protected:
 	BondRiskHistoricalDataConnector* bondRiskHistoricalDataConnector;
 	std::unordered_map<string, BondPV01> pv01Map; // key on product indentifier
 	std::unordered_map<string, PV01<BucketedSector<Bond>>> bucketpv01Map; // key on sector name
+	HistoryStore<BondPV01> history; // every persisted pv01 by time, key on product indentifier
+	HistoryStore<PV01<BucketedSector<Bond>>> bucketHistory; // every persisted bucketed pv01 by time, key on sector name
 
 public:
-	BondRiskHistoricalDataService(BondRiskHistoricalDataConnector*); // ctor
+	BondRiskHistoricalDataService(BondRiskHistoricalDataConnector*, std::size_t historyLimit = HISTORY_LIMIT); // ctor, keeps about historyLimit updates per key (0 keeps all)
 
 	// Get data on our service given a key : for a single bond
 	virtual BondPV01 & GetData(string);
@@ -51,22 +57,54 @@ public:
 
 	// Persist data to a store: for bucket sector
 	virtual void PersistData(string key, const PV01<BucketedSector<Bond>>&);
+
+	// Get the values persisted for a product with from <= time <= to, oldest first
+	std::vector<TimedValue<BondPV01>> GetHistory(const string&, RecordTime from, RecordTime to) const;
+
+	// Get the last n values persisted for a product, oldest first
+	std::vector<TimedValue<BondPV01>> GetLastUpdates(const string&, std::size_t n) const;
+
+	// Get the values persisted for a bucketed sector with from <= time <= to, oldest first
+	std::vector<TimedValue<PV01<BucketedSector<Bond>>>> GetBucketHistory(const string&, RecordTime from, RecordTime to) const;
+
+	// Get the last n values persisted for a bucketed sector, oldest first
+	std::vector<TimedValue<PV01<BucketedSector<Bond>>>> GetLastBucketUpdates(const string&, std::size_t n) const;
 };
 
 // corresponding publish connector
+// risk record queued for the writer, for a bond or (with an empty product) a bucketed sector
+struct RiskRecord
+{
+	RecordTime time;
+	ProductHandle<Bond> product;
+	std::string sector; // name of the bucketed sector
+	double pv01;
+	long quantity;
+};
+
 class BondRiskHistoricalDataConnector : public Connector<BondPV01>
 {
 protected:
-	fstream file;
+	std::unique_ptr<ColumnarWriter> columnar; // columnar output, before the writer that feeds it
+	std::unique_ptr<AsyncFileWriter<RiskRecord>> writer;
+
+	// Format a record into a line of the output file
+	static void Format(const RiskRecord&, std::string&);
+
+	// Append a record as a row of the columnar output
+	static void Append(const RiskRecord&, ColumnarWriter&);
 
 public:
-	BondRiskHistoricalDataConnector(string); // ctor
+	BondRiskHistoricalDataConnector(string, HistoricalFormat = TEXT_FORMAT); // ctor
 
 	// Publish data to the Connector: for single bond
 	virtual void Publish(PV01 <Bond> &);
 
+	// Publish data the service keeps resident to the Connector (only read)
+	virtual void Publish(const PV01 <Bond> &);
+
 	// Publish data to the Connector: for bucketed sector
-	virtual void Publish(PV01 <BucketedSector<Bond>> &);
+	virtual void Publish(const PV01 <BucketedSector<Bond>> &);
 
 };
 
@@ -76,8 +114,7 @@ class ToBondRiskHistoricalDataListener : public ServiceListener<BondPV01>
 protected:
 	BondProductService* bondProductService;
 	BondRiskHistoricalDataService* bondRiskHistoricalDataService;
-	BondRiskService* bondRiskService;
-	std::vector<BucketedSector<Bond>> buckets; // for buckets classification
+	BondRiskService* bondRiskService; // keeps the bucketed sectors and which products they hold
 
 public:
 	ToBondRiskHistoricalDataListener(BondProductService*, 
@@ -85,6 +122,11 @@ public:
 		BondRiskService* , 
 		std::unordered_map<std::string, std::vector<std::string>>&); // ctor
 
+	// keep the const and rvalue overloads of ServiceListener visible
+	using ServiceListener<BondPV01>::ProcessAdd;
+	using ServiceListener<BondPV01>::ProcessRemove;
+	using ServiceListener<BondPV01>::ProcessUpdate;
+
 	// Listener callback to process an add event to the Service
 	virtual void ProcessAdd(BondPV01 &);
 
@@ -93,14 +135,18 @@ public:
 
 	// Listener callback to process an update event to the Service
 	virtual void ProcessUpdate(BondPV01 &);
+
+	// Listener callback to process an update event to the Service, on the pv01 the risk service keeps (only read)
+	virtual void ProcessUpdate(const BondPV01 &);
 };
 
-BondRiskHistoricalDataService::BondRiskHistoricalDataService(BondRiskHistoricalDataConnector*_bondRiskHistoricalDataConnector) : bondRiskHistoricalDataConnector(_bondRiskHistoricalDataConnector)
+BondRiskHistoricalDataService::BondRiskHistoricalDataService(BondRiskHistoricalDataConnector*_bondRiskHistoricalDataConnector, std::size_t historyLimit) :
+	bondRiskHistoricalDataConnector(_bondRiskHistoricalDataConnector), history(historyLimit), bucketHistory(historyLimit)
 {}
 
 BondPV01 & BondRiskHistoricalDataService::GetData(string key)
 {
-	return pv01Map[key];
+	return pv01Map.at(key);
 }
 
 void BondRiskHistoricalDataService::OnMessage(BondPV01 &data)
@@ -123,11 +169,11 @@ void BondRiskHistoricalDataService::PersistData(string key, const BondPV01& data
 	if (pv01Map.find(key) == pv01Map.end()) // if not found this one then create one
 		pv01Map.insert(std::make_pair(key, data));
 	else
-		pv01Map[key] = data;
+		pv01Map.at(key) = data;
+	history.Append(key, RecordNow(), data);
 
 	// publish the data
-	BondPV01 temp(data);
-	bondRiskHistoricalDataConnector->Publish(temp);
+	bondRiskHistoricalDataConnector->Publish(data); // read-only view of the resident data
 
 }
 
@@ -137,36 +183,61 @@ void BondRiskHistoricalDataService::PersistData(string key, const PV01<BucketedS
 	if (bucketpv01Map.find(key) == bucketpv01Map.end()) // if not found this one then create one
 		bucketpv01Map.insert(std::make_pair(key, data));
 	else
-		bucketpv01Map[key] = data;
+		bucketpv01Map.at(key) = data;
+	bucketHistory.Append(key, RecordNow(), data);
 
 	// publish the data
-	PV01<BucketedSector<Bond>> temp(data);
-	bondRiskHistoricalDataConnector->Publish(temp);
+	bondRiskHistoricalDataConnector->Publish(data); // read-only view of the resident data
+}
+
+std::vector<TimedValue<BondPV01>> BondRiskHistoricalDataService::GetHistory(const string& key, RecordTime from, RecordTime to) const
+{
+	return history.GetRange(key, from, to);
+}
+
+std::vector<TimedValue<BondPV01>> BondRiskHistoricalDataService::GetLastUpdates(const string& key, std::size_t n) const
+{
+	return history.GetLast(key, n);
+}
+
+std::vector<TimedValue<PV01<BucketedSector<Bond>>>> BondRiskHistoricalDataService::GetBucketHistory(const string& key, RecordTime from, RecordTime to) const
+{
+	return bucketHistory.GetRange(key, from, to);
 }
 
-BondRiskHistoricalDataConnector::BondRiskHistoricalDataConnector(string _path) :
-	file(_path, std::ios::out | std::ios::trunc)
+std::vector<TimedValue<PV01<BucketedSector<Bond>>>> BondRiskHistoricalDataService::GetLastBucketUpdates(const string& key, std::size_t n) const
 {
-	// set the header of the output file
-	file << "Time,ProductIDType,ProductID,PV01,Quantity"<<endl;;
+	return bucketHistory.GetLast(key, n);
+}
+
+BondRiskHistoricalDataConnector::BondRiskHistoricalDataConnector(string _path, HistoricalFormat _format)
+{
+	if (_format == COLUMNAR_FORMAT)
+	{
+		columnar.reset(new ColumnarWriter(_path, { {"Time",COLUMN_TIME},{"ProductIDType",COLUMN_STRING},{"ProductID",COLUMN_STRING},
+			{"PV01",COLUMN_DOUBLE},{"Quantity",COLUMN_LONG} }, 0, 2));
+		writer.reset(new AsyncFileWriter<RiskRecord>([this](const RiskRecord& record) { Append(record, *columnar); }));
+	}
+	else
+		writer.reset(new AsyncFileWriter<RiskRecord>(_path, "Time,ProductIDType,ProductID,PV01,Quantity", &BondRiskHistoricalDataConnector::Format));
 }
 
 void BondRiskHistoricalDataConnector::Publish(BondPV01 &data)
 {
-	std::stringstream ss;
-	if (file.is_open())
+	Publish(static_cast<const BondPV01&>(data));
+}
+
+void BondRiskHistoricalDataConnector::Publish(const BondPV01 &data)
+{
+	if (writer->is_open())
 	{
-		// make the ingredent of the outout
-		auto time = boost::posix_time::microsec_clock::local_time(); // current time
-		std::string date = DatetoStr(time.date());
-		std::string timeofDay = boost::posix_time::to_simple_string(time.time_of_day());
-		timeofDay.erase(timeofDay.end() - 3, timeofDay.end());
-		Bond bond = data.GetProduct(); // get the product
-		std::string Idtype = (bond.GetBondIdType() == CUSIP) ? "CUSIP" : "ISIN"; // get the bond id type
-
-		// make the output
-		file << date << " " << timeofDay << "," << Idtype << "," << bond.GetProductId() << ","
-			<< std::to_string(data.GetPV01()) << "," << std::to_string(data.GetQuantity()) << ""<<endl;;
+		// queue the record, the writer thread formats it
+		RiskRecord record;
+		record.time = RecordNow();
+		record.product = data.GetProductHandle();
+		record.pv01 = data.GetPV01();
+		record.quantity = data.GetQuantity();
+		writer->Write(std::move(record));
 	}
 	else
 	{
@@ -174,20 +245,17 @@ void BondRiskHistoricalDataConnector::Publish(BondPV01 &data)
 	}
 }
 
-void BondRiskHistoricalDataConnector::Publish(PV01 <BucketedSector<Bond>> &data)
+void BondRiskHistoricalDataConnector::Publish(const PV01 <BucketedSector<Bond>> &data)
 {
-	if (file.is_open())
+	if (writer->is_open())
 	{
-		// make the ingredent of the outout
-		auto time = boost::posix_time::microsec_clock::local_time(); // current time
-		std::string date = DatetoStr(time.date());
-		std::string timeofDay = boost::posix_time::to_simple_string(time.time_of_day());
-		timeofDay.erase(timeofDay.end() - 3, timeofDay.end());
-		std::string Idtype = "Bucketed Sector"; // special id type
-
-		// make the output
-		file << date << " " << timeofDay << "," << Idtype << "," << data.GetProduct().GetName() << ","
-			<< std::to_string(data.GetPV01()) << "," << std::to_string(data.GetQuantity()) << ""<<endl;;
+		// queue the record, the writer thread formats it
+		RiskRecord record;
+		record.time = RecordNow();
+		record.sector = data.GetProduct().GetName();
+		record.pv01 = data.GetPV01();
+		record.quantity = data.GetQuantity();
+		writer->Write(std::move(record));
 	}
 	else
 	{
@@ -195,6 +263,49 @@ void BondRiskHistoricalDataConnector::Publish(PV01 <BucketedSector<Bond>> &data)
 	}
 }
 
+void BondRiskHistoricalDataConnector::Format(const RiskRecord &record, std::string &out)
+{
+	AppendTimestamp(out, record.time);
+	out += ',';
+	if (record.sector.empty())
+	{
+		const Bond& bond = *record.product; // get the product
+		out += (bond.GetBondIdType() == CUSIP) ? "CUSIP" : "ISIN"; // get the bond id type
+		out += ',';
+		out += bond.GetProductId();
+	}
+	else
+	{
+		out += "Bucketed Sector"; // special id type
+		out += ',';
+		out += record.sector;
+	}
+	out += ',';
+	out += std::to_string(record.pv01);
+	out += ',';
+	out += std::to_string(record.quantity);
+	out += '\n';
+}
+
+void BondRiskHistoricalDataConnector::Append(const RiskRecord &record, ColumnarWriter &out)
+{
+	out.SetTime(0, record.time);
+	if (record.sector.empty())
+	{
+		const Bond& bond = *record.product; // get the product
+		out.SetString(1, (bond.GetBondIdType() == CUSIP) ? "CUSIP" : "ISIN");
+		out.SetString(2, bond.GetProductId());
+	}
+	else
+	{
+		out.SetString(1, "Bucketed Sector"); // special id type
+		out.SetString(2, record.sector);
+	}
+	out.SetDouble(3, record.pv01);
+	out.SetLong(4, record.quantity);
+	out.EndRow();
+}
+
 ToBondRiskHistoricalDataListener::ToBondRiskHistoricalDataListener(BondProductService* _bondProductService,
 	BondRiskHistoricalDataService* _bondRiskHistoricalDataService, BondRiskService* _bondRiskService,
 	std::unordered_map<std::string, std::vector<std::string>>& _bucketMap) : bondProductService(_bondProductService),
@@ -206,7 +317,7 @@ ToBondRiskHistoricalDataListener::ToBondRiskHistoricalDataListener(BondProductSe
 		std::vector<Bond> bonds;
 		for (auto iter2 = iter->second.begin(); iter2 != iter->second.end(); iter2++)
 			bonds.push_back(bondProductService->GetData(*iter2));
-		buckets.push_back(BucketedSector<Bond>(bonds, iter->first));
+		bondRiskService->AddBucket(BucketedSector<Bond>(bonds, iter->first)); // the risk service keeps its totals from now on
 	}
 }
 
@@ -219,46 +330,33 @@ void ToBondRiskHistoricalDataListener::ProcessRemove(BondPV01 &data)
 }
 
 void ToBondRiskHistoricalDataListener::ProcessUpdate(BondPV01 &data)
+{
+	ProcessUpdate(static_cast<const BondPV01&>(data));
+}
+
+void ToBondRiskHistoricalDataListener::ProcessUpdate(const BondPV01 &data)
 { 
 	// persist data for the single product
 	string key = data.GetProduct().GetProductId();
 	bondRiskHistoricalDataService->PersistData(key, data);
 
-	// find the bucketed sector the product is in
-	std::vector<Bond> products;
-	bool status = false; // whether the bucketed sector is found
-	int index; // the index of the found bucketed sector in the buckets vector
-	int n = buckets.size(); // # of bucketed sector of the buckets vector
-	for (int i = 0; i< n;i++)
+	// the bucketed sectors the product is in
+	const std::vector<std::size_t>* ids = bondRiskService->GetBuckets(data.GetProductHandle());
+	if (ids == nullptr)
 	{
-		// find the bucket the product is in
-		products = buckets[i].GetProducts();
-		for (auto iter2 = products.begin(); iter2 != products.end(); iter2++)
-		{
-			if (iter2->GetProductId() == key) // if found
-			{
-				index = i;
-				status = true;
-				break;
-			}
-		}
-		
-		if (status) // if already found
-			break;
+		std::cout << "Can not find bucketed sector for the underlying product of this risk update!" << endl;
+		return;
 	}
 
-	// generate the corresponding bucketed risk update and persist it via the service
-	if (status) // if found
-	{
-		bondRiskService->UpdateBucketedRisk(buckets[index]); // update the bucketed risk
-		PV01<BucketedSector<Bond>> bucketpv01 = bondRiskService->GetBucketedRisk(buckets[index]);
-		bondRiskHistoricalDataService->PersistData(buckets[index].GetName(), bucketpv01);
-	}
-	else
+	// generate the corresponding bucketed risk updates and persist them via the service, once
+	// per sector (a product listed twice in a sector repeats its id)
+	for (std::size_t i = 0; i < ids->size(); i++)
 	{
-		std::cout << "Can not find bucketed sector for the underlying product of this risk update!" << endl;
+		if (i > 0 && (*ids)[i] == (*ids)[i - 1])
+			continue;
+		const PV01<BucketedSector<Bond>>& bucketpv01 = bondRiskService->UpdateBucketedRisk((*ids)[i]);
+		bondRiskHistoricalDataService->PersistData(bucketpv01.GetProduct().GetName(), bucketpv01);
 	}
-
 }
 
 #endif // !BONDRISKHISTORICALDATASOA_HPP
@@ -8,15 +8,16 @@
 #include "BondAlgoStreaming.hpp"
 #include "products.hpp"
 #include "soa.hpp"
+#include "ProductStore.hpp"
 #include <unordered_map>
 
-class BondStreamingService : public StreamingService<Bond>
+class BondStreamingService final : public StreamingService<Bond>
 {
 	typedef ServiceListener<Bond_Ps> myListener;
 	typedef vector<myListener*> Listener_container;
 protected:
 	Listener_container listeners;
-	std::unordered_map<string, Bond_Ps> stream_Map; // key on product identifier
+	ProductStore<Bond, Bond_Ps> stream_Map; // slot on the interned product id
 public:
 	BondStreamingService() {};
 
@@ -38,7 +39,7 @@ public:
 };
 
 // Bond streaming service listener
-class ToBondStreamingListener : public ServiceListener<Bond_Ags>
+class ToBondStreamingListener final : public ServiceListener<Bond_Ags>
 {
 protected:
 	BondStreamingService* bondStreamingService;
@@ -46,6 +47,11 @@ protected:
 public:
 	ToBondStreamingListener(BondStreamingService* );
 
+	// keep the const and rvalue overloads of ServiceListener visible
+	using ServiceListener<Bond_Ags>::ProcessAdd;
+	using ServiceListener<Bond_Ags>::ProcessRemove;
+	using ServiceListener<Bond_Ags>::ProcessUpdate;
+
 	// Listener callback to process an add event to the Service
 	virtual void ProcessAdd(Bond_Ags &);
 
@@ -54,11 +60,14 @@ public:
 
 	// Listener callback to process an update event to the Service
 	virtual void ProcessUpdate(Bond_Ags &);
+
+	// Listener callback to process an update event to the Service, on a read-only view of its data
+	virtual void ProcessUpdate(const Bond_Ags &);
 };
 
 Bond_Ps & BondStreamingService::GetData(string key)
 {
-	return stream_Map[key];
+	return stream_Map.At(key);
 }
 
 void BondStreamingService::OnMessage(Bond_Ps &_Bond_Ps)
@@ -79,16 +88,11 @@ const BondStreamingService::Listener_container& BondStreamingService::GetListene
 void BondStreamingService::PublishPrice(const Bond_Ps& priceStream)
 {
 	// push data to the map
-	string pd_id = priceStream.GetProduct().GetProductId();
-	if (stream_Map.find(pd_id) == stream_Map.end()) // if not found this one then create one
-		stream_Map.insert(std::make_pair(pd_id, priceStream));
-	else
-		stream_Map[pd_id] = priceStream;
-
-	// call the listeners
-	Bond_Ps temp_Bond_Ps(priceStream);
+	stream_Map.Set(priceStream.GetProductHandle(), priceStream);
+
+	// call the listeners, they get a read-only view of the price stream
 	for (auto private_l : listeners)
-		private_l->ProcessAdd(temp_Bond_Ps);
+		private_l->ProcessAdd(priceStream);
 }
 
 ToBondStreamingListener::ToBondStreamingListener(BondStreamingService* _bondStreamingService):
@@ -105,9 +109,14 @@ void ToBondStreamingListener::ProcessRemove(Bond_Ags &_bond_Ags)
 }
 
 void ToBondStreamingListener::ProcessUpdate(Bond_Ags &_bond_Ags)
+{
+	ProcessUpdate(static_cast<const Bond_Ags&>(_bond_Ags));
+}
+
+void ToBondStreamingListener::ProcessUpdate(const Bond_Ags &_bond_Ags)
 {
 	// publish the price stream
-	Bond_Ps stream = _bond_Ags.GetStream();
+	const Bond_Ps& stream = _bond_Ags.GetStream();
 	bondStreamingService->PublishPrice(stream);
 }
 
@@ -9,6 +9,10 @@
 #include "BondStreaming.hpp"
 #include "products.hpp"
 #include "soa.hpp"
+#include "AsyncFileWriter.hpp"
+#include "HistoryStore.hpp"
+#include "ColumnarStore.hpp"
+#include <memory>
 #include "boost/date_time/posix_time/posix_time.hpp"
 #include "boost/date_time/gregorian/gregorian.hpp"
 #include <unordered_map>
@@ -27,9 +31,10 @@ protected:
 	listener_container listeners;
 	Connector<Bond_Ps>* bondStreamingHistoricalDataConnector;
 	std::unordered_map<string, Bond_Ps> stream_Map; // key on product indentifier
+	HistoryStore<Bond_Ps> history; // every persisted stream by time, key on product indentifier
 
 public:
-	BondStreamingHistoricalDataService(Connector<Bond_Ps>* _bondStreamingHistoricalDataConnector);
+	BondStreamingHistoricalDataService(Connector<Bond_Ps>* _bondStreamingHistoricalDataConnector, std::size_t historyLimit = HISTORY_LIMIT); // keeps about historyLimit streams per product (0 keeps all)
 
 	// Get data on our service given a key
 	virtual Bond_Ps & GetData(string);
@@ -46,25 +51,54 @@ public:
 
 	// Persist data to a store
 	virtual void PersistData(string, const Bond_Ps&);
+
+	// Get the values persisted for a product with from <= time <= to, oldest first
+	std::vector<TimedValue<Bond_Ps>> GetHistory(const string&, RecordTime from, RecordTime to) const;
+
+	// Get the last n values persisted for a product, oldest first
+	std::vector<TimedValue<Bond_Ps>> GetLastUpdates(const string&, std::size_t n) const;
 };
 
 // corresponding publish connector
+// price stream record queued for the writer
+struct StreamingRecord
+{
+	RecordTime time;
+	ProductHandle<Bond> product;
+	double bidPrice;
+	long bidVisibleQuantity;
+	long bidHiddenQuantity;
+	double offerPrice;
+	long offerVisibleQuantity;
+	long offerHiddenQuantity;
+};
+
 class BondStreamingHistoricalDataConnector : public Connector<PriceStream<Bond>>
 {
 	typedef PriceStream<Bond> Bond_Ps;
 
 protected:
-	fstream file;
+	std::unique_ptr<ColumnarWriter> columnar; // columnar output, before the writer that feeds it
+	std::unique_ptr<AsyncFileWriter<StreamingRecord>> writer;
+
+	// Format a record into a line of the output file
+	static void Format(const StreamingRecord&, std::string&);
+
+	// Append a record as a row of the columnar output
+	static void Append(const StreamingRecord&, ColumnarWriter&);
 public:
-	BondStreamingHistoricalDataConnector(string path);
+	BondStreamingHistoricalDataConnector(string path, HistoricalFormat format = TEXT_FORMAT);
 
 	// Publish data to the Connector
 	virtual void Publish(Bond_Ps &data);
 
+	// Publish data the service keeps resident to the Connector (only read)
+	virtual void Publish(const Bond_Ps &data);
+
 };
 
 // corresponding service listener
-class ToBondStreamingHistoricalDataListener : public ServiceListener<Bond_Ps>
+class ToBondStreamingHistoricalDataListener final : public ServiceListener<Bond_Ps>
 {
 
 protected:
@@ -73,6 +107,11 @@ protected:
 public:
 	ToBondStreamingHistoricalDataListener(BondStreamingHistoricalDataService*);
 
+	// keep the const and rvalue overloads of ServiceListener visible
+	using ServiceListener<Bond_Ps>::ProcessAdd;
+	using ServiceListener<Bond_Ps>::ProcessRemove;
+	using ServiceListener<Bond_Ps>::ProcessUpdate;
+
 	// Listener callback to process an add event to the Service
 	virtual void ProcessAdd(Bond_Ps &);
 
@@ -81,14 +120,17 @@ public:
 
 	// Listener callback to process an update event to the Service
 	virtual void ProcessUpdate(Bond_Ps &);
+
+	// Listener callback to process an add event to the Service, on a read-only view of its data
+	virtual void ProcessAdd(const Bond_Ps &);
 };
 
-BondStreamingHistoricalDataService::BondStreamingHistoricalDataService(Connector<Bond_Ps>* _bondStreamingHistoricalDataConnector) :
-	bondStreamingHistoricalDataConnector(_bondStreamingHistoricalDataConnector) {}
+BondStreamingHistoricalDataService::BondStreamingHistoricalDataService(Connector<Bond_Ps>* _bondStreamingHistoricalDataConnector, std::size_t historyLimit) :
+	bondStreamingHistoricalDataConnector(_bondStreamingHistoricalDataConnector), history(historyLimit) {}
 
 Bond_Ps & BondStreamingHistoricalDataService::GetData(string key)
 {
-	return stream_Map[key];
+	return stream_Map.at(key);
 }
 
 void BondStreamingHistoricalDataService::OnMessage(Bond_Ps &data)
@@ -112,48 +154,61 @@ void BondStreamingHistoricalDataService::PersistData(string key, const Bond_Ps&
 	if (stream_Map.find(key) == stream_Map.end()) // if not found this one then create one
 		stream_Map.insert(std::make_pair(key, data));
 	else
-		stream_Map[key] = data;
+		stream_Map.at(key) = data;
+	history.Append(key, RecordNow(), data);
 
 	// publish the data
-	Bond_Ps temp_Bond_Ps(data);
-	bondStreamingHistoricalDataConnector->Publish(temp_Bond_Ps);
+	bondStreamingHistoricalDataConnector->Publish(data); // read-only view of the resident data
 
 }
 
-BondStreamingHistoricalDataConnector::BondStreamingHistoricalDataConnector(string _path) :
-	file(_path, std::ios::out | std::ios::trunc)
+std::vector<TimedValue<Bond_Ps>> BondStreamingHistoricalDataService::GetHistory(const string& key, RecordTime from, RecordTime to) const
 {
-	// set the header of the output file
-	file << "Time,BondIDType,BondID,BidPrice,BidVisibleQuantity,BidHiddenQuantity,"
-		<< "OfferPrice,OfferVisibleQuantity,OfferHiddenQuantity" << endl;
+	return history.GetRange(key, from, to);
 }
 
-void BondStreamingHistoricalDataConnector::Publish(Bond_Ps &_Bond_Ps)
+std::vector<TimedValue<Bond_Ps>> BondStreamingHistoricalDataService::GetLastUpdates(const string& key, std::size_t n) const
 {
-	if (file.is_open())
-	{
-		// make the ingredent of the outout
-		auto time = boost::posix_time::microsec_clock::local_time(); // current time
-		std::string _date = DatetoStr(time.date());
-
-		std::string _time = boost::posix_time::to_simple_string(time.time_of_day());
-		_time.erase(_time.end() - 3, _time.end());
-
-		Bond _bond = _Bond_Ps.GetProduct();
+	return history.GetLast(key, n);
+}
 
-		// get the bond id type
-		std::string Idtype = (_bond.GetBondIdType() == ISIN) ? "ISIN" : "CUSIP";
+BondStreamingHistoricalDataConnector::BondStreamingHistoricalDataConnector(string _path, HistoricalFormat _format)
+{
+	if (_format == COLUMNAR_FORMAT)
+	{
+		columnar.reset(new ColumnarWriter(_path, { {"Time",COLUMN_TIME},{"BondIDType",COLUMN_STRING},{"BondID",COLUMN_STRING},
+			{"BidPrice",COLUMN_DOUBLE},{"BidVisibleQuantity",COLUMN_LONG},{"BidHiddenQuantity",COLUMN_LONG},
+			{"OfferPrice",COLUMN_DOUBLE},{"OfferVisibleQuantity",COLUMN_LONG},{"OfferHiddenQuantity",COLUMN_LONG} }, 0, 2));
+		writer.reset(new AsyncFileWriter<StreamingRecord>([this](const StreamingRecord& record) { Append(record, *columnar); }));
+	}
+	else
+		writer.reset(new AsyncFileWriter<StreamingRecord>(_path, "Time,BondIDType,BondID,BidPrice,BidVisibleQuantity,BidHiddenQuantity,"
+			"OfferPrice,OfferVisibleQuantity,OfferHiddenQuantity", &BondStreamingHistoricalDataConnector::Format));
+}
 
-		auto _bidOrder = _Bond_Ps.GetBidOrder();
-		auto _offerOrder = _Bond_Ps.GetOfferOrder();
+void BondStreamingHistoricalDataConnector::Publish(Bond_Ps &_Bond_Ps)
+{
+	Publish(static_cast<const Bond_Ps&>(_Bond_Ps));
+}
 
-		file << _date << " " << _time << "," << Idtype << "," << _bond.GetProductId() << ","
-			<< std::to_string(_bidOrder.GetPrice()) << ","
-			<< std::to_string(_bidOrder.GetVisibleQuantity()) << ","
-			<< std::to_string(_bidOrder.GetHiddenQuantity()) << ","
-			<< std::to_string(_offerOrder.GetPrice()) << ","
-			<< std::to_string(_offerOrder.GetVisibleQuantity()) << ","
-			<< std::to_string(_offerOrder.GetHiddenQuantity()) << endl;
+void BondStreamingHistoricalDataConnector::Publish(const Bond_Ps &_Bond_Ps)
+{
+	if (writer->is_open())
+	{
+		// queue the record, the writer thread formats it
+		const PriceStreamOrder& _bidOrder = _Bond_Ps.GetBidOrder();
+		const PriceStreamOrder& _offerOrder = _Bond_Ps.GetOfferOrder();
+
+		StreamingRecord record;
+		record.time = RecordNow();
+		record.product = _Bond_Ps.GetProductHandle();
+		record.bidPrice = _bidOrder.GetPrice();
+		record.bidVisibleQuantity = _bidOrder.GetVisibleQuantity();
+		record.bidHiddenQuantity = _bidOrder.GetHiddenQuantity();
+		record.offerPrice = _offerOrder.GetPrice();
+		record.offerVisibleQuantity = _offerOrder.GetVisibleQuantity();
+		record.offerHiddenQuantity = _offerOrder.GetHiddenQuantity();
+		writer->Write(std::move(record));
 	}
 	else
 	{
@@ -161,11 +216,56 @@ void BondStreamingHistoricalDataConnector::Publish(Bond_Ps &_Bond_Ps)
 	}
 }
 
+void BondStreamingHistoricalDataConnector::Format(const StreamingRecord &record, std::string &out)
+{
+	const Bond& _bond = *record.product;
+
+	AppendTimestamp(out, record.time);
+	out += ',';
+	out += (_bond.GetBondIdType() == ISIN) ? "ISIN" : "CUSIP"; // get the bond id type
+	out += ',';
+	out += _bond.GetProductId();
+	out += ',';
+	out += std::to_string(record.bidPrice);
+	out += ',';
+	out += std::to_string(record.bidVisibleQuantity);
+	out += ',';
+	out += std::to_string(record.bidHiddenQuantity);
+	out += ',';
+	out += std::to_string(record.offerPrice);
+	out += ',';
+	out += std::to_string(record.offerVisibleQuantity);
+	out += ',';
+	out += std::to_string(record.offerHiddenQuantity);
+	out += '\n';
+}
+
+void BondStreamingHistoricalDataConnector::Append(const StreamingRecord &record, ColumnarWriter &out)
+{
+	const Bond& _bond = *record.product;
+
+	out.SetTime(0, record.time);
+	out.SetString(1, (_bond.GetBondIdType() == ISIN) ? "ISIN" : "CUSIP");
+	out.SetString(2, _bond.GetProductId());
+	out.SetDouble(3, record.bidPrice);
+	out.SetLong(4, record.bidVisibleQuantity);
+	out.SetLong(5, record.bidHiddenQuantity);
+	out.SetDouble(6, record.offerPrice);
+	out.SetLong(7, record.offerVisibleQuantity);
+	out.SetLong(8, record.offerHiddenQuantity);
+	out.EndRow();
+}
+
 ToBondStreamingHistoricalDataListener::ToBondStreamingHistoricalDataListener(
 	BondStreamingHistoricalDataService* _bondStreamingHistoricalDataService) :
 	bondStreamingHistoricalDataService(_bondStreamingHistoricalDataService) {}
 
 void ToBondStreamingHistoricalDataListener::ProcessAdd(Bond_Ps &_bond_Ps)
+{
+	ProcessAdd(static_cast<const Bond_Ps&>(_bond_Ps));
+}
+
+void ToBondStreamingHistoricalDataListener::ProcessAdd(const Bond_Ps &_bond_Ps)
 {
 	string key = _bond_Ps.GetProduct().GetProductId();
 	bondStreamingHistoricalDataService->PersistData(key, _bond_Ps);
@@ -10,6 +10,8 @@
 #include "products.hpp"
 #include "soa.hpp"
 #include "productservice.hpp"
+#include "LineTokenizer.hpp"
+#include "PriceCodec.hpp"
 #include "boost/algorithm/string.hpp" 
 #include "boost/date_time/gregorian/gregorian.hpp" 
 #include <vector>
@@ -64,7 +66,8 @@ protected:
 
 public:
 	BondTradeBookingConnector(string path,
-		Service<string, BondTrade>* _bondTradeBookingService, BondProductService* _bondProductService); // ctor
+		Service<string, BondTrade>* _bondTradeBookingService, BondProductService* _bondProductService,
+		IngestionMode mode = STREAMED); // ctor
 
 	// Publish data to the Connector
 	virtual void Publish(BondTrade &data);
@@ -81,6 +84,11 @@ protected:
 public:
 	ToBondTradeBookingListener(BondTradeBookingService* _bondTradeBookingService); // ctor
 
+	// keep the const and rvalue overloads of ServiceListener visible
+	using ServiceListener<Bond_ExOrder>::ProcessAdd;
+	using ServiceListener<Bond_ExOrder>::ProcessRemove;
+	using ServiceListener<Bond_ExOrder>::ProcessUpdate;
+
 	// Listener callback to process an add event to the Service
 	virtual void ProcessAdd(Bond_ExOrder &data);
 
@@ -89,11 +97,14 @@ public:
 
 	// Listener callback to process an update event to the Service
 	virtual void ProcessUpdate(Bond_ExOrder &data);
+
+	// Listener callback to process an add event to the Service, on a read-only view of its data
+	virtual void ProcessAdd(const Bond_ExOrder &);
 };
 
 BondTrade & BondTradeBookingService::GetData(string key)
 {
-	return tradeMap[key];
+	return tradeMap.at(key);
 
 }
 
@@ -116,17 +127,12 @@ const BondTradeBookingService::listener_container& BondTradeBookingService::GetL
 
 void BondTradeBookingService::BookTrade(const BondTrade &trade)
 {
-	string tradeId = trade.GetTradeId();
-	if (tradeMap.find(tradeId) == tradeMap.end()) // if not found this one then create one
-		tradeMap.insert(std::make_pair(tradeId, trade));
-	else
-		tradeMap[tradeId] = trade;
+	tradeMap.insert_or_assign(trade.GetTradeId(), trade); // create or replace in one lookup
 	++counter;
 
-	// call the listeners
-	BondTrade temp(trade);
+	// call the listeners, they get a read-only view of the trade
 	for (auto private_l : listeners)
-		private_l->ProcessUpdate(temp);
+		private_l->ProcessUpdate(trade);
 }
 
 const long BondTradeBookingService::GetCounter() const
@@ -135,49 +141,37 @@ const long BondTradeBookingService::GetCounter() const
 }
 
 BondTradeBookingConnector::BondTradeBookingConnector(
-	string path, Service<string, BondTrade>* _bondTradeBookingService, BondProductService* _bondProductService) :
+	string path, Service<string, BondTrade>* _bondTradeBookingService, BondProductService* _bondProductService,
+	IngestionMode mode) :
 	bondTradeBookingService(_bondTradeBookingService)
 {
-	fstream file(path, std::ios::in);
-	string line;
-	std::stringstream ss;
-	char sep = ','; // comma seperator
+	// trade id, id type, id, side, quantity, price, book
+	LineTokenizer<7> cells(path, mode);
 
-	if (file.is_open())
+	if (cells.is_open())
 	{
 		std::cout << "Trade: Begin to read data..."<<endl;;
-		getline(file, line); // discard header
+		cells.Next(); // discard header
 
-		while (getline(file, line))
+		while (cells.Next())
 		{
-			stringstream lineStream(line);
-
-			// save all data into a vector of strings
-			std::vector<string> cells;
-			string cell;
-			while (getline(lineStream, cell, sep))
-			{
-				boost::algorithm::trim(cell);
-				cells.push_back(cell);
-			}
+			if (cells.Size() < 7) // truncated line
+				continue;
 
 			// build the corresponding BondTrade object
 			// tradeId
-			string tradeId = cells[0];
-			// bond Id
-			BondIdType type = (boost::algorithm::to_upper_copy(cells[1]) == "CUSIP") ? CUSIP : ISIN;
-			string bondId = cells[2];
+			string tradeId(cells[0]);
 			// the bond product
-			Bond bond = _bondProductService->GetData(bondId); 
+			ProductHandle<Bond> bond = _bondProductService->GetHandle(string(cells[2]));
 
 			// trade side
-			Side side = (boost::algorithm::to_upper_copy(cells[3]) == "BUY") ? BUY : SELL;
+			Side side = boost::algorithm::iequals(cells[3], "BUY") ? BUY : SELL;
 
-			long quantity = std::stol(cells[4]);
+			long quantity = FieldtoLong(cells[4]);
 
-			double price = StrtoPrice(cells[5]);
+			double price = ParsePrice(cells[5]);
 			// book id
-			string bookId = cells[6];
+			string bookId(cells[6]);
 
 			// BondTade object
 			BondTrade trade(bond, tradeId, price, bookId, quantity, side);
@@ -202,11 +196,16 @@ ToBondTradeBookingListener::ToBondTradeBookingListener(BondTradeBookingService*
 
 
 void ToBondTradeBookingListener::ProcessAdd(Bond_ExOrder &_bond_ExOrder)
+{
+	ProcessAdd(static_cast<const Bond_ExOrder&>(_bond_ExOrder));
+}
+
+void ToBondTradeBookingListener::ProcessAdd(const Bond_ExOrder &_bond_ExOrder)
 {
 	// Determine the atributes of the trade
 	long counter = bondTradeBookingService->GetCounter();
 	string books[3]{ "TRSY1","TRSY2" ,"TRSY3" };
-	Bond bond = _bond_ExOrder.GetProduct();
+	const Bond& bond = _bond_ExOrder.GetProduct();
 
 	// Trade ID (e.g. TRADE2024T23)
 	
@@ -217,7 +216,7 @@ void ToBondTradeBookingListener::ProcessAdd(Bond_ExOrder &_bond_ExOrder)
 	Side side = (_bond_ExOrder.GetSide() == BID) ? SELL : BUY;
 
 	// generate a trade based on the coming execution order
-	BondTrade trade(_bond_ExOrder.GetProduct(), tradeId, _bond_ExOrder.GetPrice(), bookId,
+	BondTrade trade(_bond_ExOrder.GetProductHandle(), tradeId, _bond_ExOrder.GetPrice(), bookId,
 		_bond_ExOrder.GetHiddenQuantity() + _bond_ExOrder.GetVisibleQuantity(), side);
 
 	// book the trade
@@ -5,6 +5,7 @@
 
 #include "productservice.hpp"
 #include "products.hpp"
+#include "PriceCodec.hpp"
 #include <string>
 #include <iostream>
 #include <vector>
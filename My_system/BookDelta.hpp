@@ -0,0 +1,109 @@
+// BookDelta
+// incremental market data message for one product: a list of level inserts,
+// updates and deletes, optionally applied to a cleared book (a snapshot)
+// Type T is the product type
+
+#ifndef BOOKDELTA_HPP
+#define BOOKDELTA_HPP
+
+#include "marketdataservice.hpp"
+#include "ProductHandle.hpp"
+#include "products.hpp"
+#include <vector>
+
+// change applied to a price level
+enum LevelAction { LEVEL_INSERT, LEVEL_UPDATE, LEVEL_DELETE };
+
+// one level change, prices in ticks of 1/256
+struct LevelDelta
+{
+	LevelAction action;
+	PricingSide side;
+	long ticks;
+	long quantity; // new quantity of the level, 0 for a delete
+};
+
+template<typename T>
+class BookDelta
+{
+private:
+	ProductHandle<T> product;
+	bool snapshot; // the book is cleared before the levels are applied
+	std::vector<LevelDelta> levels;
+
+public:
+	BookDelta(); // empty delta
+	BookDelta(const ProductHandle<T>& _product, bool _snapshot = false);
+
+	// Get the product
+	const T& GetProduct() const;
+
+	// Get the interned product handle
+	const ProductHandle<T>& GetProductHandle() const;
+
+	// Whether this delta replaces the whole book
+	bool IsSnapshot() const;
+
+	// Get the level changes, in the order they apply
+	const std::vector<LevelDelta>& GetLevels() const;
+
+	// Append a level change
+	void AddLevel(LevelAction action, PricingSide side, long ticks, long quantity);
+
+	// Start a new delta for a product, keeping the level storage
+	void Reset(const ProductHandle<T>& _product, bool _snapshot = false);
+};
+
+template<typename T>
+BookDelta<T>::BookDelta() :
+	snapshot(false)
+{
+}
+
+template<typename T>
+BookDelta<T>::BookDelta(const ProductHandle<T>& _product, bool _snapshot) :
+	product(_product), snapshot(_snapshot)
+{
+}
+
+template<typename T>
+const T& BookDelta<T>::GetProduct() const
+{
+	return *product;
+}
+
+template<typename T>
+const ProductHandle<T>& BookDelta<T>::GetProductHandle() const
+{
+	return product;
+}
+
+template<typename T>
+bool BookDelta<T>::IsSnapshot() const
+{
+	return snapshot;
+}
+
+template<typename T>
+const std::vector<LevelDelta>& BookDelta<T>::GetLevels() const
+{
+	return levels;
+}
+
+template<typename T>
+void BookDelta<T>::AddLevel(LevelAction action, PricingSide side, long ticks, long quantity)
+{
+	levels.push_back(LevelDelta{ action, side, ticks, quantity });
+}
+
+template<typename T>
+void BookDelta<T>::Reset(const ProductHandle<T>& _product, bool _snapshot)
+{
+	product = _product;
+	snapshot = _snapshot;
+	levels.clear();
+}
+
+typedef BookDelta<Bond> BondBookDelta;
+
+#endif // !BOOKDELTA_HPP
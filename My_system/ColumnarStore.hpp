@@ -0,0 +1,658 @@
+// ColumnarStore
+// append-only columnar binary format for the historical services, with its writer,
+// reader and converter back to CSV
+// rows are buffered into blocks; each block is written column after column, so a
+// reader can decode only the columns it needs; the footer holds the schema, the
+// string dictionary and an index of every block (column offsets, time range, products)
+//
+// layout (native little-endian): "BHCS" version | blocks | footer | footer offset "BHCS"
+// with COMPRESSION_DELTA the integer columns (times, quantities, prices in ticks,
+// dictionary codes) are stored as zigzag varints of the difference to the previous row
+
+#ifndef COLUMNARSTORE_HPP
+#define COLUMNARSTORE_HPP
+
+#include "MappedFile.hpp"
+#include "PriceCodec.hpp"
+#include "TimestampFormatter.hpp"
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+
+// type of a column
+enum ColumnType
+{
+	COLUMN_TIME, // RecordTime, stored in microseconds since the epoch
+	COLUMN_LONG, // integer
+	COLUMN_DOUBLE, // double, written to CSV with std::to_string
+	COLUMN_PRICE, // price stored in ticks, written to CSV in fractional notation
+	COLUMN_STRING // dictionary encoded string
+};
+
+// encoding of the integer columns
+enum ColumnCompression { COMPRESSION_NONE, COMPRESSION_DELTA };
+
+// output format of a historical connector
+enum HistoricalFormat { TEXT_FORMAT, COLUMNAR_FORMAT };
+
+struct ColumnSpec
+{
+	std::string name;
+	ColumnType type;
+};
+
+// index entry of a block
+struct BlockInfo
+{
+	std::uint64_t offset; // file offset of the first column
+	std::uint32_t rows;
+	std::int64_t minTime; // time range of the rows, in microseconds since the epoch
+	std::int64_t maxTime;
+	std::vector<std::uint32_t> products; // dictionary codes of the products in the block, sorted
+	std::vector<std::uint64_t> columnOffsets; // file offset of each column
+	std::vector<std::uint64_t> columnLengths; // byte length of each column
+};
+
+const char COLUMNAR_MAGIC[4] = { 'B','H','C','S' };
+const std::uint32_t COLUMNAR_VERSION = 1;
+
+// Append a zigzag varint
+inline void PutVarint(std::string& out, std::int64_t value)
+{
+	std::uint64_t v = (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+	while (v >= 0x80)
+	{
+		out += static_cast<char>((v & 0x7f) | 0x80);
+		v >>= 7;
+	}
+	out += static_cast<char>(v);
+}
+
+// Read a zigzag varint, advancing p
+inline std::int64_t GetVarint(const char*& p)
+{
+	std::uint64_t v = 0;
+	int shift = 0;
+	while (true)
+	{
+		std::uint8_t byte = static_cast<std::uint8_t>(*p++);
+		v |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+		if (byte < 0x80)
+			break;
+		shift += 7;
+	}
+	return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+}
+
+// Append the raw bytes of a value
+template<typename X>
+inline void PutRaw(std::string& out, X value)
+{
+	out.append(reinterpret_cast<const char*>(&value), sizeof(X));
+}
+
+// Read the raw bytes of a value, advancing p
+template<typename X>
+inline X GetRaw(const char*& p)
+{
+	X value;
+	std::memcpy(&value, p, sizeof(X));
+	p += sizeof(X);
+	return value;
+}
+
+// Writer of a columnar file, one row at a time: Set() every column, then EndRow()
+class ColumnarWriter
+{
+private:
+	std::FILE* file;
+	std::vector<ColumnSpec> columns;
+	int timeColumn; // column indexed by time, -1 if none
+	int productColumn; // column indexed by product, -1 if none
+	ColumnCompression compression;
+	std::size_t blockRows;
+
+	std::vector< std::vector<std::int64_t> > values; // integer columns of the current block
+	std::vector< std::vector<double> > reals; // double columns of the current block
+	std::unordered_map<std::string, std::uint32_t> codes; // string dictionary
+	std::vector<std::string> dictionary;
+	std::vector<BlockInfo> blocks;
+	std::uint64_t offset;
+	std::string buffer;
+
+	// Write the current block and index it
+	void WriteBlock();
+
+	// Write the footer
+	void WriteFooter();
+
+public:
+	ColumnarWriter(const std::string& path, const std::vector<ColumnSpec>& _columns, int _timeColumn = 0, int _productColumn = -1,
+		ColumnCompression _compression = COMPRESSION_DELTA, std::size_t _blockRows = 1 << 16); // ctor
+	~ColumnarWriter(); // closes the file
+
+	// Whether the file is open
+	bool is_open() const;
+
+	// Set a column of the current row
+	void SetTime(std::size_t column, RecordTime value);
+	void SetLong(std::size_t column, long value);
+	void SetDouble(std::size_t column, double value);
+	void SetPrice(std::size_t column, double value);
+	void SetString(std::size_t column, std::string_view value);
+
+	// Finish the current row
+	void EndRow();
+
+	// Write the last block and the footer, then close the file
+	void Close();
+};
+
+inline ColumnarWriter::ColumnarWriter(const std::string& path, const std::vector<ColumnSpec>& _columns, int _timeColumn, int _productColumn,
+	ColumnCompression _compression, std::size_t _blockRows) :
+	file(std::fopen(path.c_str(), "wb")), columns(_columns), timeColumn(_timeColumn), productColumn(_productColumn),
+	compression(_compression), blockRows(_blockRows), values(_columns.size()), reals(_columns.size()), offset(0)
+{
+	if (file == nullptr)
+	{
+		std::cout << "Cannot open the file!" << std::endl;
+		return;
+	}
+
+	buffer.append(COLUMNAR_MAGIC, 4);
+	PutRaw(buffer, COLUMNAR_VERSION);
+	std::fwrite(buffer.data(), 1, buffer.size(), file);
+	offset = buffer.size();
+}
+
+inline ColumnarWriter::~ColumnarWriter()
+{
+	Close();
+}
+
+inline bool ColumnarWriter::is_open() const
+{
+	return file != nullptr;
+}
+
+inline void ColumnarWriter::SetTime(std::size_t column, RecordTime value)
+{
+	values[column].push_back(std::chrono::duration_cast<std::chrono::microseconds>(value.time_since_epoch()).count());
+}
+
+inline void ColumnarWriter::SetLong(std::size_t column, long value)
+{
+	values[column].push_back(value);
+}
+
+inline void ColumnarWriter::SetDouble(std::size_t column, double value)
+{
+	reals[column].push_back(value);
+}
+
+inline void ColumnarWriter::SetPrice(std::size_t column, double value)
+{
+	values[column].push_back(PricetoTicks(value));
+}
+
+inline void ColumnarWriter::SetString(std::size_t column, std::string_view value)
+{
+	auto iter = codes.find(std::string(value));
+	if (iter == codes.end())
+	{
+		iter = codes.emplace(std::string(value), static_cast<std::uint32_t>(dictionary.size())).first;
+		dictionary.emplace_back(value);
+	}
+	values[column].push_back(iter->second);
+}
+
+inline void ColumnarWriter::EndRow()
+{
+	std::size_t rows = (columns[0].type == COLUMN_DOUBLE) ? reals[0].size() : values[0].size();
+	if (rows >= blockRows)
+		WriteBlock();
+}
+
+inline void ColumnarWriter::WriteBlock()
+{
+	std::size_t rows = (columns[0].type == COLUMN_DOUBLE) ? reals[0].size() : values[0].size();
+	if (file == nullptr || rows == 0)
+		return;
+
+	BlockInfo block;
+	block.offset = offset;
+	block.rows = static_cast<std::uint32_t>(rows);
+	block.minTime = 0;
+	block.maxTime = 0;
+	if (timeColumn >= 0)
+	{
+		auto range = std::minmax_element(values[timeColumn].begin(), values[timeColumn].end());
+		block.minTime = *range.first;
+		block.maxTime = *range.second;
+	}
+	if (productColumn >= 0)
+	{
+		for (std::int64_t code : values[productColumn])
+			block.products.push_back(static_cast<std::uint32_t>(code));
+		std::sort(block.products.begin(), block.products.end());
+		block.products.erase(std::unique(block.products.begin(), block.products.end()), block.products.end());
+	}
+
+	for (std::size_t c = 0; c < columns.size(); c++)
+	{
+		buffer.clear();
+		if (columns[c].type == COLUMN_DOUBLE)
+		{
+			buffer.append(reinterpret_cast<const char*>(reals[c].data()), reals[c].size() * sizeof(double));
+			reals[c].clear();
+		}
+		else
+		{
+			if (compression == COMPRESSION_DELTA)
+			{
+				std::int64_t previous = 0;
+				for (std::int64_t value : values[c])
+				{
+					PutVarint(buffer, value - previous);
+					previous = value;
+				}
+			}
+			else
+				buffer.append(reinterpret_cast<const char*>(values[c].data()), values[c].size() * sizeof(std::int64_t));
+			values[c].clear();
+		}
+
+		block.columnOffsets.push_back(offset);
+		block.columnLengths.push_back(buffer.size());
+		std::fwrite(buffer.data(), 1, buffer.size(), file);
+		offset += buffer.size();
+	}
+	blocks.push_back(std::move(block));
+}
+
+inline void ColumnarWriter::WriteFooter()
+{
+	buffer.clear();
+	PutRaw(buffer, static_cast<std::uint32_t>(columns.size()));
+	for (auto& column : columns)
+	{
+		PutRaw(buffer, static_cast<std::uint8_t>(column.type));
+		PutRaw(buffer, static_cast<std::uint32_t>(column.name.size()));
+		buffer += column.name;
+	}
+	PutRaw(buffer, static_cast<std::uint8_t>(compression));
+	PutRaw(buffer, static_cast<std::int32_t>(timeColumn));
+	PutRaw(buffer, static_cast<std::int32_t>(productColumn));
+
+	PutRaw(buffer, static_cast<std::uint32_t>(dictionary.size()));
+	for (auto& text : dictionary)
+	{
+		PutRaw(buffer, static_cast<std::uint32_t>(text.size()));
+		buffer += text;
+	}
+
+	PutRaw(buffer, static_cast<std::uint32_t>(blocks.size()));
+	for (auto& block : blocks)
+	{
+		PutRaw(buffer, block.offset);
+		PutRaw(buffer, block.rows);
+		PutRaw(buffer, block.minTime);
+		PutRaw(buffer, block.maxTime);
+		PutRaw(buffer, static_cast<std::uint32_t>(block.products.size()));
+		for (std::uint32_t code : block.products)
+			PutRaw(buffer, code);
+		for (std::size_t c = 0; c < columns.size(); c++)
+		{
+			PutRaw(buffer, block.columnOffsets[c]);
+			PutRaw(buffer, block.columnLengths[c]);
+		}
+	}
+
+	PutRaw(buffer, offset); // footer offset
+	buffer.append(COLUMNAR_MAGIC, 4);
+	std::fwrite(buffer.data(), 1, buffer.size(), file);
+}
+
+inline void ColumnarWriter::Close()
+{
+	if (file == nullptr)
+		return;
+
+	WriteBlock();
+	WriteFooter();
+	std::fclose(file);
+	file = nullptr;
+}
+
+// Reader of a columnar file, maps the file and decodes one column of one block at a time
+class ColumnarReader
+{
+private:
+	MappedFile mapped;
+	bool valid;
+	std::vector<ColumnSpec> columns;
+	ColumnCompression compression;
+	int timeColumn;
+	int productColumn;
+	std::vector<std::string> dictionary;
+	std::vector<BlockInfo> blocks;
+
+	// Read the schema, the dictionary and the block index, false if the footer is not consistent with the file
+	bool ReadFooter();
+
+public:
+	ColumnarReader(const std::string& path); // ctor, reads the footer
+
+	// Whether the file was read
+	bool is_open() const;
+
+	// Get the schema
+	const std::vector<ColumnSpec>& GetColumns() const;
+
+	// Get the index of a column by name, -1 if there is none
+	int GetColumnIndex(const std::string& name) const;
+
+	// Get the block index
+	const std::vector<BlockInfo>& GetBlocks() const;
+
+	// Get the total # of rows
+	std::size_t GetRowCount() const;
+
+	// Get the string of a dictionary code
+	const std::string& GetString(std::uint32_t code) const;
+
+	// Get the dictionary code of a string, -1 if it does not occur
+	long GetCode(const std::string& text) const;
+
+	// Decode an integer column of a block (times in microseconds, prices in ticks, strings as codes)
+	void ReadLongs(std::size_t block, std::size_t column, std::vector<std::int64_t>& out) const;
+
+	// Decode a double column of a block
+	void ReadDoubles(std::size_t block, std::size_t column, std::vector<double>& out) const;
+
+	// Get the blocks holding rows in [fromTime, toTime] (microseconds), restricted to a product if one is given
+	std::vector<std::size_t> FindBlocks(std::int64_t fromTime, std::int64_t toTime, const std::string& product = std::string()) const;
+
+	// Convert the file to CSV, one line per row, the column names as header
+	void ToCsv(const std::string& csvPath) const;
+};
+
+inline ColumnarReader::ColumnarReader(const std::string& path) :
+	mapped(path), valid(false), compression(COMPRESSION_NONE), timeColumn(-1), productColumn(-1)
+{
+	if (!mapped.is_open() || mapped.size() < 8 + 12 || std::memcmp(mapped.begin(), COLUMNAR_MAGIC, 4) != 0
+		|| std::memcmp(mapped.end() - 4, COLUMNAR_MAGIC, 4) != 0)
+	{
+		std::cout << "Cannot open the file!" << std::endl;
+		return;
+	}
+
+	valid = ReadFooter();
+	if (!valid)
+	{
+		std::cout << "Cannot read the file footer!" << std::endl;
+		columns.clear();
+		dictionary.clear();
+		blocks.clear();
+	}
+}
+
+inline bool ColumnarReader::ReadFooter()
+{
+	// the footer lies between the blocks and the trailing footer offset, every read stays inside it
+	const char* footerEnd = mapped.end() - 12;
+	const char* tail = footerEnd;
+	std::uint64_t footerOffset = GetRaw<std::uint64_t>(tail);
+	if (footerOffset < 8 || footerOffset > mapped.size() - 12)
+		return false;
+	const char* p = mapped.begin() + footerOffset;
+	auto left = [&p, footerEnd](std::uint64_t bytes) { return static_cast<std::uint64_t>(footerEnd - p) >= bytes; };
+
+	if (!left(4))
+		return false;
+	std::uint32_t columnCount = GetRaw<std::uint32_t>(p);
+	if (columnCount == 0)
+		return false;
+	for (std::uint32_t c = 0; c < columnCount; c++)
+	{
+		if (!left(5))
+			return false;
+		ColumnSpec column;
+		std::uint8_t type = GetRaw<std::uint8_t>(p);
+		if (type > COLUMN_STRING)
+			return false;
+		column.type = static_cast<ColumnType>(type);
+		std::uint32_t length = GetRaw<std::uint32_t>(p);
+		if (!left(length))
+			return false;
+		column.name.assign(p, length);
+		p += length;
+		columns.push_back(column);
+	}
+
+	if (!left(1 + 4 + 4))
+		return false;
+	std::uint8_t encoding = GetRaw<std::uint8_t>(p);
+	if (encoding > COMPRESSION_DELTA)
+		return false;
+	compression = static_cast<ColumnCompression>(encoding);
+	timeColumn = GetRaw<std::int32_t>(p);
+	productColumn = GetRaw<std::int32_t>(p);
+	if (timeColumn < -1 || timeColumn >= static_cast<std::int64_t>(columnCount)
+		|| productColumn < -1 || productColumn >= static_cast<std::int64_t>(columnCount))
+		return false;
+
+	if (!left(4))
+		return false;
+	std::uint32_t dictionarySize = GetRaw<std::uint32_t>(p);
+	if (!left(4ull * dictionarySize))
+		return false;
+	dictionary.reserve(dictionarySize);
+	for (std::uint32_t i = 0; i < dictionarySize; i++)
+	{
+		if (!left(4))
+			return false;
+		std::uint32_t length = GetRaw<std::uint32_t>(p);
+		if (!left(length))
+			return false;
+		dictionary.emplace_back(p, length);
+		p += length;
+	}
+
+	if (!left(4))
+		return false;
+	std::uint32_t blockCount = GetRaw<std::uint32_t>(p);
+	for (std::uint32_t b = 0; b < blockCount; b++)
+	{
+		if (!left(8 + 4 + 8 + 8 + 4))
+			return false;
+		BlockInfo block;
+		block.offset = GetRaw<std::uint64_t>(p);
+		block.rows = GetRaw<std::uint32_t>(p);
+		block.minTime = GetRaw<std::int64_t>(p);
+		block.maxTime = GetRaw<std::int64_t>(p);
+		std::uint32_t productCount = GetRaw<std::uint32_t>(p);
+		if (!left(4ull * productCount + 16ull * columnCount))
+			return false;
+		for (std::uint32_t i = 0; i < productCount; i++)
+		{
+			std::uint32_t code = GetRaw<std::uint32_t>(p);
+			if (code >= dictionarySize)
+				return false;
+			block.products.push_back(code);
+		}
+		for (std::uint32_t c = 0; c < columnCount; c++)
+		{
+			std::uint64_t offset = GetRaw<std::uint64_t>(p);
+			std::uint64_t length = GetRaw<std::uint64_t>(p);
+
+			// inside the blocks, fixed width columns hold a value per row, varints at least a byte
+			if (offset < 8 || length > footerOffset || offset > footerOffset - length)
+				return false;
+			bool fixed = columns[c].type == COLUMN_DOUBLE || compression == COMPRESSION_NONE;
+			if (fixed ? length != 8ull * block.rows : length < block.rows)
+				return false;
+			block.columnOffsets.push_back(offset);
+			block.columnLengths.push_back(length);
+		}
+		blocks.push_back(std::move(block));
+	}
+	return true;
+}
+
+inline bool ColumnarReader::is_open() const
+{
+	return valid;
+}
+
+inline const std::vector<ColumnSpec>& ColumnarReader::GetColumns() const
+{
+	return columns;
+}
+
+inline int ColumnarReader::GetColumnIndex(const std::string& name) const
+{
+	for (std::size_t c = 0; c < columns.size(); c++)
+		if (columns[c].name == name)
+			return static_cast<int>(c);
+	return -1;
+}
+
+inline const std::vector<BlockInfo>& ColumnarReader::GetBlocks() const
+{
+	return blocks;
+}
+
+inline std::size_t ColumnarReader::GetRowCount() const
+{
+	std::size_t rows = 0;
+	for (auto& block : blocks)
+		rows += block.rows;
+	return rows;
+}
+
+inline const std::string& ColumnarReader::GetString(std::uint32_t code) const
+{
+	return dictionary[code];
+}
+
+inline long ColumnarReader::GetCode(const std::string& text) const
+{
+	auto iter = std::find(dictionary.begin(), dictionary.end(), text);
+	return (iter == dictionary.end()) ? -1 : static_cast<long>(iter - dictionary.begin());
+}
+
+inline void ColumnarReader::ReadLongs(std::size_t block, std::size_t column, std::vector<std::int64_t>& out) const
+{
+	const BlockInfo& info = blocks[block];
+	const char* p = mapped.begin() + info.columnOffsets[column];
+	out.resize(info.rows);
+	if (compression == COMPRESSION_DELTA)
+	{
+		std::int64_t previous = 0;
+		for (std::uint32_t i = 0; i < info.rows; i++)
+		{
+			previous += GetVarint(p);
+			out[i] = previous;
+		}
+	}
+	else
+		std::memcpy(out.data(), p, info.rows * sizeof(std::int64_t));
+}
+
+inline void ColumnarReader::ReadDoubles(std::size_t block, std::size_t column, std::vector<double>& out) const
+{
+	const BlockInfo& info = blocks[block];
+	out.resize(info.rows);
+	std::memcpy(out.data(), mapped.begin() + info.columnOffsets[column], info.rows * sizeof(double));
+}
+
+inline std::vector<std::size_t> ColumnarReader::FindBlocks(std::int64_t fromTime, std::int64_t toTime, const std::string& product) const
+{
+	long code = product.empty() ? -1 : GetCode(product);
+	std::vector<std::size_t> result;
+	if (!product.empty() && code < 0)
+		return result;
+
+	for (std::size_t b = 0; b < blocks.size(); b++)
+	{
+		const BlockInfo& block = blocks[b];
+		if (timeColumn >= 0 && (block.maxTime < fromTime || block.minTime > toTime))
+			continue;
+		if (code >= 0 && productColumn >= 0
+			&& !std::binary_search(block.products.begin(), block.products.end(), static_cast<std::uint32_t>(code)))
+			continue;
+		result.push_back(b);
+	}
+	return result;
+}
+
+inline void ColumnarReader::ToCsv(const std::string& csvPath) const
+{
+	std::FILE* csv = std::fopen(csvPath.c_str(), "wb");
+	if (csv == nullptr)
+	{
+		std::cout << "Cannot open the file!" << std::endl;
+		return;
+	}
+
+	std::string out;
+	for (std::size_t c = 0; c < columns.size(); c++)
+		out += (c == 0 ? "" : ",") + columns[c].name;
+	out += '\n';
+
+	std::vector< std::vector<std::int64_t> > longs(columns.size());
+	std::vector< std::vector<double> > doubles(columns.size());
+	char buf[PRICE_BUFFER_SIZE > TIMESTAMP_BUFFER_SIZE ? PRICE_BUFFER_SIZE : TIMESTAMP_BUFFER_SIZE];
+	for (std::size_t b = 0; b < blocks.size(); b++)
+	{
+		for (std::size_t c = 0; c < columns.size(); c++)
+		{
+			if (columns[c].type == COLUMN_DOUBLE)
+				ReadDoubles(b, c, doubles[c]);
+			else
+				ReadLongs(b, c, longs[c]);
+		}
+
+		for (std::uint32_t r = 0; r < blocks[b].rows; r++)
+		{
+			for (std::size_t c = 0; c < columns.size(); c++)
+			{
+				if (c != 0)
+					out += ',';
+				switch (columns[c].type)
+				{
+				case COLUMN_TIME:
+					out.append(buf, FormatTimestamp(RecordTime(std::chrono::duration_cast<RecordTime::duration>(
+						std::chrono::microseconds(longs[c][r]))), buf));
+					break;
+				case COLUMN_LONG:
+					out += std::to_string(longs[c][r]);
+					break;
+				case COLUMN_DOUBLE:
+					out += std::to_string(doubles[c][r]);
+					break;
+				case COLUMN_PRICE:
+					out.append(buf, FormatTicks(longs[c][r], buf));
+					break;
+				case COLUMN_STRING:
+					out += dictionary[static_cast<std::size_t>(longs[c][r])];
+					break;
+				}
+			}
+			out += '\n';
+		}
+		std::fwrite(out.data(), 1, out.size(), csv);
+		out.clear();
+	}
+	std::fwrite(out.data(), 1, out.size(), csv);
+	std::fclose(csv);
+}
+
+#endif // !COLUMNARSTORE_HPP
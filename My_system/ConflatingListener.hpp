@@ -0,0 +1,315 @@
+// ConflatingListener
+// listener adapter for slow consumers: registered on a service in place of a listener,
+// it keeps only the latest event of each key and a worker thread hands the keys that
+// changed to the wrapped listener, either as soon as it is free or once per interval;
+// the service never waits on the consumer, events it could not keep up with are coalesced
+// Type V is the event type.
+
+#ifndef CONFLATINGLISTENER_HPP
+#define CONFLATINGLISTENER_HPP
+
+#include "soa.hpp"
+#include "PipelineStage.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+template<typename V>
+class ConflatingListener final : public ServiceListener<V>
+{
+public:
+	// gives the key events are conflated on
+	typedef std::function<std::string(const V&)> KeyFunction;
+
+private:
+	struct Slot
+	{
+		StageAction action;
+		V data;
+		bool dirty; // changed since it was last delivered
+	};
+
+	ServiceListener<V>* downstream;
+	KeyFunction key;
+	std::chrono::milliseconds interval; // 0 delivers as soon as the worker is free
+
+	std::unordered_map<std::string, std::size_t> index; // slot of each key
+	std::vector<Slot> slots;
+	std::vector<std::size_t> dirty; // slots to deliver, in the order they first changed
+	std::mutex lock;
+	std::condition_variable changed;
+	std::thread worker;
+	bool running;
+	bool delivering;
+
+	std::atomic<long> received;
+	std::atomic<long> delivered;
+	std::atomic<long> coalesced;
+
+	// Keep an event as the latest of its key, the lock is held; true if the worker has to be woken
+	bool Keep(StageAction action, const V &data, std::string &&k);
+
+	// Keep an event as the latest of its key
+	void Push(StageAction action, const V &data);
+
+	// Worker loop
+	void Run();
+
+public:
+	ConflatingListener(ServiceListener<V>* _downstream, KeyFunction _key, std::chrono::milliseconds _interval = std::chrono::milliseconds(0)); // ctor
+	~ConflatingListener(); // stops the worker
+
+	// Start the worker thread
+	void Start();
+
+	// Wait until every key changed so far was delivered
+	void Drain();
+
+	// Deliver what is left and join the worker
+	void Stop();
+
+	// Get the # of events received
+	long GetReceivedCount() const;
+
+	// Get the # of events handed to the wrapped listener
+	long GetDeliveredCount() const;
+
+	// Get the # of events replaced by a later event of the same key before they were delivered
+	long GetCoalescedCount() const;
+
+	// Listener callback to process an add event to the Service
+	virtual void ProcessAdd(V &data);
+
+	// Listener callback to process a remove event to the Service
+	virtual void ProcessRemove(V &data);
+
+	// Listener callback to process an update event to the Service
+	virtual void ProcessUpdate(V &data);
+
+	// Listener callbacks for resident data of the Service, copied into the slot
+	virtual void ProcessAdd(const V &data);
+	virtual void ProcessRemove(const V &data);
+	virtual void ProcessUpdate(const V &data);
+
+	// Listener callback to process a batch of add events, kept under one lock
+	virtual void ProcessBatch(V *data, std::size_t count);
+};
+
+template<typename V>
+ConflatingListener<V>::ConflatingListener(ServiceListener<V>* _downstream, KeyFunction _key, std::chrono::milliseconds _interval) :
+	downstream(_downstream), key(_key), interval(_interval), running(false), delivering(false), received(0), delivered(0), coalesced(0)
+{
+}
+
+template<typename V>
+ConflatingListener<V>::~ConflatingListener()
+{
+	Stop();
+}
+
+template<typename V>
+void ConflatingListener<V>::Start()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if (!running)
+	{
+		running = true;
+		worker = std::thread(&ConflatingListener<V>::Run, this);
+	}
+}
+
+template<typename V>
+void ConflatingListener<V>::Drain()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	changed.wait(guard, [this]() { return (dirty.empty() && !delivering) || !running; });
+}
+
+template<typename V>
+void ConflatingListener<V>::Stop()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (!running)
+			return;
+		running = false;
+	}
+	changed.notify_all();
+	worker.join();
+}
+
+template<typename V>
+bool ConflatingListener<V>::Keep(StageAction action, const V &data, std::string &&k)
+{
+	auto iter = index.find(k);
+	if (iter == index.end())
+	{
+		iter = index.emplace(std::move(k), slots.size()).first;
+		slots.push_back(Slot{ action, data, false });
+	}
+	else
+	{
+		slots[iter->second].action = action;
+		slots[iter->second].data = data;
+	}
+
+	Slot& slot = slots[iter->second];
+	bool wake = dirty.empty();
+	if (!slot.dirty)
+	{
+		slot.dirty = true;
+		dirty.push_back(iter->second);
+	}
+	else
+		coalesced.fetch_add(1, std::memory_order_relaxed); // the previous event was never delivered
+	return wake;
+}
+
+template<typename V>
+void ConflatingListener<V>::Push(StageAction action, const V &data)
+{
+	std::string k = key(data);
+	bool wake;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		wake = Keep(action, data, std::move(k));
+	}
+	received.fetch_add(1, std::memory_order_relaxed);
+	if (wake && interval.count() == 0)
+		changed.notify_all();
+}
+
+template<typename V>
+void ConflatingListener<V>::Run()
+{
+	std::vector<std::size_t> batch;
+	std::vector<Slot> events;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			if (interval.count() == 0)
+				changed.wait(guard, [this]() { return !dirty.empty() || !running; });
+			else
+				changed.wait_for(guard, interval, [this]() { return !running; });
+
+			if (dirty.empty())
+			{
+				if (!running)
+					break;
+				continue;
+			}
+
+			// take the latest event of every changed key, the slots take new events meanwhile
+			batch.swap(dirty);
+			for (std::size_t i : batch)
+			{
+				slots[i].dirty = false;
+				events.push_back(slots[i]);
+			}
+			batch.clear();
+			delivering = true;
+		}
+
+		for (Slot& event : events)
+		{
+			switch (event.action)
+			{
+			case STAGE_ADD:
+				downstream->ProcessAdd(event.data);
+				break;
+			case STAGE_REMOVE:
+				downstream->ProcessRemove(event.data);
+				break;
+			case STAGE_UPDATE:
+				downstream->ProcessUpdate(event.data);
+				break;
+			}
+		}
+		delivered.fetch_add(static_cast<long>(events.size()), std::memory_order_relaxed);
+		events.clear();
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			delivering = false;
+		}
+		changed.notify_all();
+	}
+	changed.notify_all();
+}
+
+template<typename V>
+long ConflatingListener<V>::GetReceivedCount() const
+{
+	return received.load(std::memory_order_relaxed);
+}
+
+template<typename V>
+long ConflatingListener<V>::GetDeliveredCount() const
+{
+	return delivered.load(std::memory_order_relaxed);
+}
+
+template<typename V>
+long ConflatingListener<V>::GetCoalescedCount() const
+{
+	return coalesced.load(std::memory_order_relaxed);
+}
+
+template<typename V>
+void ConflatingListener<V>::ProcessAdd(V &data)
+{
+	Push(STAGE_ADD, data);
+}
+
+template<typename V>
+void ConflatingListener<V>::ProcessRemove(V &data)
+{
+	Push(STAGE_REMOVE, data);
+}
+
+template<typename V>
+void ConflatingListener<V>::ProcessUpdate(V &data)
+{
+	Push(STAGE_UPDATE, data);
+}
+
+template<typename V>
+void ConflatingListener<V>::ProcessAdd(const V &data)
+{
+	Push(STAGE_ADD, data);
+}
+
+template<typename V>
+void ConflatingListener<V>::ProcessRemove(const V &data)
+{
+	Push(STAGE_REMOVE, data);
+}
+
+template<typename V>
+void ConflatingListener<V>::ProcessUpdate(const V &data)
+{
+	Push(STAGE_UPDATE, data);
+}
+
+template<typename V>
+void ConflatingListener<V>::ProcessBatch(V *data, std::size_t count)
+{
+	bool wake = false;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		for (std::size_t i = 0; i < count; i++)
+			wake = Keep(STAGE_ADD, data[i], key(data[i])) || wake;
+	}
+	received.fetch_add(static_cast<long>(count), std::memory_order_relaxed);
+	if (wake && interval.count() == 0)
+		changed.notify_all();
+}
+
+#endif // !CONFLATINGLISTENER_HPP
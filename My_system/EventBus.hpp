@@ -0,0 +1,204 @@
+// EventBus
+// layer between connectors and a service: handed to the connectors in place of the
+// service, it copies each message into a bounded lock-free MPSC queue and a dispatcher
+// thread drains the queue in batches into the service's OnMessageBatch, so reading a file
+// overlaps with processing and several connectors (venues) can feed one service at once;
+// the messages of each connector reach the service in the order it sent them
+// a connector that finds the queue full waits for the dispatcher (back-pressure), the
+// waits, batches and deepest backlog are kept as statistics
+// Type V is the message type.
+
+#ifndef EVENTBUS_HPP
+#define EVENTBUS_HPP
+
+#include "soa.hpp"
+#include "MpscQueue.hpp"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+template<typename V>
+class EventBus : public Service<string, V>
+{
+private:
+	Service<string, V>* target;
+	MpscQueue<V> queue;
+	std::size_t batchSize;
+	std::thread dispatcher;
+
+	std::atomic<long> published; // written by the connectors
+	std::atomic<long> dispatched; // written by the dispatcher
+	std::atomic<long> batches;
+	std::atomic<std::size_t> maxDepth;
+
+	// Dispatcher loop
+	void Run();
+
+public:
+	EventBus(Service<string, V>* _target, std::size_t capacity = 1 << 14, std::size_t _batchSize = 256); // ctor
+	~EventBus(); // stops the dispatcher
+
+	// Start the dispatcher thread
+	void Start();
+
+	// Wait until every message published so far went through the service
+	void Drain();
+
+	// Dispatch what is left and join the dispatcher
+	void Stop();
+
+	// Get data of the service, only consistent once the bus is drained
+	virtual V& GetData(string key);
+
+	// Queue a message for the service, callable from any connector thread
+	virtual void OnMessage(V &data);
+
+	// Queue a batch of messages for the service, counted once
+	virtual void OnMessageBatch(V *data, std::size_t count);
+
+	// Add a listener to the service
+	virtual void AddListener(ServiceListener<V> *listener);
+
+	// Get all listeners on the service
+	virtual const vector< ServiceListener<V>* >& GetListeners() const;
+
+	// Get the # of messages published to the bus
+	long GetPublishedCount() const;
+
+	// Get the # of messages handed to the service
+	long GetDispatchedCount() const;
+
+	// Get the # of batches the dispatcher drained
+	long GetBatchCount() const;
+
+	// Get the # of messages whose connector had to wait for a free slot
+	long GetFullCount() const;
+
+	// Get the largest # of messages waiting in the queue seen by the dispatcher
+	std::size_t GetMaxDepth() const;
+};
+
+template<typename V>
+EventBus<V>::EventBus(Service<string, V>* _target, std::size_t capacity, std::size_t _batchSize) :
+	target(_target), queue(capacity), batchSize(_batchSize == 0 ? 1 : _batchSize), published(0), dispatched(0), batches(0), maxDepth(0)
+{
+}
+
+template<typename V>
+EventBus<V>::~EventBus()
+{
+	Stop();
+}
+
+template<typename V>
+void EventBus<V>::Start()
+{
+	if (!dispatcher.joinable())
+		dispatcher = std::thread(&EventBus<V>::Run, this);
+}
+
+template<typename V>
+void EventBus<V>::Drain()
+{
+	unsigned spins = 0;
+	while (dispatched.load(std::memory_order_acquire) != published.load(std::memory_order_acquire))
+		SpscBackoff(spins);
+}
+
+template<typename V>
+void EventBus<V>::Stop()
+{
+	if (dispatcher.joinable())
+	{
+		queue.Close();
+		dispatcher.join();
+	}
+}
+
+template<typename V>
+void EventBus<V>::Run()
+{
+	std::vector<V> batch;
+	batch.reserve(batchSize);
+
+	// take what is already waiting, up to a batch, then run it through the service
+	std::size_t count;
+	while ((count = queue.PopBatch(batch, batchSize)) > 0)
+	{
+		std::size_t depth = queue.Size() + count;
+		if (depth > maxDepth.load(std::memory_order_relaxed))
+			maxDepth.store(depth, std::memory_order_relaxed);
+
+		target->OnMessageBatch(batch.data(), count);
+		batch.clear();
+
+		batches.fetch_add(1, std::memory_order_relaxed);
+		dispatched.fetch_add(static_cast<long>(count), std::memory_order_release);
+	}
+}
+
+template<typename V>
+V& EventBus<V>::GetData(string key)
+{
+	return target->GetData(key);
+}
+
+template<typename V>
+void EventBus<V>::OnMessage(V &data)
+{
+	published.fetch_add(1, std::memory_order_release);
+	queue.Push(data);
+}
+
+template<typename V>
+void EventBus<V>::OnMessageBatch(V *data, std::size_t count)
+{
+	published.fetch_add(static_cast<long>(count), std::memory_order_release);
+	for (std::size_t i = 0; i < count; i++)
+		queue.Push(data[i]);
+}
+
+template<typename V>
+void EventBus<V>::AddListener(ServiceListener<V> *listener)
+{
+	target->AddListener(listener);
+}
+
+template<typename V>
+const vector< ServiceListener<V>* >& EventBus<V>::GetListeners() const
+{
+	return target->GetListeners();
+}
+
+template<typename V>
+long EventBus<V>::GetPublishedCount() const
+{
+	return published.load(std::memory_order_relaxed);
+}
+
+template<typename V>
+long EventBus<V>::GetDispatchedCount() const
+{
+	return dispatched.load(std::memory_order_relaxed);
+}
+
+template<typename V>
+long EventBus<V>::GetBatchCount() const
+{
+	return batches.load(std::memory_order_relaxed);
+}
+
+template<typename V>
+long EventBus<V>::GetFullCount() const
+{
+	return queue.GetFullCount();
+}
+
+template<typename V>
+std::size_t EventBus<V>::GetMaxDepth() const
+{
+	return maxDepth.load(std::memory_order_relaxed);
+}
+
+#endif // !EVENTBUS_HPP
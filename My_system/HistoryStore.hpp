@@ -0,0 +1,220 @@
+// HistoryStore
+// in-memory history of the historical data services: every persisted value is kept
+// with its time, per key, in append-only chunks that are never relocated; the first
+// time of every chunk forms a sparse index, so a time range query binary searches
+// the index and then the chunks it overlaps, without touching the output files
+// the values of a key are appended in time order by the thread persisting to the
+// service; queries may come from any thread
+// Type V is the value type.
+
+#ifndef HISTORYSTORE_HPP
+#define HISTORYSTORE_HPP
+
+#include "TimestampFormatter.hpp"
+#include <deque>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <algorithm>
+#include <unordered_map>
+
+// values kept per key unless a service is given another limit, so a long session does not
+// keep every update in memory (the output files hold them all)
+const std::size_t HISTORY_LIMIT = 10000;
+
+// value with the time it was persisted
+template<typename V>
+struct TimedValue
+{
+	RecordTime time;
+	V value;
+};
+
+// history of one key
+template<typename V>
+class TimeSeries
+{
+private:
+	std::deque< std::vector< TimedValue<V> > > chunks; // each holds up to chunkSize values
+	std::deque<RecordTime> index; // first time of each chunk
+	std::size_t chunkSize;
+	std::size_t maxChunks; // oldest chunks are dropped beyond this, 0 keeps all
+	std::size_t count;
+
+public:
+	TimeSeries(std::size_t _chunkSize = 4096, std::size_t _maxChunks = 0); // ctor
+
+	// Append a value, a time earlier than the last one is raised to it so the series stays sorted
+	void Append(RecordTime time, const V& value);
+
+	// Get the # of values kept
+	std::size_t Size() const;
+
+	// Get the values with from <= time <= to, oldest first
+	void Range(RecordTime from, RecordTime to, std::vector< TimedValue<V> >& out) const;
+
+	// Get the last n values, oldest first
+	void Last(std::size_t n, std::vector< TimedValue<V> >& out) const;
+};
+
+template<typename V>
+TimeSeries<V>::TimeSeries(std::size_t _chunkSize, std::size_t _maxChunks) :
+	chunkSize(_chunkSize), maxChunks(_maxChunks), count(0)
+{
+}
+
+template<typename V>
+void TimeSeries<V>::Append(RecordTime time, const V& value)
+{
+	if (!chunks.empty() && time < chunks.back().back().time)
+		time = chunks.back().back().time;
+
+	if (chunks.empty() || chunks.back().size() == chunkSize)
+	{
+		if (maxChunks != 0 && chunks.size() == maxChunks)
+		{
+			count -= chunks.front().size();
+			chunks.pop_front();
+			index.pop_front();
+		}
+		chunks.emplace_back();
+		chunks.back().reserve(chunkSize);
+		index.push_back(time);
+	}
+	chunks.back().push_back(TimedValue<V>{ time, value });
+	count++;
+}
+
+template<typename V>
+std::size_t TimeSeries<V>::Size() const
+{
+	return count;
+}
+
+template<typename V>
+void TimeSeries<V>::Range(RecordTime from, RecordTime to, std::vector< TimedValue<V> >& out) const
+{
+	if (chunks.empty() || to < from)
+		return;
+
+	// last chunk starting before from, its tail may be in range (a chunk starting at from
+	// may follow a chunk ending at from, so it is not enough to start there)
+	std::size_t c = std::lower_bound(index.begin(), index.end(), from) - index.begin();
+	c = (c == 0) ? 0 : c - 1;
+	auto earlier = [](const TimedValue<V>& entry, RecordTime time) { return entry.time < time; };
+	for (; c < chunks.size() && index[c] <= to; c++)
+	{
+		const std::vector< TimedValue<V> >& chunk = chunks[c];
+		auto first = std::lower_bound(chunk.begin(), chunk.end(), from, earlier);
+		for (; first != chunk.end() && first->time <= to; ++first)
+			out.push_back(*first);
+	}
+}
+
+template<typename V>
+void TimeSeries<V>::Last(std::size_t n, std::vector< TimedValue<V> >& out) const
+{
+	n = std::min(n, count);
+	if (n == 0)
+		return;
+
+	// walk back to the chunk holding the oldest of the n values, then copy forward
+	std::size_t c = chunks.size() - 1;
+	std::size_t take = n;
+	while (take > chunks[c].size())
+	{
+		take -= chunks[c].size();
+		c--;
+	}
+	out.reserve(out.size() + n);
+	out.insert(out.end(), chunks[c].end() - take, chunks[c].end());
+	for (c++; c < chunks.size(); c++)
+		out.insert(out.end(), chunks[c].begin(), chunks[c].end());
+}
+
+// histories of all keys of a service
+template<typename V>
+class HistoryStore
+{
+private:
+	std::unordered_map<std::string, TimeSeries<V>> series;
+	std::size_t chunkSize;
+	std::size_t maxChunks;
+	mutable std::mutex lock; // the persisting thread and the querying threads
+
+public:
+	HistoryStore(std::size_t limit = HISTORY_LIMIT, std::size_t _chunkSize = 4096); // ctor, keeps about limit values per key (0 keeps all)
+
+	// Append a value to the history of a key
+	void Append(const std::string& key, RecordTime time, const V& value);
+
+	// Get the values of a key with from <= time <= to, oldest first
+	std::vector< TimedValue<V> > GetRange(const std::string& key, RecordTime from, RecordTime to) const;
+
+	// Get the last n values of a key, oldest first
+	std::vector< TimedValue<V> > GetLast(const std::string& key, std::size_t n) const;
+
+	// Get the # of values kept for a key
+	std::size_t GetCount(const std::string& key) const;
+
+	// Get the keys with a history
+	std::vector<std::string> GetKeys() const;
+};
+
+template<typename V>
+HistoryStore<V>::HistoryStore(std::size_t limit, std::size_t _chunkSize) :
+	chunkSize(_chunkSize), maxChunks(limit == 0 ? 0 : (limit + _chunkSize - 1) / _chunkSize + 1)
+{
+}
+
+template<typename V>
+void HistoryStore<V>::Append(const std::string& key, RecordTime time, const V& value)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	auto iter = series.find(key);
+	if (iter == series.end())
+		iter = series.emplace(key, TimeSeries<V>(chunkSize, maxChunks)).first;
+	iter->second.Append(time, value);
+}
+
+template<typename V>
+std::vector< TimedValue<V> > HistoryStore<V>::GetRange(const std::string& key, RecordTime from, RecordTime to) const
+{
+	std::vector< TimedValue<V> > result;
+	std::lock_guard<std::mutex> guard(lock);
+	auto iter = series.find(key);
+	if (iter != series.end())
+		iter->second.Range(from, to, result);
+	return result;
+}
+
+template<typename V>
+std::vector< TimedValue<V> > HistoryStore<V>::GetLast(const std::string& key, std::size_t n) const
+{
+	std::vector< TimedValue<V> > result;
+	std::lock_guard<std::mutex> guard(lock);
+	auto iter = series.find(key);
+	if (iter != series.end())
+		iter->second.Last(n, result);
+	return result;
+}
+
+template<typename V>
+std::size_t HistoryStore<V>::GetCount(const std::string& key) const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	auto iter = series.find(key);
+	return (iter == series.end()) ? 0 : iter->second.Size();
+}
+
+template<typename V>
+std::vector<std::string> HistoryStore<V>::GetKeys() const
+{
+	std::vector<std::string> keys;
+	std::lock_guard<std::mutex> guard(lock);
+	for (auto& entry : series)
+		keys.push_back(entry.first);
+	return keys;
+}
+
+#endif // !HISTORYSTORE_HPP
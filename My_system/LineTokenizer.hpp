@@ -0,0 +1,234 @@
+// LineTokenizer
+// shared line tokenizer for the subscribe connectors: scans a large read buffer
+// (or the memory-mapped file) for newlines and separators with SSE2/AVX2 and
+// returns the trimmed fields of each line as string_views into that buffer
+
+#ifndef LINETOKENIZER_HPP
+#define LINETOKENIZER_HPP
+
+#include "MappedFile.hpp"
+#include <string>
+#include <string_view>
+#include <array>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <charconv>
+#include <cstddef>
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit of a non-zero scan mask
+inline unsigned LowestBit(unsigned mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return static_cast<unsigned>(index);
+#else
+	return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// Find the first occurrence of byte c in [first, last), or last if there is none
+inline const char* FindByte(const char* first, const char* last, char c)
+{
+#if defined(__AVX2__)
+	const __m256i needle = _mm256_set1_epi8(c);
+	while (last - first >= 32)
+	{
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+		unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+		if (mask != 0)
+			return first + LowestBit(mask);
+		first += 32;
+	}
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+	const __m128i needle16 = _mm_set1_epi8(c);
+	while (last - first >= 16)
+	{
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+		unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle16)));
+		if (mask != 0)
+			return first + LowestBit(mask);
+		first += 16;
+	}
+#endif
+	// scalar tail
+	const void* found = std::memchr(first, c, last - first);
+	return found ? static_cast<const char*>(found) : last;
+}
+
+// Parse an integer field (e.g. a quantity), 0 if the field is not a number
+inline long FieldtoLong(std::string_view field)
+{
+	long value = 0;
+	std::from_chars(field.data(), field.data() + field.size(), value);
+	return value;
+}
+
+// Tokenizer over the lines of a file, N is the maximum number of fields kept per line
+template<std::size_t N>
+class LineTokenizer
+{
+protected:
+	IngestionMode mode;
+	char sep;
+
+	// MAPPED: the whole file is the buffer
+	MappedFile mapped;
+
+	// STREAMED: the file is read in large chunks into the buffer
+	std::ifstream stream;
+	std::vector<char> buffer;
+	bool eof = false;
+
+	const char* pos = nullptr; // start of the unread data
+	const char* end = nullptr; // end of the valid data
+
+	std::array<std::string_view, N> fields;
+	std::size_t count = 0;
+
+	// Move the unread tail to the front of the buffer and read the next chunk
+	void Refill();
+
+	// Split the line [first, last) into trimmed fields
+	void Split(const char* first, const char* last);
+
+public:
+	LineTokenizer(const std::string& path, IngestionMode _mode = MAPPED, char _sep = ',', std::size_t bufferSize = 1 << 20); // ctor
+
+	// Whether the input file is open
+	bool is_open() const;
+
+	// Advance to the next non-empty line, false at the end of the file
+	bool Next();
+
+	// Get the number of fields on the current line (at most N)
+	std::size_t Size() const;
+
+	// Get a field on the current line
+	std::string_view operator[](std::size_t) const;
+};
+
+template<std::size_t N>
+LineTokenizer<N>::LineTokenizer(const std::string& path, IngestionMode _mode, char _sep, std::size_t bufferSize) :
+	mode(_mode), sep(_sep), mapped(_mode == MAPPED ? path : std::string())
+{
+	if (mode == MAPPED)
+	{
+		pos = mapped.begin();
+		end = mapped.end();
+		eof = true;
+	}
+	else
+	{
+		stream.open(path, std::ios::in | std::ios::binary);
+		buffer.resize(bufferSize);
+		pos = end = buffer.data();
+		if (stream.is_open())
+			Refill();
+	}
+}
+
+template<std::size_t N>
+bool LineTokenizer<N>::is_open() const
+{
+	return (mode == MAPPED) ? mapped.is_open() : stream.is_open();
+}
+
+template<std::size_t N>
+void LineTokenizer<N>::Refill()
+{
+	// keep offsets, pos and end point into the old storage once the buffer grows
+	std::size_t offset = pos - buffer.data();
+	std::size_t left = end - pos;
+	if (left == buffer.size()) // a single line longer than the buffer
+		buffer.resize(buffer.size() * 2);
+	if (offset != 0)
+		std::memmove(buffer.data(), buffer.data() + offset, left);
+
+	stream.read(buffer.data() + left, buffer.size() - left);
+	std::size_t got = static_cast<std::size_t>(stream.gcount());
+	if (got < buffer.size() - left)
+		eof = true;
+
+	pos = buffer.data();
+	end = pos + left + got;
+}
+
+template<std::size_t N>
+void LineTokenizer<N>::Split(const char* first, const char* last)
+{
+	count = 0;
+	while (count < N)
+	{
+		const char* cellEnd = FindByte(first, last, sep);
+
+		// trim like boost::algorithm::trim (also drops the '\r' of CRLF files)
+		const char* b = first;
+		const char* e = cellEnd;
+		while (b < e && (*b == ' ' || *b == '\t' || *b == '\r')) ++b;
+		while (e > b && (*(e - 1) == ' ' || *(e - 1) == '\t' || *(e - 1) == '\r')) --e;
+		fields[count++] = std::string_view(b, e - b);
+
+		if (cellEnd == last)
+			break;
+		first = cellEnd + 1;
+	}
+}
+
+template<std::size_t N>
+bool LineTokenizer<N>::Next()
+{
+	while (true)
+	{
+		// make sure a whole line is in the buffer
+		std::size_t scanned = 0;
+		const char* eol = FindByte(pos, end, '\n');
+		while (eol == end && !eof)
+		{
+			scanned = end - pos;
+			Refill();
+			eol = FindByte(pos + scanned, end, '\n');
+		}
+
+		if (pos == end) // nothing left
+		{
+			count = 0;
+			return false;
+		}
+
+		const char* first = pos;
+		pos = (eol == end) ? end : eol + 1;
+
+		// skip blank lines
+		const char* last = eol;
+		if (last > first && *(last - 1) == '\r')
+			--last;
+		if (last == first)
+			continue;
+
+		Split(first, last);
+		return true;
+	}
+}
+
+template<std::size_t N>
+std::size_t LineTokenizer<N>::Size() const
+{
+	return count;
+}
+
+template<std::size_t N>
+std::string_view LineTokenizer<N>::operator[](std::size_t i) const
+{
+	return fields[i];
+}
+
+#endif // !LINETOKENIZER_HPP
@@ -0,0 +1,78 @@
+// MappedFile
+// read-only memory mapping of an input file, so that subscribe connectors
+// can tokenize the rows in place instead of copying every line into a string
+
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include "boost/interprocess/file_mapping.hpp"
+#include "boost/interprocess/mapped_region.hpp"
+#include <string>
+#include <cstddef>
+
+// how a subscribe connector reads its input file
+enum IngestionMode { STREAMED, MAPPED };
+
+class MappedFile
+{
+protected:
+	boost::interprocess::file_mapping mapping;
+	boost::interprocess::mapped_region region;
+	bool opened = false;
+
+public:
+	MappedFile(const std::string&); // ctor
+
+	// Whether the file is mapped (an empty or missing file is never mapped)
+	bool is_open() const;
+
+	// First byte of the mapped file
+	const char* begin() const;
+
+	// One past the last byte of the mapped file
+	const char* end() const;
+
+	// Size of the mapped file in bytes
+	std::size_t size() const;
+};
+
+MappedFile::MappedFile(const std::string& path)
+{
+	try
+	{
+		boost::interprocess::file_mapping _mapping(path.c_str(), boost::interprocess::read_only);
+		boost::interprocess::mapped_region _region(_mapping, boost::interprocess::read_only);
+		mapping.swap(_mapping);
+		region.swap(_region);
+
+		// the whole file is read front to back exactly once
+		region.advise(boost::interprocess::mapped_region::advice_sequential);
+		opened = true;
+	}
+	catch (const boost::interprocess::interprocess_exception&)
+	{
+		opened = false;
+	}
+}
+
+bool MappedFile::is_open() const
+{
+	return opened;
+}
+
+const char* MappedFile::begin() const
+{
+	return static_cast<const char*>(region.get_address());
+}
+
+const char* MappedFile::end() const
+{
+	return begin() + size();
+}
+
+std::size_t MappedFile::size() const
+{
+	return opened ? region.get_size() : 0;
+}
+
+#endif // !MAPPEDFILE_HPP
@@ -0,0 +1,250 @@
+// MpscQueue
+// bounded lock-free ring buffer between any number of producer threads and one consumer
+// thread; every slot carries a sequence number, a producer claims a slot with one CAS
+// on the tail and publishes it by advancing the slot sequence, so producers never wait
+// on each other except when the ring is full
+// the slots are raw storage, an item is constructed in place by its push and destroyed
+// by its pop, so type T needs no default ctor
+
+#ifndef MPSCQUEUE_HPP
+#define MPSCQUEUE_HPP
+
+#include "SpscQueue.hpp" // SpscBackoff
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <new>
+
+template<typename T>
+class MpscQueue
+{
+private:
+	struct Slot
+	{
+		std::atomic<std::size_t> sequence; // position the slot is ready for: pos to push, pos + 1 to pop
+		alignas(T) unsigned char storage[sizeof(T)]; // the item while the slot is full
+
+		T* Item() { return std::launder(reinterpret_cast<T*>(storage)); }
+	};
+
+	std::unique_ptr<Slot[]> slots;
+	std::size_t mask; // capacity - 1, the capacity is a power of 2
+
+	alignas(64) std::atomic<std::size_t> tail; // next position to push, claimed by the producers
+	alignas(64) std::atomic<std::size_t> head; // next position to pop, written by the consumer
+	alignas(64) std::atomic<bool> closed;
+	std::atomic<long> fullCount; // pushes that found the queue full
+
+	// Claim a slot, false if the queue is full
+	Slot* Claim(std::size_t& position);
+
+	// Hand the item at the head to f and free its slot, false if the queue is empty
+	template<typename F>
+	bool TryConsume(F&& f);
+
+public:
+	explicit MpscQueue(std::size_t capacity = 1 << 14); // ctor, the capacity is rounded up to a power of 2
+	~MpscQueue(); // destroys the items left in the queue
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	// Push an item, false if the queue is full
+	bool TryPush(const T& item);
+	bool TryPush(T&& item);
+
+	// Push an item, waiting while the queue is full
+	void Push(T item);
+
+	// Pop an item, false if the queue is empty
+	bool TryPop(T& item);
+
+	// Pop an item, waiting while the queue is empty; false once the queue is closed and empty
+	bool Pop(T& item);
+
+	// Pop up to max items onto the back of batch, waiting while the queue is empty;
+	// 0 once the queue is closed and empty
+	std::size_t PopBatch(std::vector<T>& batch, std::size_t max);
+
+	// No more items will be pushed, wakes up a waiting consumer
+	void Close();
+
+	// Get the # of items in the queue (approximate while both sides run)
+	std::size_t Size() const;
+
+	// Get the # of slots
+	std::size_t Capacity() const;
+
+	// Get the # of pushes that had to wait for a free slot
+	long GetFullCount() const;
+};
+
+template<typename T>
+MpscQueue<T>::MpscQueue(std::size_t capacity) :
+	tail(0), head(0), closed(false), fullCount(0)
+{
+	std::size_t size = 2;
+	while (size < capacity)
+		size <<= 1;
+	slots.reset(new Slot[size]);
+	for (std::size_t i = 0; i < size; i++)
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+	mask = size - 1;
+}
+
+template<typename T>
+MpscQueue<T>::~MpscQueue()
+{
+	std::size_t end = tail.load(std::memory_order_acquire);
+	for (std::size_t position = head.load(std::memory_order_relaxed); position != end; position++)
+	{
+		Slot& slot = slots[position & mask];
+		if (slot.sequence.load(std::memory_order_acquire) == position + 1)
+			slot.Item()->~T();
+	}
+}
+
+template<typename T>
+typename MpscQueue<T>::Slot* MpscQueue<T>::Claim(std::size_t& position)
+{
+	position = tail.load(std::memory_order_relaxed);
+	while (true)
+	{
+		Slot* slot = &slots[position & mask];
+		std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+		std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+		if (diff == 0)
+		{
+			if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				return slot;
+		}
+		else if (diff < 0)
+			return nullptr; // the consumer has not freed the slot yet
+		else
+			position = tail.load(std::memory_order_relaxed); // another producer took it
+	}
+}
+
+template<typename T>
+bool MpscQueue<T>::TryPush(const T& item)
+{
+	std::size_t position;
+	Slot* slot = Claim(position);
+	if (slot == nullptr)
+		return false;
+	new (slot->storage) T(item);
+	slot->sequence.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+template<typename T>
+bool MpscQueue<T>::TryPush(T&& item)
+{
+	std::size_t position;
+	Slot* slot = Claim(position);
+	if (slot == nullptr)
+		return false;
+	new (slot->storage) T(std::move(item));
+	slot->sequence.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+template<typename T>
+void MpscQueue<T>::Push(T item)
+{
+	if (TryPush(std::move(item)))
+		return;
+
+	fullCount.fetch_add(1, std::memory_order_relaxed);
+	unsigned spins = 0;
+	do
+		SpscBackoff(spins);
+	while (!TryPush(std::move(item)));
+}
+
+template<typename T>
+template<typename F>
+bool MpscQueue<T>::TryConsume(F&& f)
+{
+	std::size_t position = head.load(std::memory_order_relaxed);
+	Slot* slot = &slots[position & mask];
+	if (slot->sequence.load(std::memory_order_acquire) != position + 1)
+		return false;
+	T* data = slot->Item();
+	f(*data);
+	data->~T();
+	slot->sequence.store(position + mask + 1, std::memory_order_release);
+	head.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+template<typename T>
+bool MpscQueue<T>::TryPop(T& item)
+{
+	return TryConsume([&item](T& data) { item = std::move(data); });
+}
+
+template<typename T>
+bool MpscQueue<T>::Pop(T& item)
+{
+	unsigned spins = 0;
+	while (!TryPop(item))
+	{
+		// check the flag before a last look, so an item pushed before Close() is not lost
+		if (closed.load(std::memory_order_acquire))
+			return TryPop(item);
+		SpscBackoff(spins);
+	}
+	return true;
+}
+
+template<typename T>
+std::size_t MpscQueue<T>::PopBatch(std::vector<T>& batch, std::size_t max)
+{
+	auto take = [&batch](T& data) { batch.push_back(std::move(data)); };
+	unsigned spins = 0;
+	while (!TryConsume(take))
+	{
+		// check the flag before a last look, so an item pushed before Close() is not lost
+		if (closed.load(std::memory_order_acquire))
+		{
+			if (!TryConsume(take))
+				return 0;
+			break;
+		}
+		SpscBackoff(spins);
+	}
+
+	std::size_t count = 1;
+	while (count < max && TryConsume(take))
+		count++;
+	return count;
+}
+
+template<typename T>
+void MpscQueue<T>::Close()
+{
+	closed.store(true, std::memory_order_release);
+}
+
+template<typename T>
+std::size_t MpscQueue<T>::Size() const
+{
+	return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+}
+
+template<typename T>
+std::size_t MpscQueue<T>::Capacity() const
+{
+	return mask + 1;
+}
+
+template<typename T>
+long MpscQueue<T>::GetFullCount() const
+{
+	return fullCount.load(std::memory_order_relaxed);
+}
+
+#endif // !MPSCQUEUE_HPP
@@ -0,0 +1,178 @@
+// OrderBookEngine
+// level-aggregated order book of one product: the bid and offer levels are kept
+// sorted best first in contiguous arrays of (ticks, quantity) and updated in place,
+// so the best bid/offer is the front of each array and depth is a copy of a prefix
+// the arrays reserve their capacity up front, updates and depth queries do not allocate
+// unless a side grows past it
+
+#ifndef ORDERBOOKENGINE_HPP
+#define ORDERBOOKENGINE_HPP
+
+#include "marketdataservice.hpp"
+#include "Tick.hpp"
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+// one aggregated price level
+struct BookLevel
+{
+	long ticks; // price in ticks of 1/256
+	long quantity; // total quantity at this price
+};
+
+class OrderBookEngine
+{
+private:
+	std::vector<BookLevel> levels[2]; // indexed by PricingSide, best level first
+
+	// Whether price a ranks before price b on a side (higher bids, lower offers first)
+	static bool Better(PricingSide side, long a, long b);
+
+	// Get the level at a price, or the position where it would be inserted
+	std::vector<BookLevel>::iterator Find(PricingSide side, long ticks);
+
+public:
+	OrderBookEngine(std::size_t capacity = 64); // ctor, capacity is the # of levels reserved per side
+
+	// Remove all levels
+	void Clear();
+
+	// Add quantity at a price level, creating the level if needed
+	void AddLevel(PricingSide side, long ticks, long quantity);
+
+	// Create a new price level, false (and the book unchanged) if the price already has a level
+	// or the quantity is not positive
+	bool InsertLevel(PricingSide side, long ticks, long quantity);
+
+	// Set the quantity of a price level, a quantity of 0 deletes the level
+	void ModifyLevel(PricingSide side, long ticks, long quantity);
+
+	// Delete a price level
+	void DeleteLevel(PricingSide side, long ticks);
+
+	// Replace the book with the orders of a snapshot, orders at the same price are aggregated
+	template<typename P>
+	void Load(const vector< BasicOrder<P> >& bidStack, const vector< BasicOrder<P> >& offerStack);
+
+	// Whether a side has any level
+	bool HasBest(PricingSide side) const;
+
+	// Get the best level of a side (the side must not be empty)
+	const BookLevel& Best(PricingSide side) const;
+
+	// Get the # of levels on a side
+	std::size_t LevelCount(PricingSide side) const;
+
+	// Get the i-th best level on a side
+	const BookLevel& Level(PricingSide side, std::size_t i) const;
+
+	// Copy up to maxLevels best levels of a side into out, returns the # of levels copied
+	std::size_t Depth(PricingSide side, BookLevel* out, std::size_t maxLevels) const;
+};
+
+OrderBookEngine::OrderBookEngine(std::size_t capacity)
+{
+	levels[BID].reserve(capacity);
+	levels[OFFER].reserve(capacity);
+}
+
+bool OrderBookEngine::Better(PricingSide side, long a, long b)
+{
+	return (side == BID) ? a > b : a < b;
+}
+
+std::vector<BookLevel>::iterator OrderBookEngine::Find(PricingSide side, long ticks)
+{
+	std::vector<BookLevel>& book = levels[side];
+	return std::lower_bound(book.begin(), book.end(), ticks,
+		[side](const BookLevel& level, long price) { return Better(side, level.ticks, price); });
+}
+
+void OrderBookEngine::Clear()
+{
+	levels[BID].clear();
+	levels[OFFER].clear();
+}
+
+void OrderBookEngine::AddLevel(PricingSide side, long ticks, long quantity)
+{
+	auto iter = Find(side, ticks);
+	if (iter != levels[side].end() && iter->ticks == ticks)
+		iter->quantity += quantity;
+	else
+		levels[side].insert(iter, BookLevel{ ticks, quantity });
+}
+
+bool OrderBookEngine::InsertLevel(PricingSide side, long ticks, long quantity)
+{
+	if (quantity <= 0)
+		return false;
+
+	auto iter = Find(side, ticks);
+	if (iter != levels[side].end() && iter->ticks == ticks)
+		return false;
+	levels[side].insert(iter, BookLevel{ ticks, quantity });
+	return true;
+}
+
+void OrderBookEngine::ModifyLevel(PricingSide side, long ticks, long quantity)
+{
+	if (quantity == 0)
+	{
+		DeleteLevel(side, ticks);
+		return;
+	}
+
+	auto iter = Find(side, ticks);
+	if (iter != levels[side].end() && iter->ticks == ticks)
+		iter->quantity = quantity;
+	else
+		levels[side].insert(iter, BookLevel{ ticks, quantity });
+}
+
+void OrderBookEngine::DeleteLevel(PricingSide side, long ticks)
+{
+	auto iter = Find(side, ticks);
+	if (iter != levels[side].end() && iter->ticks == ticks)
+		levels[side].erase(iter);
+}
+
+template<typename P>
+void OrderBookEngine::Load(const vector< BasicOrder<P> >& bidStack, const vector< BasicOrder<P> >& offerStack)
+{
+	Clear();
+	for (auto& order : bidStack)
+		AddLevel(BID, PriceTraits<P>::ToTicks(order.GetPrice()), order.GetQuantity());
+	for (auto& order : offerStack)
+		AddLevel(OFFER, PriceTraits<P>::ToTicks(order.GetPrice()), order.GetQuantity());
+}
+
+bool OrderBookEngine::HasBest(PricingSide side) const
+{
+	return !levels[side].empty();
+}
+
+const BookLevel& OrderBookEngine::Best(PricingSide side) const
+{
+	return levels[side].front();
+}
+
+std::size_t OrderBookEngine::LevelCount(PricingSide side) const
+{
+	return levels[side].size();
+}
+
+const BookLevel& OrderBookEngine::Level(PricingSide side, std::size_t i) const
+{
+	return levels[side][i];
+}
+
+std::size_t OrderBookEngine::Depth(PricingSide side, BookLevel* out, std::size_t maxLevels) const
+{
+	std::size_t count = std::min(maxLevels, levels[side].size());
+	std::copy(levels[side].begin(), levels[side].begin() + count, out);
+	return count;
+}
+
+#endif // !ORDERBOOKENGINE_HPP
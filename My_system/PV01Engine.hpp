@@ -0,0 +1,204 @@
+// PV01Engine
+// structure-of-arrays risk engine: the pv01, quantity and dollar pv01 (pv01 * quantity) of
+// every product live in contiguous 64-byte aligned arrays, one row per product, so portfolio
+// pv01, parallel shift P&L and multi-scenario shocks run as straight loops over the arrays
+// (AVX2 kernels when the compiler targets AVX2, plain loops otherwise); the bucket
+// memberships are a separate list of (row, bucket) pairs, a product may be in any number
+// the BondPV01 objects of the risk service stay the per-product view on top of it
+
+#ifndef PV01ENGINE_HPP
+#define PV01ENGINE_HPP
+
+#include "products.hpp"
+#include "ProductStore.hpp"
+#include <vector>
+#include <new>
+#include <cstddef>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// allocator of the engine arrays, aligned on a cache line
+template<typename T>
+struct AlignedAllocator
+{
+	typedef T value_type;
+
+	AlignedAllocator() {}
+	template<typename U> AlignedAllocator(const AlignedAllocator<U>&) {}
+
+	T* allocate(std::size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(64))); }
+	void deallocate(T* p, std::size_t) { ::operator delete(p, std::align_val_t(64)); }
+
+	template<typename U> bool operator==(const AlignedAllocator<U>&) const { return true; }
+	template<typename U> bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+typedef std::vector<double, AlignedAllocator<double>> AlignedDoubles;
+
+// Sum of x[0, n)
+inline double SumKernel(const double* x, std::size_t n)
+{
+	std::size_t i = 0;
+	double sum = 0.0;
+#if defined(__AVX2__)
+	__m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+	for (; i + 8 <= n; i += 8)
+	{
+		acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(x + i));
+		acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(x + i + 4));
+	}
+	alignas(32) double lanes[4];
+	_mm256_store_pd(lanes, _mm256_add_pd(acc0, acc1));
+	sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+	for (; i < n; i++)
+		sum += x[i];
+	return sum;
+}
+
+// Dot product of x[0, n) and y[0, n)
+inline double DotKernel(const double* x, const double* y, std::size_t n)
+{
+	std::size_t i = 0;
+	double sum = 0.0;
+#if defined(__AVX2__)
+	__m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+	for (; i + 8 <= n; i += 8)
+	{
+		acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+		acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+	}
+	alignas(32) double lanes[4];
+	_mm256_store_pd(lanes, _mm256_add_pd(acc0, acc1));
+	sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+	for (; i < n; i++)
+		sum += x[i] * y[i];
+	return sum;
+}
+
+class PV01Engine
+{
+private:
+	AlignedDoubles pv01s;
+	AlignedDoubles quantities;
+	AlignedDoubles dollarPv01s; // pv01 * quantity, kept on every change
+	std::vector<std::size_t> memberRows; // one entry per bucket membership
+	std::vector<std::size_t> memberBuckets;
+	ProductStore<Bond, std::size_t> rows; // slot on the interned product id, value: row of the product
+
+public:
+	// Add a product, returns its row (the existing row if it was added before)
+	std::size_t AddProduct(const ProductHandle<Bond>& product, double pv01 = 0.0, long quantity = 0);
+
+	// Get the row of a product, -1 if it was not added
+	long GetRow(const ProductHandle<Bond>& product);
+
+	// Set the pv01 and quantity of a row
+	void Set(std::size_t row, double pv01, long quantity);
+
+	// Add a row to a bucket, a row added twice to a bucket counts twice
+	void AddToBucket(std::size_t row, std::size_t bucket);
+
+	// Get the # of bucket memberships
+	std::size_t GetMembershipCount() const;
+
+	// Get the # of products
+	std::size_t Size() const;
+
+	// Get the pv01 * quantity of every row
+	const double* GetDollarPV01s() const;
+
+	// Get the pv01 of the whole portfolio (sum of pv01 * quantity)
+	double GetPortfolioPV01() const;
+
+	// Get the P&L of a parallel shift of the yields by bp basis points
+	double GetParallelShiftPnL(double bp) const;
+
+	// Get the pv01 of each bucket 0 .. bucketCount - 1 into out
+	void GetBucketPV01s(double* out, std::size_t bucketCount) const;
+
+	// Get the P&L of each scenario into out; shocks holds one row of Size() yield shocks
+	// (basis points, in row order) per scenario
+	void GetScenarioPnLs(const double* shocks, std::size_t scenarioCount, double* out) const;
+};
+
+std::size_t PV01Engine::AddProduct(const ProductHandle<Bond>& product, double pv01, long quantity)
+{
+	std::size_t* row = rows.Find(product);
+	if (row != nullptr)
+		return *row;
+
+	std::size_t newRow = pv01s.size();
+	pv01s.push_back(pv01);
+	quantities.push_back(static_cast<double>(quantity));
+	dollarPv01s.push_back(pv01 * quantity);
+	rows[product] = newRow;
+	return newRow;
+}
+
+long PV01Engine::GetRow(const ProductHandle<Bond>& product)
+{
+	std::size_t* row = rows.Find(product);
+	return (row == nullptr) ? -1 : static_cast<long>(*row);
+}
+
+void PV01Engine::Set(std::size_t row, double pv01, long quantity)
+{
+	pv01s[row] = pv01;
+	quantities[row] = static_cast<double>(quantity);
+	dollarPv01s[row] = pv01 * quantity;
+}
+
+void PV01Engine::AddToBucket(std::size_t row, std::size_t bucket)
+{
+	memberRows.push_back(row);
+	memberBuckets.push_back(bucket);
+}
+
+std::size_t PV01Engine::GetMembershipCount() const
+{
+	return memberRows.size();
+}
+
+std::size_t PV01Engine::Size() const
+{
+	return pv01s.size();
+}
+
+const double* PV01Engine::GetDollarPV01s() const
+{
+	return dollarPv01s.data();
+}
+
+double PV01Engine::GetPortfolioPV01() const
+{
+	return SumKernel(dollarPv01s.data(), dollarPv01s.size());
+}
+
+double PV01Engine::GetParallelShiftPnL(double bp) const
+{
+	// yields up, prices down
+	return 0.0 - GetPortfolioPV01() * bp;
+}
+
+void PV01Engine::GetBucketPV01s(double* out, std::size_t bucketCount) const
+{
+	for (std::size_t b = 0; b < bucketCount; b++)
+		out[b] = 0.0;
+	for (std::size_t i = 0; i < memberRows.size(); i++)
+	{
+		if (memberBuckets[i] < bucketCount)
+			out[memberBuckets[i]] += dollarPv01s[memberRows[i]];
+	}
+}
+
+void PV01Engine::GetScenarioPnLs(const double* shocks, std::size_t scenarioCount, double* out) const
+{
+	std::size_t n = dollarPv01s.size();
+	for (std::size_t s = 0; s < scenarioCount; s++)
+		out[s] = 0.0 - DotKernel(dollarPv01s.data(), shocks + s * n, n);
+}
+
+#endif // !PV01ENGINE_HPP
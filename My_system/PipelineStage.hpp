@@ -0,0 +1,232 @@
+// PipelineStage
+// listener adapter that moves the downstream part of a flow onto its own thread:
+// registered on a service in place of a listener, it copies each event into a
+// bounded SPSC queue and a worker thread hands the events to the wrapped listener
+// in the order they arrived, so the events of each product stay in order
+// Type V is the event type, type L the downstream listener type (a final listener class
+// lets the worker call it without virtual dispatch). With MultiProducer the queue is MPSC,
+// so several threads (e.g. the shards of a service) may push; the events of each
+// producer stay in order.
+
+#ifndef PIPELINESTAGE_HPP
+#define PIPELINESTAGE_HPP
+
+#include "soa.hpp"
+#include "SpscQueue.hpp"
+#include "MpscQueue.hpp"
+#include <atomic>
+#include <thread>
+#include <optional>
+#include <type_traits>
+
+// callback an event was received with
+enum StageAction { STAGE_ADD, STAGE_REMOVE, STAGE_UPDATE };
+
+template<typename V, typename L = ServiceListener<V>, bool MultiProducer = false>
+class PipelineStage final : public ServiceListener<V>
+{
+private:
+	struct Event
+	{
+		StageAction action;
+		std::optional<V> data; // empty only in the worker's pop target, V needs no default ctor
+	};
+
+	L* downstream;
+	typename std::conditional<MultiProducer, MpscQueue<Event>, SpscQueue<Event>>::type queue;
+	std::thread worker;
+	std::atomic<long> pushed; // written by the producer(s)
+	std::atomic<long> processed; // written by the worker
+
+	// Count events about to be pushed
+	void CountPushed(long count);
+
+	// Hand an event to the queue
+	void Push(StageAction action, const V &data);
+	void Push(StageAction action, V &&data);
+
+	// Worker loop
+	void Run();
+
+public:
+	PipelineStage(L* _downstream, std::size_t capacity = 1 << 14); // ctor
+	~PipelineStage(); // stops the worker
+
+	// Start the worker thread
+	void Start();
+
+	// Wait until every event pushed so far went through the downstream listener
+	void Drain();
+
+	// Drain the queue and join the worker
+	void Stop();
+
+	// Listener callback to process an add event to the Service
+	virtual void ProcessAdd(V &data);
+
+	// Listener callback to process a remove event to the Service
+	virtual void ProcessRemove(V &data);
+
+	// Listener callback to process an update event to the Service
+	virtual void ProcessUpdate(V &data);
+
+	// Listener callbacks for resident data of the Service, copied into the queue
+	virtual void ProcessAdd(const V &data);
+	virtual void ProcessRemove(const V &data);
+	virtual void ProcessUpdate(const V &data);
+
+	// Listener callbacks for data handed over by the Service, moved into the queue
+	virtual void ProcessAdd(V &&data);
+	virtual void ProcessRemove(V &&data);
+	virtual void ProcessUpdate(V &&data);
+
+	// Listener callback to process a batch of add events, counted once and copied into the queue
+	virtual void ProcessBatch(V *data, std::size_t count);
+};
+
+template<typename V, typename L, bool MultiProducer>
+PipelineStage<V, L, MultiProducer>::PipelineStage(L* _downstream, std::size_t capacity) :
+	downstream(_downstream), queue(capacity), pushed(0), processed(0)
+{
+}
+
+template<typename V, typename L, bool MultiProducer>
+PipelineStage<V, L, MultiProducer>::~PipelineStage()
+{
+	Stop();
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::Start()
+{
+	if (!worker.joinable())
+		worker = std::thread(&PipelineStage<V, L, MultiProducer>::Run, this);
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::Drain()
+{
+	unsigned spins = 0;
+	while (processed.load(std::memory_order_acquire) != pushed.load(std::memory_order_acquire))
+		SpscBackoff(spins);
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::Stop()
+{
+	if (worker.joinable())
+	{
+		queue.Close();
+		worker.join();
+	}
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::CountPushed(long count)
+{
+	// one producer can skip the locked add
+	if constexpr (MultiProducer)
+		pushed.fetch_add(count, std::memory_order_release);
+	else
+		pushed.store(pushed.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::Push(StageAction action, const V &data)
+{
+	CountPushed(1);
+	queue.Push(Event{ action, data });
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::Push(StageAction action, V &&data)
+{
+	CountPushed(1);
+	queue.Push(Event{ action, std::move(data) });
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::Run()
+{
+	Event event{ STAGE_ADD, std::nullopt };
+	while (queue.Pop(event))
+	{
+		switch (event.action)
+		{
+		case STAGE_ADD:
+			downstream->ProcessAdd(*event.data);
+			break;
+		case STAGE_REMOVE:
+			downstream->ProcessRemove(*event.data);
+			break;
+		case STAGE_UPDATE:
+			downstream->ProcessUpdate(*event.data);
+			break;
+		}
+		processed.fetch_add(1, std::memory_order_release);
+	}
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::ProcessAdd(V &data)
+{
+	Push(STAGE_ADD, data);
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::ProcessRemove(V &data)
+{
+	Push(STAGE_REMOVE, data);
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::ProcessUpdate(V &data)
+{
+	Push(STAGE_UPDATE, data);
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::ProcessAdd(const V &data)
+{
+	Push(STAGE_ADD, data);
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::ProcessRemove(const V &data)
+{
+	Push(STAGE_REMOVE, data);
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::ProcessUpdate(const V &data)
+{
+	Push(STAGE_UPDATE, data);
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::ProcessAdd(V &&data)
+{
+	Push(STAGE_ADD, std::move(data));
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::ProcessRemove(V &&data)
+{
+	Push(STAGE_REMOVE, std::move(data));
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::ProcessUpdate(V &&data)
+{
+	Push(STAGE_UPDATE, std::move(data));
+}
+
+template<typename V, typename L, bool MultiProducer>
+void PipelineStage<V, L, MultiProducer>::ProcessBatch(V *data, std::size_t count)
+{
+	CountPushed(static_cast<long>(count));
+	for (std::size_t i = 0; i < count; i++)
+		queue.Push(Event{ STAGE_ADD, data[i] });
+}
+
+#endif // !PIPELINESTAGE_HPP
@@ -0,0 +1,135 @@
+// PriceCodec
+// allocation-free parser and formatter for Treasury fractional prices,
+// e.g. 99-16+ = 99 + 16/32 + 4/256 and 100-253 = 100 + 25/32 + 3/256
+// prices are carried as an integer count of ticks of 1/256
+
+#ifndef PRICECODEC_HPP
+#define PRICECODEC_HPP
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cmath>
+
+// # of ticks in one point of price
+const long TICKS_PER_POINT = 256;
+
+// large enough for any formatted long tick count
+const int PRICE_BUFFER_SIZE = 32;
+
+// digits of the 32nds, "00" to "31"
+static const char thirtySecondsTable[32][2] = {
+	{'0','0'},{'0','1'},{'0','2'},{'0','3'},{'0','4'},{'0','5'},{'0','6'},{'0','7'},
+	{'0','8'},{'0','9'},{'1','0'},{'1','1'},{'1','2'},{'1','3'},{'1','4'},{'1','5'},
+	{'1','6'},{'1','7'},{'1','8'},{'1','9'},{'2','0'},{'2','1'},{'2','2'},{'2','3'},
+	{'2','4'},{'2','5'},{'2','6'},{'2','7'},{'2','8'},{'2','9'},{'3','0'},{'3','1'} };
+
+// digit of the 256ths, a half 32nd is written as '+'
+static const char twoFiftySixthsTable[8] = { '0','1','2','3','+','5','6','7' };
+
+// value of a 256ths digit (or '+'), -1 if it is neither
+inline int TwoFiftySixthsValue(char c)
+{
+	if (c == '+')
+		return 4;
+	return (c >= '0' && c <= '7') ? c - '0' : -1;
+}
+
+// Parse a fractional price in [first, last) into ticks
+// a price without a dash is read as a decimal number and rounded to the nearest tick
+inline long ParseTicks(const char* first, const char* last)
+{
+	bool negative = (first < last && *first == '-');
+	const char* p = negative ? first + 1 : first;
+
+	long whole = 0;
+	while (p < last && *p >= '0' && *p <= '9')
+		whole = whole * 10 + (*p++ - '0');
+
+	long ticks;
+	if (p == last)
+		ticks = whole * TICKS_PER_POINT;
+	else if (*p == '-' && last - p >= 3)
+	{
+		int x = (p[1] - '0') * 10 + (p[2] - '0');
+		int z = (last - p >= 4) ? TwoFiftySixthsValue(p[3]) : 0;
+		if (z < 0)
+			z = 0;
+		ticks = whole * TICKS_PER_POINT + x * 8 + z;
+	}
+	else
+	{
+		// decimal notation
+		double value = 0.0;
+		std::from_chars(first, last, value);
+		return std::lround(value * TICKS_PER_POINT);
+	}
+	return negative ? -ticks : ticks;
+}
+
+// Format ticks into buf (at least PRICE_BUFFER_SIZE chars), returns the # of chars written
+inline int FormatTicks(long ticks, char* buf)
+{
+	char* out = buf;
+	if (ticks < 0)
+	{
+		*out++ = '-';
+		ticks = -ticks;
+	}
+
+	long whole = ticks / TICKS_PER_POINT;
+	int frac = static_cast<int>(ticks % TICKS_PER_POINT);
+
+	// whole part, written backwards then reversed in place
+	char* digits = out;
+	do
+	{
+		*out++ = static_cast<char>('0' + whole % 10);
+		whole /= 10;
+	} while (whole != 0);
+	for (char *l = digits, *r = out - 1; l < r; ++l, --r)
+	{
+		char c = *l;
+		*l = *r;
+		*r = c;
+	}
+
+	*out++ = '-';
+	*out++ = thirtySecondsTable[frac >> 3][0];
+	*out++ = thirtySecondsTable[frac >> 3][1];
+	*out++ = twoFiftySixthsTable[frac & 7];
+	return static_cast<int>(out - buf);
+}
+
+// Convert ticks to a price in points
+inline double TickstoPrice(long ticks)
+{
+	return static_cast<double>(ticks) / TICKS_PER_POINT;
+}
+
+// Convert a price in points to the nearest tick
+inline long PricetoTicks(double price)
+{
+	return std::lround(price * TICKS_PER_POINT);
+}
+
+// Parse a fractional price field into a price in points
+inline double ParsePrice(std::string_view str)
+{
+	return TickstoPrice(ParseTicks(str.data(), str.data() + str.size()));
+}
+
+// Format a price in points into buf, returns the # of chars written
+inline int FormatPrice(double price, char* buf)
+{
+	return FormatTicks(PricetoTicks(price), buf);
+}
+
+// Format a price in points as a string, for the data generators
+inline std::string PricetoStr(double price)
+{
+	char buf[PRICE_BUFFER_SIZE];
+	return std::string(buf, FormatPrice(price, buf));
+}
+
+#endif // !PRICECODEC_HPP
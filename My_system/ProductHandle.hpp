@@ -0,0 +1,97 @@
+// ProductHandle
+// interned reference to a product owned by its product service: a small dense id
+// plus a pointer to the immutable reference data, so that events carry a couple
+// of words instead of a full copy of the product
+// Type T is the product type.
+
+#ifndef PRODUCTHANDLE_HPP
+#define PRODUCTHANDLE_HPP
+
+#include <memory>
+
+template<typename T>
+class ProductHandle
+{
+private:
+	int id; // dense id assigned by the product service, -1 if the product is not interned
+	const T* product;
+	std::shared_ptr<const T> owned; // private copy of a product that is not interned
+
+	// shared empty product for default constructed handles
+	static const T& Empty();
+
+public:
+	ProductHandle(); // empty handle
+	ProductHandle(int _id, const T* _product); // interned product
+	explicit ProductHandle(const T& _product); // product not known to a product service (allocates a copy, shared by the copies of the handle)
+
+	// Get the dense id, -1 if the product is not interned
+	int GetId() const;
+
+	// Whether the product is owned by a product service
+	bool IsInterned() const;
+
+	// Get the product
+	const T& GetProduct() const;
+
+	const T& operator*() const;
+	const T* operator->() const;
+};
+
+template<typename T>
+const T& ProductHandle<T>::Empty()
+{
+	static const T empty;
+	return empty;
+}
+
+template<typename T>
+ProductHandle<T>::ProductHandle() :
+	id(-1), product(&Empty())
+{
+}
+
+template<typename T>
+ProductHandle<T>::ProductHandle(int _id, const T* _product) :
+	id(_id), product(_product)
+{
+}
+
+template<typename T>
+ProductHandle<T>::ProductHandle(const T& _product) :
+	id(-1), owned(std::make_shared<const T>(_product))
+{
+	product = owned.get();
+}
+
+template<typename T>
+int ProductHandle<T>::GetId() const
+{
+	return id;
+}
+
+template<typename T>
+bool ProductHandle<T>::IsInterned() const
+{
+	return id >= 0;
+}
+
+template<typename T>
+const T& ProductHandle<T>::GetProduct() const
+{
+	return *product;
+}
+
+template<typename T>
+const T& ProductHandle<T>::operator*() const
+{
+	return *product;
+}
+
+template<typename T>
+const T* ProductHandle<T>::operator->() const
+{
+	return product;
+}
+
+#endif // !PRODUCTHANDLE_HPP
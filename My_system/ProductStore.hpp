@@ -0,0 +1,191 @@
+// ProductStore
+// product-keyed store for the services: values live in dense slots indexed by
+// the interned product id, so an event carrying a ProductHandle is stored and found
+// by array indexing instead of hashing its CUSIP
+// the string keyed accessors back Service::GetData(string), the identifier of each
+// product is resolved to its slot once, the first time the product is stored
+// the slots live in fixed size chunks that never move, so a reference to a stored value
+// (e.g. a read-only view handed to a listener) stays valid when later products are added
+// Type T is the product type, V the value type.
+
+#ifndef PRODUCTSTORE_HPP
+#define PRODUCTSTORE_HPP
+
+#include "ProductHandle.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <stdexcept>
+
+template<typename T, typename V>
+class ProductStore
+{
+private:
+	static const std::size_t CHUNK_SIZE = 64; // slots per chunk
+
+	std::vector< std::unique_ptr<std::optional<V>[]> > chunks; // slot = dense product id
+	std::unordered_map<std::string, int> slots; // product identifier -> slot
+	std::unordered_map<std::string, V> overflow; // values of products that are not interned
+
+	// Get the slot of a dense id, nullptr if its chunk was never allocated
+	std::optional<V>* SlotOf(std::size_t id) const;
+
+	// Get the slot of an interned product, empty until a value is stored
+	std::optional<V>& Slot(const ProductHandle<T>& product);
+
+public:
+	// Get the value of a product, default constructed on first use (only these need a default ctor of V,
+	// services keep their event types in the store with Set and look them up with Find or At)
+	V& operator[](const ProductHandle<T>& product);
+	V& operator[](const std::string& productId);
+
+	// Store the value of a product, copy constructed on first use
+	V& Set(const ProductHandle<T>& product, const V& value);
+
+	// Find the value of a product, nullptr if there is none
+	V* Find(const ProductHandle<T>& product);
+	V* Find(const std::string& productId);
+	const V* Find(const ProductHandle<T>& product) const;
+	const V* Find(const std::string& productId) const;
+
+	// Get the value of a product, throws std::out_of_range if there is none
+	V& At(const std::string& productId);
+	const V& At(const std::string& productId) const;
+
+	// Get the # of products stored
+	std::size_t Size() const;
+};
+
+template<typename T, typename V>
+std::optional<V>* ProductStore<T, V>::SlotOf(std::size_t id) const
+{
+	std::size_t chunk = id / CHUNK_SIZE;
+	if (chunk >= chunks.size() || !chunks[chunk])
+		return nullptr;
+	return &chunks[chunk][id % CHUNK_SIZE];
+}
+
+template<typename T, typename V>
+std::optional<V>& ProductStore<T, V>::Slot(const ProductHandle<T>& product)
+{
+	std::size_t id = static_cast<std::size_t>(product.GetId());
+	std::size_t chunk = id / CHUNK_SIZE;
+	if (chunk >= chunks.size())
+		chunks.resize(chunk + 1); // moves the chunk pointers, not the values
+	if (!chunks[chunk])
+		chunks[chunk].reset(new std::optional<V>[CHUNK_SIZE]);
+
+	std::optional<V>& slot = chunks[chunk][id % CHUNK_SIZE];
+	if (!slot)
+	{
+		// learn the slot of this identifier, and take over a value stored by identifier before
+		const std::string& productId = product->GetProductId();
+		slots[productId] = product.GetId();
+		auto iter = overflow.find(productId);
+		if (iter != overflow.end())
+		{
+			slot.emplace(std::move(iter->second));
+			overflow.erase(iter);
+		}
+	}
+	return slot;
+}
+
+template<typename T, typename V>
+V& ProductStore<T, V>::operator[](const ProductHandle<T>& product)
+{
+	static_assert(std::is_default_constructible<V>::value, "ProductStore::operator[] needs a default ctor of V, use Set and Find or At");
+	if (!product.IsInterned())
+		return overflow[product->GetProductId()];
+
+	std::optional<V>& slot = Slot(product);
+	if (!slot)
+		slot.emplace();
+	return *slot;
+}
+
+template<typename T, typename V>
+V& ProductStore<T, V>::operator[](const std::string& productId)
+{
+	static_assert(std::is_default_constructible<V>::value, "ProductStore::operator[] needs a default ctor of V, use Set and Find or At");
+	V* value = Find(productId);
+	if (value != nullptr)
+		return *value;
+	return overflow[productId];
+}
+
+template<typename T, typename V>
+V& ProductStore<T, V>::Set(const ProductHandle<T>& product, const V& value)
+{
+	// copy constructed into an empty slot, so V needs no default ctor
+	if (!product.IsInterned())
+		return overflow.insert_or_assign(product->GetProductId(), value).first->second;
+
+	std::optional<V>& slot = Slot(product);
+	if (slot)
+		*slot = value;
+	else
+		slot.emplace(value);
+	return *slot;
+}
+
+template<typename T, typename V>
+V* ProductStore<T, V>::Find(const ProductHandle<T>& product)
+{
+	if (!product.IsInterned())
+		return Find(product->GetProductId());
+
+	std::optional<V>* slot = SlotOf(static_cast<std::size_t>(product.GetId()));
+	if (slot == nullptr || !*slot)
+		return nullptr;
+	return &**slot;
+}
+
+template<typename T, typename V>
+V* ProductStore<T, V>::Find(const std::string& productId)
+{
+	auto iter = slots.find(productId);
+	if (iter != slots.end())
+		return &**SlotOf(static_cast<std::size_t>(iter->second));
+
+	auto other = overflow.find(productId);
+	return (other == overflow.end()) ? nullptr : &other->second;
+}
+
+template<typename T, typename V>
+const V* ProductStore<T, V>::Find(const ProductHandle<T>& product) const
+{
+	return const_cast<ProductStore*>(this)->Find(product); // the lookup changes nothing
+}
+
+template<typename T, typename V>
+const V* ProductStore<T, V>::Find(const std::string& productId) const
+{
+	return const_cast<ProductStore*>(this)->Find(productId);
+}
+
+template<typename T, typename V>
+V& ProductStore<T, V>::At(const std::string& productId)
+{
+	V* value = Find(productId);
+	if (value == nullptr)
+		throw std::out_of_range("ProductStore::At: unknown product " + productId);
+	return *value;
+}
+
+template<typename T, typename V>
+const V& ProductStore<T, V>::At(const std::string& productId) const
+{
+	return const_cast<ProductStore*>(this)->At(productId);
+}
+
+template<typename T, typename V>
+std::size_t ProductStore<T, V>::Size() const
+{
+	return slots.size() + overflow.size();
+}
+
+#endif // !PRODUCTSTORE_HPP
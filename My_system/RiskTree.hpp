@@ -0,0 +1,198 @@
+// RiskTree
+// configurable aggregation tree over the bond risk: nodes form any hierarchy (for example
+// book -> desk -> sector -> total), the position of a product in a book rolls up into
+// the node its book (or else its product) is attached to; every node keeps the running
+// quantity and pv01 * quantity of everything below it, so a position change only walks
+// its own path to the root and the risk of any node is read without a recompute
+// updates come from the risk service under its lock; read the nodes once the flows feeding
+// the risk service are drained
+
+#ifndef RISKTREE_HPP
+#define RISKTREE_HPP
+
+#include "products.hpp"
+#include "ProductStore.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+
+// aggregated risk of a node
+struct RiskNode
+{
+	std::string name;
+	int parent; // -1 for a root
+	long long quantity; // sum of the quantities below the node
+	double pv01; // sum of pv01 * quantity below the node
+
+	// Get the quantity weighted pv01 of the node
+	double GetUnitPV01() const { return quantity == 0 ? 0.0 : pv01 / quantity; }
+};
+
+class RiskTree
+{
+private:
+	// last risk of a product in a book that went into the tree
+	struct Exposure
+	{
+		std::string book;
+		int node; // -1 if the book and the product are attached nowhere
+		long quantity;
+		double pv01;
+	};
+
+	std::vector<RiskNode> nodes;
+	std::unordered_map<std::string, int> nodeIds; // node name -> node
+	std::unordered_map<std::string, int> bookNodes; // book -> node
+	std::unordered_map<std::string, int> productNodes; // product identifier -> node
+	ProductStore<Bond, std::vector<Exposure>> exposures; // slot on the interned product id, a few books each
+
+	// Get the node of a name, -1 if there is none
+	int Find(const std::string& name) const;
+
+	// Add a change of quantity and pv01 * quantity to a node and every node above it
+	void Propagate(int node, long long quantity, double pv01);
+
+public:
+	// Add a node under a parent node, a root without one; returns the node, -1 if the parent is unknown
+	int AddNode(const std::string& name, const std::string& parent = "");
+
+	// Roll the positions of a book up into a node
+	void AttachBook(const std::string& book, const std::string& node);
+
+	// Roll the positions of a product up into a node, for books that are attached nowhere
+	void AttachProduct(const std::string& productId, const std::string& node);
+
+	// Set the position of a product in a book at a pv01, the change goes up the path of its node
+	void Update(const ProductHandle<Bond>& product, const std::string& book, long quantity, double pv01);
+
+	// Set the pv01 of a product in every book it has a position in, the changes go up their paths
+	void Reprice(const ProductHandle<Bond>& product, double pv01);
+
+	// Get the risk of a node, throws std::out_of_range for an unknown name
+	const RiskNode& GetNode(const std::string& name) const;
+
+	// Get all nodes, parents before their children
+	const std::vector<RiskNode>& GetNodes() const;
+};
+
+int RiskTree::Find(const std::string& name) const
+{
+	auto iter = nodeIds.find(name);
+	return (iter == nodeIds.end()) ? -1 : iter->second;
+}
+
+int RiskTree::AddNode(const std::string& name, const std::string& parent)
+{
+	int existing = Find(name);
+	if (existing != -1)
+		return existing;
+
+	int parentId = -1;
+	if (!parent.empty())
+	{
+		parentId = Find(parent);
+		if (parentId == -1)
+		{
+			std::cout << "Cannot find the parent node " << parent << "!" << std::endl;
+			return -1;
+		}
+	}
+
+	int id = static_cast<int>(nodes.size());
+	nodes.push_back(RiskNode{ name, parentId, 0, 0.0 });
+	nodeIds.emplace(name, id);
+	return id;
+}
+
+void RiskTree::AttachBook(const std::string& book, const std::string& node)
+{
+	int id = Find(node);
+	if (id == -1)
+		std::cout << "Cannot find the node " << node << "!" << std::endl;
+	else
+		bookNodes[book] = id;
+}
+
+void RiskTree::AttachProduct(const std::string& productId, const std::string& node)
+{
+	int id = Find(node);
+	if (id == -1)
+		std::cout << "Cannot find the node " << node << "!" << std::endl;
+	else
+		productNodes[productId] = id;
+}
+
+void RiskTree::Propagate(int node, long long quantity, double pv01)
+{
+	for (; node != -1; node = nodes[node].parent)
+	{
+		nodes[node].quantity += quantity;
+		nodes[node].pv01 += pv01;
+	}
+}
+
+void RiskTree::Update(const ProductHandle<Bond>& product, const std::string& book, long quantity, double pv01)
+{
+	std::vector<Exposure>& books = exposures[product];
+	Exposure* exposure = nullptr;
+	for (Exposure& entry : books)
+	{
+		if (entry.book == book)
+		{
+			exposure = &entry;
+			break;
+		}
+	}
+
+	// first position of the product in this book, resolve its node once
+	if (exposure == nullptr)
+	{
+		int node = -1;
+		auto bookNode = bookNodes.find(book);
+		if (bookNode != bookNodes.end())
+			node = bookNode->second;
+		else
+		{
+			auto productNode = productNodes.find(product->GetProductId());
+			if (productNode != productNodes.end())
+				node = productNode->second;
+		}
+		books.push_back(Exposure{ book, node, 0, 0.0 });
+		exposure = &books.back();
+	}
+
+	if (exposure->quantity == quantity && exposure->pv01 == pv01)
+		return;
+
+	Propagate(exposure->node, static_cast<long long>(quantity) - exposure->quantity, pv01 * quantity - exposure->pv01 * exposure->quantity);
+	exposure->quantity = quantity;
+	exposure->pv01 = pv01;
+}
+
+void RiskTree::Reprice(const ProductHandle<Bond>& product, double pv01)
+{
+	std::vector<Exposure>* books = exposures.Find(product);
+	if (books == nullptr)
+		return;
+
+	for (Exposure& exposure : *books)
+	{
+		if (exposure.pv01 == pv01)
+			continue;
+		Propagate(exposure.node, 0, (pv01 - exposure.pv01) * exposure.quantity);
+		exposure.pv01 = pv01;
+	}
+}
+
+const RiskNode& RiskTree::GetNode(const std::string& name) const
+{
+	return nodes[nodeIds.at(name)];
+}
+
+const std::vector<RiskNode>& RiskTree::GetNodes() const
+{
+	return nodes;
+}
+
+#endif // !RISKTREE_HPP
@@ -0,0 +1,161 @@
+// SpscQueue
+// bounded lock-free ring buffer between exactly one producer thread and one consumer
+// thread; the head and tail indices sit on their own cache lines and each side only
+// writes its own index, so a push or pop is a copy plus one release store
+// Type T must be default constructible (the slots are preallocated).
+
+#ifndef SPSCQUEUE_HPP
+#define SPSCQUEUE_HPP
+
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstddef>
+#include <utility>
+
+// Back off while waiting on the other side of a queue: spin briefly, then yield, then sleep
+inline void SpscBackoff(unsigned& spins)
+{
+	if (spins < 64)
+		++spins;
+	else if (spins < 128)
+	{
+		++spins;
+		std::this_thread::yield();
+	}
+	else
+		std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+template<typename T>
+class SpscQueue
+{
+private:
+	std::vector<T> slots;
+	std::size_t mask; // capacity - 1, the capacity is a power of 2
+
+	alignas(64) std::atomic<std::size_t> head; // next slot to pop, written by the consumer
+	alignas(64) std::atomic<std::size_t> tail; // next slot to push, written by the producer
+	alignas(64) std::atomic<bool> closed;
+
+public:
+	explicit SpscQueue(std::size_t capacity = 1 << 14); // ctor, the capacity is rounded up to a power of 2
+
+	// Push an item, false if the queue is full
+	bool TryPush(const T& item);
+	bool TryPush(T&& item);
+
+	// Push an item, waiting while the queue is full
+	void Push(T item);
+
+	// Pop an item, false if the queue is empty
+	bool TryPop(T& item);
+
+	// Pop an item, waiting while the queue is empty; false once the queue is closed and empty
+	bool Pop(T& item);
+
+	// No more items will be pushed, wakes up a waiting consumer
+	void Close();
+
+	// Whether the queue was closed
+	bool IsClosed() const;
+
+	// Get the # of items in the queue (approximate while both sides run)
+	std::size_t Size() const;
+
+	// Get the # of slots
+	std::size_t Capacity() const;
+};
+
+template<typename T>
+SpscQueue<T>::SpscQueue(std::size_t capacity) :
+	head(0), tail(0), closed(false)
+{
+	std::size_t size = 2;
+	while (size < capacity)
+		size <<= 1;
+	slots.resize(size);
+	mask = size - 1;
+}
+
+template<typename T>
+bool SpscQueue<T>::TryPush(const T& item)
+{
+	std::size_t t = tail.load(std::memory_order_relaxed);
+	if (t - head.load(std::memory_order_acquire) > mask)
+		return false;
+	slots[t & mask] = item;
+	tail.store(t + 1, std::memory_order_release);
+	return true;
+}
+
+template<typename T>
+bool SpscQueue<T>::TryPush(T&& item)
+{
+	std::size_t t = tail.load(std::memory_order_relaxed);
+	if (t - head.load(std::memory_order_acquire) > mask)
+		return false;
+	slots[t & mask] = std::move(item);
+	tail.store(t + 1, std::memory_order_release);
+	return true;
+}
+
+template<typename T>
+void SpscQueue<T>::Push(T item)
+{
+	unsigned spins = 0;
+	while (!TryPush(std::move(item)))
+		SpscBackoff(spins);
+}
+
+template<typename T>
+bool SpscQueue<T>::TryPop(T& item)
+{
+	std::size_t h = head.load(std::memory_order_relaxed);
+	if (h == tail.load(std::memory_order_acquire))
+		return false;
+	item = std::move(slots[h & mask]);
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+template<typename T>
+bool SpscQueue<T>::Pop(T& item)
+{
+	unsigned spins = 0;
+	while (!TryPop(item))
+	{
+		// check the flag before a last look, so an item pushed before Close() is not lost
+		if (closed.load(std::memory_order_acquire))
+			return TryPop(item);
+		SpscBackoff(spins);
+	}
+	return true;
+}
+
+template<typename T>
+void SpscQueue<T>::Close()
+{
+	closed.store(true, std::memory_order_release);
+}
+
+template<typename T>
+bool SpscQueue<T>::IsClosed() const
+{
+	return closed.load(std::memory_order_acquire);
+}
+
+template<typename T>
+std::size_t SpscQueue<T>::Size() const
+{
+	return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+}
+
+template<typename T>
+std::size_t SpscQueue<T>::Capacity() const
+{
+	return mask + 1;
+}
+
+#endif // !SPSCQUEUE_HPP
@@ -0,0 +1,147 @@
+// StaticListeners
+// listeners of a service wired at compile time, for the parts of the service graph
+// that never change at runtime: the set holds typed pointers and calls each listener
+// through its own type, so with final listener classes the compiler devirtualizes and
+// can inline the whole hop; services keep their AddListener path for everything else
+// Type V is the event type, types L... are the listener types.
+
+#ifndef STATICLISTENERS_HPP
+#define STATICLISTENERS_HPP
+
+#include "soa.hpp"
+#include <tuple>
+#include <utility>
+
+// empty set, the default of services that can be wired statically (calls compile away)
+template<typename V>
+class NoListeners
+{
+public:
+	template<typename D> void Add(D &) {}
+	template<typename D> void Remove(D &) {}
+	template<typename D> void Update(D &) {}
+	void Batch(V *, std::size_t) {}
+};
+
+template<typename V, typename... L>
+class StaticListeners final : public ServiceListener<V>
+{
+private:
+	std::tuple<L*...> listeners;
+
+	template<typename D, std::size_t... I>
+	void AddAll(D &data, std::index_sequence<I...>) { (std::get<I>(listeners)->ProcessAdd(data), ...); }
+
+	template<typename D, std::size_t... I>
+	void RemoveAll(D &data, std::index_sequence<I...>) { (std::get<I>(listeners)->ProcessRemove(data), ...); }
+
+	template<typename D, std::size_t... I>
+	void UpdateAll(D &data, std::index_sequence<I...>) { (std::get<I>(listeners)->ProcessUpdate(data), ...); }
+
+	template<std::size_t... I>
+	void BatchAll(V *data, std::size_t count, std::index_sequence<I...>) { (std::get<I>(listeners)->ProcessBatch(data, count), ...); }
+
+public:
+	StaticListeners(L*... _listeners); // ctor, the listeners are called in this order
+
+	// Call every listener for an add event, D is V or const V (resident data of the service)
+	template<typename D>
+	void Add(D &data);
+
+	// Call every listener for a remove event
+	template<typename D>
+	void Remove(D &data);
+
+	// Call every listener for an update event
+	template<typename D>
+	void Update(D &data);
+
+	// Call every listener for a batch of add events, each listener gets the whole batch in turn
+	void Batch(V *data, std::size_t count);
+
+	// the set is a listener itself, so it can also be added to a service at runtime
+	virtual void ProcessAdd(V &data);
+	virtual void ProcessRemove(V &data);
+	virtual void ProcessUpdate(V &data);
+	virtual void ProcessAdd(const V &data);
+	virtual void ProcessRemove(const V &data);
+	virtual void ProcessUpdate(const V &data);
+	virtual void ProcessBatch(V *data, std::size_t count);
+};
+
+template<typename V, typename... L>
+StaticListeners<V, L...>::StaticListeners(L*... _listeners) :
+	listeners(_listeners...)
+{
+}
+
+template<typename V, typename... L>
+template<typename D>
+inline void StaticListeners<V, L...>::Add(D &data)
+{
+	AddAll(data, std::index_sequence_for<L...>());
+}
+
+template<typename V, typename... L>
+template<typename D>
+inline void StaticListeners<V, L...>::Remove(D &data)
+{
+	RemoveAll(data, std::index_sequence_for<L...>());
+}
+
+template<typename V, typename... L>
+template<typename D>
+inline void StaticListeners<V, L...>::Update(D &data)
+{
+	UpdateAll(data, std::index_sequence_for<L...>());
+}
+
+template<typename V, typename... L>
+inline void StaticListeners<V, L...>::Batch(V *data, std::size_t count)
+{
+	BatchAll(data, count, std::index_sequence_for<L...>());
+}
+
+template<typename V, typename... L>
+void StaticListeners<V, L...>::ProcessAdd(V &data)
+{
+	Add(data);
+}
+
+template<typename V, typename... L>
+void StaticListeners<V, L...>::ProcessRemove(V &data)
+{
+	Remove(data);
+}
+
+template<typename V, typename... L>
+void StaticListeners<V, L...>::ProcessUpdate(V &data)
+{
+	Update(data);
+}
+
+template<typename V, typename... L>
+void StaticListeners<V, L...>::ProcessAdd(const V &data)
+{
+	Add(data);
+}
+
+template<typename V, typename... L>
+void StaticListeners<V, L...>::ProcessRemove(const V &data)
+{
+	Remove(data);
+}
+
+template<typename V, typename... L>
+void StaticListeners<V, L...>::ProcessUpdate(const V &data)
+{
+	Update(data);
+}
+
+template<typename V, typename... L>
+void StaticListeners<V, L...>::ProcessBatch(V *data, std::size_t count)
+{
+	Batch(data, count);
+}
+
+#endif // !STATICLISTENERS_HPP
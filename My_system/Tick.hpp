@@ -0,0 +1,85 @@
+// Tick
+// fixed-point price counted in ticks of 1/256, an opt-in alternative to double
+// for the price fields of Order, Price, PriceStreamOrder and ExecutionOrder
+// comparisons, hashing and aggregation on ticks are exact
+
+#ifndef TICK_HPP
+#define TICK_HPP
+
+#include "PriceCodec.hpp"
+#include <functional>
+#include <iostream>
+#include <string_view>
+
+class Tick
+{
+private:
+	long ticks;
+
+public:
+	Tick() : ticks(0) {}
+	explicit Tick(long _ticks) : ticks(_ticks) {}
+
+	// Get the nearest tick to a price in points
+	static Tick FromPrice(double price) { return Tick(PricetoTicks(price)); }
+
+	// Get the # of ticks
+	long GetTicks() const { return ticks; }
+
+	// Get the price in points
+	double GetPrice() const { return TickstoPrice(ticks); }
+
+	Tick operator+(Tick other) const { return Tick(ticks + other.ticks); }
+	Tick operator-(Tick other) const { return Tick(ticks - other.ticks); }
+	Tick operator-() const { return Tick(-ticks); }
+	Tick& operator+=(Tick other) { ticks += other.ticks; return *this; }
+	Tick& operator-=(Tick other) { ticks -= other.ticks; return *this; }
+
+	bool operator==(Tick other) const { return ticks == other.ticks; }
+	bool operator!=(Tick other) const { return ticks != other.ticks; }
+	bool operator<(Tick other) const { return ticks < other.ticks; }
+	bool operator<=(Tick other) const { return ticks <= other.ticks; }
+	bool operator>(Tick other) const { return ticks > other.ticks; }
+	bool operator>=(Tick other) const { return ticks >= other.ticks; }
+
+	// Print the tick in fractional notation (e.g. 99-16+)
+	friend std::ostream& operator<<(std::ostream &output, const Tick &tick)
+	{
+		char buf[PRICE_BUFFER_SIZE];
+		return output << std::string_view(buf, FormatTicks(tick.ticks, buf));
+	}
+};
+
+namespace std
+{
+	template<>
+	struct hash<Tick>
+	{
+		size_t operator()(const Tick &tick) const { return hash<long>()(tick.GetTicks()); }
+	};
+}
+
+/**
+ * Conversions between a price representation P and ticks/points,
+ * so that services can be written once for double and Tick prices.
+ */
+template<typename P>
+struct PriceTraits;
+
+template<>
+struct PriceTraits<double>
+{
+	static long ToTicks(double price) { return PricetoTicks(price); }
+	static double FromTicks(long ticks) { return TickstoPrice(ticks); }
+	static double ToPrice(double price) { return price; }
+};
+
+template<>
+struct PriceTraits<Tick>
+{
+	static long ToTicks(Tick price) { return price.GetTicks(); }
+	static Tick FromTicks(long ticks) { return Tick(ticks); }
+	static double ToPrice(Tick price) { return price.GetPrice(); }
+};
+
+#endif // !TICK_HPP
@@ -0,0 +1,174 @@
+// TimestampFormatter
+// shared clock and timestamp formatting for the publish connectors: the formatted
+// "date hh:mm:ss." prefix is cached for the current second, so a timestamp in the
+// same second only writes its millisecond digits into the caller buffer
+// the record clock is the system clock, or optionally a TSC based clock that is
+// calibrated once against it (cheaper to read and monotonic)
+
+#ifndef TIMESTAMPFORMATTER_HPP
+#define TIMESTAMPFORMATTER_HPP
+
+#include "products.hpp"
+#include "boost/date_time/posix_time/posix_time.hpp"
+#include "boost/date_time/c_local_time_adjustor.hpp"
+#include <chrono>
+#include <thread>
+#include <string>
+#include <cstring>
+#include <ctime>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// time a record was published, taken on the publishing thread
+typedef std::chrono::system_clock::time_point RecordTime;
+
+// clock the records are stamped with
+enum ClockSource { SYSTEM_CLOCK, TSC_CLOCK };
+
+// large enough for "yyyy-mm-dd hh:mm:ss.mmm"
+const int TIMESTAMP_BUFFER_SIZE = 32;
+
+// Format a date as "yyyy-mm-dd"
+inline std::string DatetoStr(const boost::gregorian::date& date)
+{
+	return boost::gregorian::to_iso_extended_string(date);
+}
+
+// Monotonic clock on the time stamp counter, mapped onto the system clock at calibration
+class TscClock
+{
+private:
+	unsigned long long counterBase;
+	RecordTime timeBase;
+	double nsPerTick;
+
+	// Read the counter (steady_clock where there is no TSC)
+	static unsigned long long Counter();
+
+	TscClock(); // calibrates for a few milliseconds
+
+public:
+	// Get the shared clock, calibrated on first use
+	static const TscClock& Instance();
+
+	// Get the current time
+	RecordTime Now() const;
+};
+
+inline unsigned long long TscClock::Counter()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return static_cast<unsigned long long>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+inline TscClock::TscClock()
+{
+	auto start = std::chrono::steady_clock::now();
+	unsigned long long startCounter = Counter();
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	auto stop = std::chrono::steady_clock::now();
+	unsigned long long stopCounter = Counter();
+
+	double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+	nsPerTick = ns / static_cast<double>(stopCounter - startCounter);
+	counterBase = Counter();
+	timeBase = std::chrono::system_clock::now();
+}
+
+inline const TscClock& TscClock::Instance()
+{
+	static const TscClock clock;
+	return clock;
+}
+
+inline RecordTime TscClock::Now() const
+{
+	long long ns = static_cast<long long>(static_cast<double>(Counter() - counterBase) * nsPerTick);
+	return timeBase + std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(ns));
+}
+
+// Get or set the clock the connectors stamp records with (set it before the flows start)
+inline ClockSource& RecordClockSource()
+{
+	static ClockSource source = SYSTEM_CLOCK;
+	return source;
+}
+
+// Get the time for a record
+inline RecordTime RecordNow()
+{
+	if (RecordClockSource() == TSC_CLOCK)
+		return TscClock::Instance().Now();
+	return std::chrono::system_clock::now();
+}
+
+// Formatter of record times in local time, one per formatting thread
+class TimestampFormatter
+{
+private:
+	long long cachedSecond; // epoch second of the cached prefix
+	char prefix[TIMESTAMP_BUFFER_SIZE]; // "yyyy-mm-dd hh:mm:ss."
+	int prefixLength;
+
+	// Rebuild the prefix for an epoch second
+	void Cache(long long second);
+
+public:
+	TimestampFormatter(); // ctor
+
+	// Format a time as "yyyy-mm-dd hh:mm:ss.mmm" into buf (TIMESTAMP_BUFFER_SIZE chars), returns the # of chars written
+	int Format(RecordTime time, char* buf);
+};
+
+inline TimestampFormatter::TimestampFormatter() :
+	cachedSecond(-1), prefixLength(0)
+{
+}
+
+inline void TimestampFormatter::Cache(long long second)
+{
+	boost::posix_time::ptime utc = boost::posix_time::from_time_t(static_cast<std::time_t>(second));
+	boost::posix_time::ptime local = boost::date_time::c_local_adjustor<boost::posix_time::ptime>::utc_to_local(utc);
+
+	std::string text = DatetoStr(local.date()) + " " + boost::posix_time::to_simple_string(local.time_of_day()) + ".";
+	prefixLength = static_cast<int>(text.size() < sizeof(prefix) ? text.size() : sizeof(prefix) - 4);
+	std::memcpy(prefix, text.data(), prefixLength);
+	cachedSecond = second;
+}
+
+inline int TimestampFormatter::Format(RecordTime time, char* buf)
+{
+	long long us = std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+	long long second = us / 1000000;
+	if (second != cachedSecond)
+		Cache(second);
+
+	int ms = static_cast<int>((us % 1000000) / 1000);
+	std::memcpy(buf, prefix, prefixLength);
+	buf[prefixLength] = static_cast<char>('0' + ms / 100);
+	buf[prefixLength + 1] = static_cast<char>('0' + ms / 10 % 10);
+	buf[prefixLength + 2] = static_cast<char>('0' + ms % 10);
+	return prefixLength + 3;
+}
+
+// Format a record time into buf with the formatter of the calling thread, returns the # of chars written
+inline int FormatTimestamp(RecordTime time, char* buf)
+{
+	thread_local TimestampFormatter formatter;
+	return formatter.Format(time, buf);
+}
+
+// Append a record time in local time as "yyyy-mm-dd hh:mm:ss.mmm"
+inline void AppendTimestamp(std::string& out, RecordTime time)
+{
+	char buf[TIMESTAMP_BUFFER_SIZE];
+	out.append(buf, FormatTimestamp(time, buf));
+}
+
+#endif // !TIMESTAMPFORMATTER_HPP
@@ -0,0 +1,129 @@
+// DispatchBench
+// ns per event of handing a price down a fixed chain of listeners (two forwarding hops
+// and a last listener summing the mids): through runtime ServiceListener pointers
+// (virtual dispatch) against StaticListeners with final listener types (inlined), for
+// the chain alone and behind BondPricingService::OnMessage
+// usage: DispatchBench [events = 20000000]
+
+#include "BondPricing.hpp"
+#include "StaticListeners.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// last listener of the chain
+class SumListener final : public ServiceListener<BondPrice>
+{
+public:
+	double sum = 0.0;
+
+	using ServiceListener<BondPrice>::ProcessAdd;
+	using ServiceListener<BondPrice>::ProcessRemove;
+	using ServiceListener<BondPrice>::ProcessUpdate;
+
+	virtual void ProcessAdd(BondPrice &price) { sum += price.GetMid(); }
+	virtual void ProcessRemove(BondPrice &) {}
+	virtual void ProcessUpdate(BondPrice &) {}
+};
+
+// forwarding hop to a listener known only at runtime
+class VirtualHop final : public ServiceListener<BondPrice>
+{
+private:
+	ServiceListener<BondPrice>* next;
+
+public:
+	VirtualHop(ServiceListener<BondPrice>* _next) : next(_next) {}
+
+	using ServiceListener<BondPrice>::ProcessAdd;
+	using ServiceListener<BondPrice>::ProcessRemove;
+	using ServiceListener<BondPrice>::ProcessUpdate;
+
+	virtual void ProcessAdd(BondPrice &price) { next->ProcessAdd(price); }
+	virtual void ProcessRemove(BondPrice &) {}
+	virtual void ProcessUpdate(BondPrice &) {}
+};
+
+// forwarding hop to a listener of a final type N
+template<typename N>
+class StaticHop final : public ServiceListener<BondPrice>
+{
+private:
+	N* next;
+
+public:
+	StaticHop(N* _next) : next(_next) {}
+
+	using ServiceListener<BondPrice>::ProcessAdd;
+	using ServiceListener<BondPrice>::ProcessRemove;
+	using ServiceListener<BondPrice>::ProcessUpdate;
+
+	virtual void ProcessAdd(BondPrice &price) { next->ProcessAdd(price); }
+	virtual void ProcessRemove(BondPrice &) {}
+	virtual void ProcessUpdate(BondPrice &) {}
+};
+
+typedef StaticHop<StaticHop<SumListener>> StaticChain;
+
+// Time events calls of f over the prices and print the ns per event
+template<typename F>
+void Measure(const std::string& name, std::vector<BondPrice>& prices, long events, const SumListener& last, F f)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (long i = 0; i < events; i++)
+		f(prices[i & 1023]);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ": " << seconds * 1e9 / events << " ns/event (checksum " << last.sum << ")" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	long events = (argc > 1) ? std::strtol(argv[1], nullptr, 10) : 20000000;
+
+	std::vector<Bond> bonds;
+	for (int i = 0; i < 6; i++)
+		bonds.push_back(Bond("912828" + std::to_string(100 + i), CUSIP, "T", 2.0f + i, boost::gregorian::date(2020 + i, boost::gregorian::Nov, 30)));
+	std::vector<BondPrice> prices;
+	for (int i = 0; i < 1024; i++)
+		prices.push_back(BondPrice(ProductHandle<Bond>(i % 6, &bonds[i % 6]), 99.0 + (i % 512) / 256.0, 1.0 / 128));
+
+	// the chain alone
+	SumListener virtualLast;
+	VirtualHop virtualSecond(&virtualLast);
+	VirtualHop virtualFirst(&virtualSecond);
+	std::vector<ServiceListener<BondPrice>*> runtimeListeners{ &virtualFirst };
+	Measure("chain,   virtual dispatch", prices, events, virtualLast, [&](BondPrice& price) {
+		for (auto listener : runtimeListeners)
+			listener->ProcessAdd(price);
+	});
+
+	SumListener staticLast;
+	StaticHop<SumListener> staticSecond(&staticLast);
+	StaticChain staticFirst(&staticSecond);
+	StaticListeners<BondPrice, StaticChain> fixedListeners(&staticFirst);
+	Measure("chain,   static dispatch ", prices, events, staticLast, [&](BondPrice& price) {
+		fixedListeners.Add(price);
+	});
+
+	// behind the pricing service, which also stores each price
+	SumListener serviceVirtualLast;
+	VirtualHop serviceVirtualSecond(&serviceVirtualLast);
+	VirtualHop serviceVirtualFirst(&serviceVirtualSecond);
+	BondPricingService dynamicService;
+	dynamicService.AddListener(&serviceVirtualFirst);
+	Measure("service, virtual dispatch", prices, events, serviceVirtualLast, [&](BondPrice& price) {
+		dynamicService.OnMessage(price);
+	});
+
+	SumListener serviceStaticLast;
+	StaticHop<SumListener> serviceStaticSecond(&serviceStaticLast);
+	StaticChain serviceStaticFirst(&serviceStaticSecond);
+	StaticListeners<BondPrice, StaticChain> serviceFixedListeners(&serviceStaticFirst);
+	BondPricingServiceT<StaticListeners<BondPrice, StaticChain>> staticService(serviceFixedListeners);
+	Measure("service, static dispatch ", prices, events, serviceStaticLast, [&](BondPrice& price) {
+		staticService.OnMessage(price);
+	});
+	return 0;
+}
@@ -0,0 +1,177 @@
+// IngestionBench
+// rows/sec of reading order book rows in the marketdata.txt format: the original path
+// (getline, stringstream, trimmed std::string cells, string price parsing) against the
+// LineTokenizer in STREAMED and MAPPED modes; every path builds the 5 bid and 5 offer
+// orders of each row, the service is left out
+// usage: IngestionBench [size in MB = 2048] [file = marketdata_bench.txt]
+// the file is generated once and reused while it is large enough
+
+#include "LineTokenizer.hpp"
+#include "PriceCodec.hpp"
+#include "marketdataservice.hpp"
+#include "boost/algorithm/string.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+// Get the size of a file in bytes, 0 if it cannot be opened
+std::size_t FileSize(const std::string& path)
+{
+	std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+	return file.is_open() ? static_cast<std::size_t>(file.tellg()) : 0;
+}
+
+// Write order book rows to path until it holds at least bytes bytes
+void GenerateFile(const std::string& path, std::size_t bytes)
+{
+	std::ofstream file(path, std::ios::out | std::ios::trunc | std::ios::binary);
+	file << "BondIDType,BondID,Price,Spread1,Spread2,Spread3,Spread4,Spread5,Size1,Size2,Size3,Size4,Size5\n";
+
+	const char* cusips[] = { "9128285M8", "9128285P1", "9128285Q9", "9128285S5", "9128285T3", "912810SE9" };
+	char line[256];
+	char price[PRICE_BUFFER_SIZE];
+	char spreads[5][PRICE_BUFFER_SIZE];
+	std::size_t written = 0;
+	for (long i = 0; written < bytes; i++)
+	{
+		// same shape as bond_market_data_generator: mids from 99 to 101 and back, spreads from 1/128
+		long step = (i / 6) % 1024;
+		price[FormatTicks(99 * TICKS_PER_POINT + ((step < 512) ? step : 1024 - step), price)] = '\0';
+		long top = (i / 6) % 6;
+		top = (top < 3) ? top : 6 - top;
+		for (int k = 0; k < 5; k++)
+			spreads[k][FormatTicks(2 * (k + 1 + top), spreads[k])] = '\0';
+
+		int length = std::snprintf(line, sizeof(line), "CUSIP,%s,%s,%s,%s,%s,%s,%s,10000000,20000000,30000000,40000000,50000000\n",
+			cusips[i % 6], price, spreads[0], spreads[1], spreads[2], spreads[3], spreads[4]);
+		file.write(line, length);
+		written += length;
+	}
+}
+
+// Parse a price the way the original connector did, through std::string pieces
+double LegacyStrtoPrice(const std::string& str)
+{
+	std::size_t dash = str.find('-');
+	if (dash == std::string::npos)
+		return std::stod(str);
+	double whole = std::stod(str.substr(0, dash));
+	int thirtySeconds = std::stoi(str.substr(dash + 1, 2));
+	std::string last = str.substr(dash + 3, 1);
+	int eighths = (last == "+") ? 4 : std::stoi(last);
+	return whole + thirtySeconds / 32.0 + eighths / 256.0;
+}
+
+// Original path: one std::string per line and per cell, returns the # of rows
+long ReadLegacy(const std::string& path, double& checksum)
+{
+	std::fstream file(path, std::ios::in);
+	std::string line;
+	std::getline(file, line); // discard header
+
+	long rows = 0;
+	while (std::getline(file, line))
+	{
+		std::stringstream lineStream(line);
+		std::vector<std::string> cells;
+		std::string cell;
+		while (std::getline(lineStream, cell, ','))
+		{
+			boost::algorithm::trim(cell);
+			cells.push_back(cell);
+		}
+
+		double mid = LegacyStrtoPrice(cells[2]);
+		std::vector<Order> bidOrders;
+		std::vector<Order> offerOrders;
+		for (int i = 1; i <= 5; i++)
+		{
+			long quantity = std::stol(cells[7 + i]);
+			double spread = LegacyStrtoPrice(cells[2 + i]);
+			bidOrders.push_back(Order(mid - spread, quantity, BID));
+			offerOrders.push_back(Order(mid + spread, quantity, OFFER));
+		}
+		checksum += bidOrders[0].GetPrice() + offerOrders[4].GetQuantity();
+		++rows;
+	}
+	return rows;
+}
+
+// Tokenizer path of BondMarketDataConnector, returns the # of rows
+long ReadTokenized(const std::string& path, IngestionMode mode, double& checksum)
+{
+	LineTokenizer<13> cells(path, mode);
+	cells.Next(); // discard header
+
+	std::vector<Order> bidOrders;
+	std::vector<Order> offerOrders;
+	bidOrders.reserve(5);
+	offerOrders.reserve(5);
+
+	long rows = 0;
+	while (cells.Next())
+	{
+		if (cells.Size() < 13)
+			continue;
+
+		double mid = ParsePrice(cells[2]);
+		bidOrders.clear();
+		offerOrders.clear();
+		for (int i = 1; i <= 5; i++)
+		{
+			long quantity = FieldtoLong(cells[7 + i]);
+			double spread = ParsePrice(cells[2 + i]);
+			bidOrders.push_back(Order(mid - spread, quantity, BID));
+			offerOrders.push_back(Order(mid + spread, quantity, OFFER));
+		}
+		checksum += bidOrders[0].GetPrice() + offerOrders[4].GetQuantity();
+		++rows;
+	}
+	return rows;
+}
+
+// Time one path and print its rate, returns the rows/sec
+template<typename F>
+double Measure(const std::string& name, std::size_t bytes, F read)
+{
+	double checksum = 0.0;
+	auto start = std::chrono::steady_clock::now();
+	long rows = read(checksum);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	double rate = rows / seconds;
+	std::cout << name << ": " << rows << " rows in " << seconds << " s, " << rate << " rows/sec, "
+		<< bytes / seconds / (1 << 20) << " MB/s (checksum " << checksum << ")" << std::endl;
+	return rate;
+}
+
+int main(int argc, char* argv[])
+{
+	std::size_t megabytes = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 2048;
+	std::string path = (argc > 2) ? argv[2] : "marketdata_bench.txt";
+
+	std::size_t bytes = megabytes << 20;
+	if (FileSize(path) < bytes)
+	{
+		std::cout << "Generating " << megabytes << " MB of order book rows into " << path << "..." << std::endl;
+		GenerateFile(path, bytes);
+	}
+	bytes = FileSize(path);
+	if (bytes == 0)
+	{
+		std::cout << "Cannot open the file!" << std::endl;
+		return 1;
+	}
+
+	double legacy = Measure("getline + stringstream", bytes, [&](double& checksum) { return ReadLegacy(path, checksum); });
+	double streamed = Measure("LineTokenizer STREAMED", bytes, [&](double& checksum) { return ReadTokenized(path, STREAMED, checksum); });
+	double mapped = Measure("LineTokenizer MAPPED  ", bytes, [&](double& checksum) { return ReadTokenized(path, MAPPED, checksum); });
+
+	std::cout << "Speedup over getline: STREAMED " << streamed / legacy << "x, MAPPED " << mapped / legacy << "x" << std::endl;
+	return 0;
+}
@@ -0,0 +1,120 @@
+// OrderBookBench
+// update rate and depth query cost of the sorted order book engine with 5, 10 and 50
+// levels a side, and of BondMarketDataService applying a one-level delta and then
+// answering AggregateDepth from the rebuilt resident book
+// usage: OrderBookBench [updates = 2000000]
+
+#include "BondMarketData.hpp"
+#include "productservice.hpp"
+#include "OrderBookEngine.hpp"
+#include "BookDelta.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// one prepared level change
+struct LevelOp
+{
+	PricingSide side;
+	long ticks;
+	long quantity; // 0 deletes the level
+};
+
+// Prepare count changes on a book of depth levels a side around 100: mostly quantity
+// changes, some deletes of a level and inserts of it back, so the depth stays about the same
+std::vector<LevelOp> MakeOps(std::size_t depth, std::size_t count)
+{
+	std::mt19937 random(42);
+	std::uniform_int_distribution<long> offset(1, static_cast<long>(depth));
+	std::uniform_int_distribution<long> size(1, 50);
+	std::vector<LevelOp> ops;
+	ops.reserve(count);
+	for (std::size_t i = 0; i < count; i++)
+	{
+		PricingSide side = (i % 2 == 0) ? BID : OFFER;
+		long ticks = 100 * TICKS_PER_POINT + ((side == BID) ? -offset(random) : offset(random));
+		long quantity = (i % 16 == 0) ? 0 : size(random) * 1000000;
+		ops.push_back(LevelOp{ side, ticks, quantity });
+	}
+	return ops;
+}
+
+// Get the seconds since start
+double Since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Engine alone: level updates, then depth copies of the whole book
+void BenchEngine(std::size_t depth, std::size_t updates)
+{
+	OrderBookEngine engine;
+	for (std::size_t i = 1; i <= depth; i++)
+	{
+		engine.ModifyLevel(BID, 100 * TICKS_PER_POINT - static_cast<long>(i), 1000000);
+		engine.ModifyLevel(OFFER, 100 * TICKS_PER_POINT + static_cast<long>(i), 1000000);
+	}
+	std::vector<LevelOp> ops = MakeOps(depth, updates);
+
+	auto start = std::chrono::steady_clock::now();
+	for (const LevelOp& op : ops)
+		engine.ModifyLevel(op.side, op.ticks, op.quantity);
+	double updateSeconds = Since(start);
+
+	std::vector<BookLevel> out(depth);
+	long checksum = 0;
+	start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < updates; i++)
+		checksum += engine.Depth((i % 2 == 0) ? BID : OFFER, out.data(), depth) + out[0].quantity;
+	double depthSeconds = Since(start);
+
+	std::cout << "engine  " << depth << " levels: " << updateSeconds * 1e9 / updates << " ns/update, "
+		<< updates / updateSeconds << " updates/sec, " << depthSeconds * 1e9 / updates << " ns/depth query"
+		<< " (checksum " << checksum << ")" << std::endl;
+}
+
+// Service: a one-level delta, then AggregateDepth rebuilds the resident book in place
+void BenchService(std::size_t depth, std::size_t updates)
+{
+	BondMarketDataService service;
+	Bond bond("9128285M8", CUSIP, "T", 2.875, boost::gregorian::date(2020, boost::gregorian::Nov, 30));
+	BondProductService productService;
+	productService.Add(bond);
+	ProductHandle<Bond> product = productService.GetHandle(bond.GetProductId()); // interned, as the connectors carry it
+
+	BondBookDelta delta(product, true);
+	for (std::size_t i = 1; i <= depth; i++)
+	{
+		delta.AddLevel(LEVEL_INSERT, BID, 100 * TICKS_PER_POINT - static_cast<long>(i), 1000000);
+		delta.AddLevel(LEVEL_INSERT, OFFER, 100 * TICKS_PER_POINT + static_cast<long>(i), 1000000);
+	}
+	service.OnDelta(delta);
+	std::vector<LevelOp> ops = MakeOps(depth, updates);
+
+	long checksum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (const LevelOp& op : ops)
+	{
+		delta.Reset(product);
+		delta.AddLevel(op.quantity == 0 ? LEVEL_DELETE : LEVEL_UPDATE, op.side, op.ticks, op.quantity);
+		service.OnDelta(delta);
+		const BondOrderBook& book = service.AggregateDepth(bond.GetProductId());
+		checksum += book.GetBidStack().size() + book.GetOfferStack().size();
+	}
+	double seconds = Since(start);
+
+	std::cout << "service " << depth << " levels: " << seconds * 1e9 / updates << " ns/(delta + AggregateDepth)"
+		<< " (checksum " << checksum << ")" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	std::size_t updates = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+	for (std::size_t depth : { 5, 10, 50 })
+		BenchEngine(depth, updates);
+	for (std::size_t depth : { 5, 10, 50 })
+		BenchService(depth, updates);
+	return 0;
+}
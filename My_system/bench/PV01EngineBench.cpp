@@ -0,0 +1,104 @@
+// PV01EngineBench
+// ms per pass of the scenario P&L of 10k bonds under 1k yield shock scenarios: the PV01Engine
+// dot product kernel over its dollar pv01 array against a loop over BondPV01 objects, and
+// the cost of the portfolio pv01 and of the pv01 of 8 overlapping buckets
+// usage: PV01EngineBench [bonds = 10000] [scenarios = 1000] [passes = 5]
+
+#include "PV01Engine.hpp"
+#include "riskservice.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Time passes calls of f and print the ms per pass
+template<typename F>
+void Measure(const std::string& name, long passes, F f)
+{
+	double checksum = 0.0;
+	auto start = std::chrono::steady_clock::now();
+	for (long p = 0; p < passes; p++)
+		checksum += f();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ": " << seconds * 1e3 / passes << " ms/pass (checksum " << checksum << ")" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	std::size_t bondCount = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 10000;
+	std::size_t scenarioCount = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 1000;
+	long passes = (argc > 3) ? std::strtol(argv[3], nullptr, 10) : 5;
+	const std::size_t bucketCount = 8;
+
+	std::vector<Bond> bonds;
+	bonds.reserve(bondCount);
+	for (std::size_t i = 0; i < bondCount; i++)
+		bonds.push_back(Bond("B" + std::to_string(100000 + i), CUSIP, "T", 2.0f + (i % 40) / 8.0f, boost::gregorian::date(2020 + i % 30, boost::gregorian::Nov, 30)));
+
+	// the engine and the same risk as BondPV01 objects; every bond is in two of the buckets
+	std::mt19937 random(11);
+	std::uniform_real_distribution<double> pv01(0.01, 0.2);
+	std::uniform_int_distribution<long> quantity(-50, 50);
+	PV01Engine engine;
+	std::vector<BondPV01> objects;
+	objects.reserve(bondCount);
+	for (std::size_t i = 0; i < bondCount; i++)
+	{
+		ProductHandle<Bond> product(static_cast<int>(i), &bonds[i]);
+		double value = pv01(random);
+		long size = quantity(random) * 1000000;
+		std::size_t row = engine.AddProduct(product, value, size);
+		engine.AddToBucket(row, i % bucketCount);
+		engine.AddToBucket(row, (i / bucketCount) % bucketCount);
+		objects.push_back(BondPV01(product, value, size));
+	}
+
+	std::normal_distribution<double> shock(0.0, 5.0);
+	std::vector<double> shocks(scenarioCount * bondCount);
+	for (double& value : shocks)
+		value = shock(random);
+	std::vector<double> pnls(scenarioCount);
+
+	std::cout << bondCount << " bonds, " << scenarioCount << " scenarios" << std::endl;
+	Measure("scenario P&L, loop over BondPV01", passes, [&]() {
+		for (std::size_t s = 0; s < scenarioCount; s++)
+		{
+			const double* row = shocks.data() + s * bondCount;
+			double pnl = 0.0;
+			for (std::size_t i = 0; i < bondCount; i++)
+				pnl -= objects[i].GetPV01() * objects[i].GetQuantity() * row[i];
+			pnls[s] = pnl;
+		}
+		return pnls[0];
+	});
+	Measure("scenario P&L, PV01Engine        ", passes, [&]() {
+		engine.GetScenarioPnLs(shocks.data(), scenarioCount, pnls.data());
+		return pnls[0];
+	});
+
+	// cheap queries, repeated so the timing is readable; each repeat sets one row again (to the
+	// same values) so the compiler cannot hoist the query out of the loop
+	Measure("set + portfolio pv01 x1000      ", passes, [&]() {
+		double sum = 0.0;
+		for (std::size_t r = 0; r < 1000; r++)
+		{
+			const BondPV01& object = objects[r % bondCount];
+			engine.Set(r % bondCount, object.GetPV01(), object.GetQuantity());
+			sum += engine.GetPortfolioPV01();
+		}
+		return sum;
+	});
+	double bucketPv01s[bucketCount];
+	Measure("bucket pv01s x1000              ", passes, [&]() {
+		double sum = 0.0;
+		for (int r = 0; r < 1000; r++)
+		{
+			engine.GetBucketPV01s(bucketPv01s, bucketCount);
+			sum += bucketPv01s[r % bucketCount];
+		}
+		return sum;
+	});
+	return 0;
+}
@@ -0,0 +1,88 @@
+// PriceCodecBench
+// ns per price of parsing and formatting fractional prices: the price codec (char range
+// in, caller buffer out) against the std::string based StrtoPrice / PricetoStr style
+// conversions it replaced, over every tick between 99 and 101
+// usage: PriceCodecBench [rounds = 2000]
+
+#include "PriceCodec.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Parse a price through std::string pieces, like StrtoPrice
+double LegacyStrtoPrice(const std::string& str)
+{
+	std::size_t dash = str.find('-');
+	if (dash == std::string::npos)
+		return std::stod(str);
+	double whole = std::stod(str.substr(0, dash));
+	int thirtySeconds = std::stoi(str.substr(dash + 1, 2));
+	std::string last = str.substr(dash + 3, 1);
+	int eighths = (last == "+") ? 4 : std::stoi(last);
+	return whole + thirtySeconds / 32.0 + eighths / 256.0;
+}
+
+// Format a price into a new std::string, like PricetoStr
+std::string LegacyPricetoStr(double price)
+{
+	int whole = static_cast<int>(std::floor(price));
+	int ticks = static_cast<int>(std::round((price - whole) * 256));
+	int x = ticks / 8, z = ticks % 8;
+	return std::to_string(whole) + "-" + (x < 10 ? "0" : "") + std::to_string(x) + (z == 4 ? "+" : std::to_string(z));
+}
+
+// Time rounds passes of f over count prices and print the ns per price
+template<typename F>
+void Measure(const std::string& name, long rounds, std::size_t count, F f)
+{
+	double checksum = 0.0;
+	auto start = std::chrono::steady_clock::now();
+	for (long r = 0; r < rounds; r++)
+		checksum += f();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ": " << seconds * 1e9 / (rounds * count) << " ns/price (checksum " << checksum << ")" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	long rounds = (argc > 1) ? std::strtol(argv[1], nullptr, 10) : 2000;
+
+	std::vector<std::string> texts;
+	std::vector<double> prices;
+	char buf[PRICE_BUFFER_SIZE];
+	for (long ticks = 99 * TICKS_PER_POINT; ticks <= 101 * TICKS_PER_POINT; ticks++)
+	{
+		texts.push_back(std::string(buf, FormatTicks(ticks, buf)));
+		prices.push_back(TickstoPrice(ticks));
+	}
+	std::size_t n = texts.size();
+
+	Measure("parse  StrtoPrice style", rounds, n, [&]() {
+		double sum = 0.0;
+		for (const std::string& text : texts)
+			sum += LegacyStrtoPrice(text);
+		return sum;
+	});
+	Measure("parse  ParsePrice      ", rounds, n, [&]() {
+		double sum = 0.0;
+		for (const std::string& text : texts)
+			sum += ParsePrice(text);
+		return sum;
+	});
+	Measure("format PricetoStr style", rounds, n, [&]() {
+		double sum = 0.0;
+		for (double price : prices)
+			sum += LegacyPricetoStr(price).size();
+		return sum;
+	});
+	Measure("format FormatPrice     ", rounds, n, [&]() {
+		double sum = 0.0;
+		for (double price : prices)
+			sum += FormatPrice(price, buf) + buf[0];
+		return sum;
+	});
+	return 0;
+}
@@ -0,0 +1,58 @@
+// TimestampBench
+// ns per output row of stamping a record: the original Publish path (microsec_clock local
+// time, DatetoStr, to_simple_string, erase of the microseconds) against the cached
+// TimestampFormatter, on the system clock and on the TSC clock, and the formatting alone
+// usage: TimestampBench [rows = 2000000]
+
+#include "TimestampFormatter.hpp"
+#include "boost/date_time/posix_time/posix_time.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Time rows calls of f and print the ns per row
+template<typename F>
+void Measure(const std::string& name, long rows, F f)
+{
+	long checksum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (long i = 0; i < rows; i++)
+		checksum += f();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ": " << seconds * 1e9 / rows << " ns/row (checksum " << checksum << ")" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	long rows = (argc > 1) ? std::strtol(argv[1], nullptr, 10) : 2000000;
+	char buf[TIMESTAMP_BUFFER_SIZE];
+
+	Measure("local_time + DatetoStr + to_simple_string", rows, []() {
+		auto time = boost::posix_time::microsec_clock::local_time();
+		std::string date = DatetoStr(time.date());
+		std::string timeofDay = boost::posix_time::to_simple_string(time.time_of_day());
+		timeofDay.erase(timeofDay.end() - 3, timeofDay.end());
+		std::string stamp = date + " " + timeofDay;
+		return static_cast<long>(stamp.size());
+	});
+
+	RecordClockSource() = SYSTEM_CLOCK;
+	Measure("RecordNow system clock + FormatTimestamp ", rows, [&buf]() {
+		return static_cast<long>(FormatTimestamp(RecordNow(), buf) + buf[22]);
+	});
+
+	RecordClockSource() = TSC_CLOCK;
+	RecordNow(); // calibrate outside the timing
+	Measure("RecordNow TSC clock + FormatTimestamp    ", rows, [&buf]() {
+		return static_cast<long>(FormatTimestamp(RecordNow(), buf) + buf[22]);
+	});
+
+	// the formatting alone, one millisecond further each row
+	RecordTime time = std::chrono::system_clock::now();
+	Measure("FormatTimestamp only                     ", rows, [&buf, &time]() {
+		time += std::chrono::milliseconds(1);
+		return static_cast<long>(FormatTimestamp(time, buf) + buf[22]);
+	});
+	return 0;
+}
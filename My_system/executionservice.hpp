@@ -9,7 +9,9 @@
 
 #include <string>
 #include "soa.hpp"
+#include "products.hpp"
 #include "marketdataservice.hpp"
+#include "ProductHandle.hpp"
 
 enum OrderType { FOK, IOC, MARKET, LIMIT, STOP };
 
@@ -17,20 +19,27 @@ enum Market { BROKERTEC, ESPEED, CME };
 
 /**
  * An execution order that can be placed on an exchange.
- * Type T is the product type.
+ * Type T is the product type, type P is the price type (double, or Tick for exact 1/256 prices).
  */
-template<typename T>
+template<typename T, typename P = double>
 class ExecutionOrder
 {
 
 public:
 
   // ctor for an order
-  ExecutionOrder(const T &_product, PricingSide _side, string _orderId, OrderType _orderType, double _price, double _visibleQuantity, double _hiddenQuantity, string _parentOrderId, bool _isChildOrder);
+  ExecutionOrder(const ProductHandle<T> &_product, PricingSide _side, string _orderId, OrderType _orderType, P _price, double _visibleQuantity, double _hiddenQuantity, string _parentOrderId, bool _isChildOrder);
+  ExecutionOrder(const T &_product, PricingSide _side, string _orderId, OrderType _orderType, P _price, double _visibleQuantity, double _hiddenQuantity, string _parentOrderId, bool _isChildOrder);
 
   // Get the product
   const T& GetProduct() const;
 
+  // Get the interned product handle
+  const ProductHandle<T>& GetProductHandle() const;
+
+  // Get the side of the order
+  PricingSide GetSide() const;
+
   // Get the order ID
   const string& GetOrderId() const;
 
@@ -38,7 +47,7 @@ public:
   OrderType GetOrderType() const;
 
   // Get the price on this order
-  double GetPrice() const;
+  P GetPrice() const;
 
   // Get the visible quantity on this order
   long GetVisibleQuantity() const;
@@ -53,11 +62,11 @@ public:
   bool IsChildOrder() const;
 
 private:
-  T product;
+  ProductHandle<T> product;
   PricingSide side;
   string orderId;
   OrderType orderType;
-  double price;
+  P price;
   double visibleQuantity;
   double hiddenQuantity;
   string parentOrderId;
@@ -68,21 +77,21 @@ private:
 /**
  * Service for executing orders on an exchange.
  * Keyed on product identifier.
- * Type T is the product type.
+ * Type T is the product type, type P is the price type.
  */
-template<typename T>
-class ExecutionService : public Service<string,ExecutionOrder <T> >
+template<typename T, typename P = double>
+class ExecutionService : public Service<string,ExecutionOrder <T,P> >
 {
 
 public:
 
   // Execute an order on a market
-  void ExecuteOrder(const ExecutionOrder<T>& order, Market market) = 0;
+  virtual void ExecuteOrder(const ExecutionOrder<T,P>& order, Market market) = 0;
 
 };
 
-template<typename T>
-ExecutionOrder<T>::ExecutionOrder(const T &_product, PricingSide _side, string _orderId, OrderType _orderType, double _price, double _visibleQuantity, double _hiddenQuantity, string _parentOrderId, bool _isChildOrder) :
+template<typename T, typename P>
+ExecutionOrder<T,P>::ExecutionOrder(const ProductHandle<T> &_product, PricingSide _side, string _orderId, OrderType _orderType, P _price, double _visibleQuantity, double _hiddenQuantity, string _parentOrderId, bool _isChildOrder) :
   product(_product)
 {
   side = _side;
@@ -95,52 +104,73 @@ ExecutionOrder<T>::ExecutionOrder(const T &_product, PricingSide _side, string _
   isChildOrder = _isChildOrder;
 }
 
-template<typename T>
-const T& ExecutionOrder<T>::GetProduct() const
+template<typename T, typename P>
+ExecutionOrder<T,P>::ExecutionOrder(const T &_product, PricingSide _side, string _orderId, OrderType _orderType, P _price, double _visibleQuantity, double _hiddenQuantity, string _parentOrderId, bool _isChildOrder) :
+  ExecutionOrder(ProductHandle<T>(_product), _side, _orderId, _orderType, _price, _visibleQuantity, _hiddenQuantity, _parentOrderId, _isChildOrder)
+{
+}
+
+template<typename T, typename P>
+const T& ExecutionOrder<T,P>::GetProduct() const
+{
+  return *product;
+}
+
+template<typename T, typename P>
+const ProductHandle<T>& ExecutionOrder<T,P>::GetProductHandle() const
 {
   return product;
 }
 
-template<typename T>
-const string& ExecutionOrder<T>::GetOrderId() const
+template<typename T, typename P>
+PricingSide ExecutionOrder<T,P>::GetSide() const
+{
+  return side;
+}
+
+template<typename T, typename P>
+const string& ExecutionOrder<T,P>::GetOrderId() const
 {
   return orderId;
 }
 
-template<typename T>
-OrderType ExecutionOrder<T>::GetOrderType() const
+template<typename T, typename P>
+OrderType ExecutionOrder<T,P>::GetOrderType() const
 {
   return orderType;
 }
 
-template<typename T>
-double ExecutionOrder<T>::GetPrice() const
+template<typename T, typename P>
+P ExecutionOrder<T,P>::GetPrice() const
 {
   return price;
 }
 
-template<typename T>
-long ExecutionOrder<T>::GetVisibleQuantity() const
+template<typename T, typename P>
+long ExecutionOrder<T,P>::GetVisibleQuantity() const
 {
   return visibleQuantity;
 }
 
-template<typename T>
-long ExecutionOrder<T>::GetHiddenQuantity() const
+template<typename T, typename P>
+long ExecutionOrder<T,P>::GetHiddenQuantity() const
 {
   return hiddenQuantity;
 }
 
-template<typename T>
-const string& ExecutionOrder<T>::GetParentOrderId() const
+template<typename T, typename P>
+const string& ExecutionOrder<T,P>::GetParentOrderId() const
 {
   return parentOrderId;
 }
 
-template<typename T>
-bool ExecutionOrder<T>::IsChildOrder() const
+template<typename T, typename P>
+bool ExecutionOrder<T,P>::IsChildOrder() const
 {
   return isChildOrder;
 }
 
+// bond execution orders
+typedef ExecutionOrder<Bond> Bond_ExOrder;
+
 #endif
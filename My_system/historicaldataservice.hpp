@@ -10,19 +10,22 @@
 #ifndef HISTORICAL_DATA_SERVICE_HPP
 #define HISTORICAL_DATA_SERVICE_HPP
 
+#include <string>
+#include "soa.hpp"
+
 /**
  * Service for processing and persisting historical data to a persistent store.
  * Keyed on some persistent key.
  * Type T is the data type to persist.
  */
 template<typename T>
-class HistoricalDataService : Service<string,T>
+class HistoricalDataService : public Service<string,T>
 {
 
 public:
 
   // Persist data to a store
-  void PersistData(string persistKey, const T& data) = 0;
+  virtual void PersistData(string persistKey, const T& data) = 0;
 
 };
 
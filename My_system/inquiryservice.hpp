@@ -8,7 +8,9 @@
 #define INQUIRY_SERVICE_HPP
 
 #include "soa.hpp"
+#include "products.hpp"
 #include "tradebookingservice.hpp"
+#include "ProductHandle.hpp"
 
 // Various inqyury states
 enum InquiryState { RECEIVED, QUOTED, DONE, REJECTED, CUSTOMER_REJECTED };
@@ -24,6 +26,7 @@ class Inquiry
 public:
 
   // ctor for an inquiry
+  Inquiry(string _inquiryId, const ProductHandle<T> &_product, Side _side, long _quantity, double _price, InquiryState _state);
   Inquiry(string _inquiryId, const T &_product, Side _side, long _quantity, double _price, InquiryState _state);
 
   // Get the inquiry ID
@@ -32,6 +35,9 @@ public:
   // Get the product
   const T& GetProduct() const;
 
+  // Get the interned product handle
+  const ProductHandle<T>& GetProductHandle() const;
+
   // Get the side on the inquiry
   Side GetSide() const;
 
@@ -46,7 +52,7 @@ public:
 
 private:
   string inquiryId;
-  T product;
+  ProductHandle<T> product;
   Side side;
   long quantity;
   double price;
@@ -66,15 +72,15 @@ class InquiryService : public Service<string,Inquiry <T> >
 public:
 
   // Send a quote back to the client
-  void SendQuote(const string &inquiryId, double price) = 0;
+  virtual void SendQuote(const string &inquiryId, double price) = 0;
 
   // Reject an inquiry from the client
-  void RejectInquiry(const string &inquiryId) = 0;
+  virtual void RejectInquiry(const string &inquiryId) = 0;
 
 };
 
 template<typename T>
-Inquiry<T>::Inquiry(string _inquiryId, const T &_product, Side _side, long _quantity, double _price, InquiryState _state) :
+Inquiry<T>::Inquiry(string _inquiryId, const ProductHandle<T> &_product, Side _side, long _quantity, double _price, InquiryState _state) :
   product(_product)
 {
   inquiryId = _inquiryId;
@@ -84,6 +90,12 @@ Inquiry<T>::Inquiry(string _inquiryId, const T &_product, Side _side, long _quan
   state = _state;
 }
 
+template<typename T>
+Inquiry<T>::Inquiry(string _inquiryId, const T &_product, Side _side, long _quantity, double _price, InquiryState _state) :
+  Inquiry(_inquiryId, ProductHandle<T>(_product), _side, _quantity, _price, _state)
+{
+}
+
 template<typename T>
 const string& Inquiry<T>::GetInquiryId() const
 {
@@ -92,6 +104,12 @@ const string& Inquiry<T>::GetInquiryId() const
 
 template<typename T>
 const T& Inquiry<T>::GetProduct() const
+{
+  return *product;
+}
+
+template<typename T>
+const ProductHandle<T>& Inquiry<T>::GetProductHandle() const
 {
   return product;
 }
@@ -120,4 +138,7 @@ InquiryState Inquiry<T>::GetState() const
   return state;
 }
 
+// bond inquiries
+typedef Inquiry<Bond> BondInq;
+
 #endif
@@ -28,6 +28,12 @@
 #include "BondRiskHistoricalDataService.hpp"
 #include "BondExecutionHistoricalDataService.hpp"
 #include "BondStreamingHistoricalDataService.hpp"
+#include "PipelineStage.hpp"
+#include "StaticListeners.hpp"
+#include "EventBus.hpp"
+#include "RiskTree.hpp"
+#include "BondAnalytics.hpp"
+#include <thread>
 
 int main()
 {
@@ -71,14 +77,9 @@ int main()
 	bondProductService.Add(treasury10Y);
 	bondProductService.Add(treasury30Y);
 
-	// pv01
-	std::unordered_map<string,double> pv01Treasury;
-	pv01Treasury.insert(std::make_pair(treasury2Y.GetProductId(), 0.0134));
-	pv01Treasury.insert(std::make_pair(treasury3Y.GetProductId(), 0.01034));
-	pv01Treasury.insert(std::make_pair(treasury5Y.GetProductId(), 0.0172));
-	pv01Treasury.insert(std::make_pair(treasury7Y.GetProductId(), 0.02391));
-	pv01Treasury.insert(std::make_pair(treasury10Y.GetProductId(), 0.02));
-	pv01Treasury.insert(std::make_pair(treasury30Y.GetProductId(), 0.0286));
+	// analytics: yield, duration and pv01 of the treasuries from their coupon and maturity,
+	// at par until the first marks arrive
+	BondAnalytics bondAnalytics(&bondProductService, "T", boost::gregorian::date(2018, Nov, 30));
 
 	// bucketed sector information
 	std::vector<std::string> frontEnd{ treasury2Y.GetProductId() , treasury3Y.GetProductId() }; // front end
@@ -126,6 +127,7 @@ int main()
 	std::cout << "==============================================================\n"<<endl;
 
 	std::cout << "=================== Run services ========================" << endl;
+	std::cout << "the flows run concurrently, each service stage on its own thread\n" << endl;
 
 	std::cout << "trade.txt	==> position.txt and risk.txt" << endl;
 	std::cout << "Data flow: " << endl;
@@ -134,8 +136,9 @@ int main()
 
 	//// build service components
 	BondTradeBookingService bondTradeBookingService;
-	BondPositionService bondPositionService(&bondProductService, "T");
- 	BondRiskService bondRiskService(&bondProductService, pv01Treasury);
+	BondPositionService bondPositionService(&bondProductService, "T", 2); // 2 shards, each on its own thread
+ 	BondRiskService bondRiskService(&bondProductService, bondAnalytics.GetPV01s());
+	bondAnalytics.SetRiskService(&bondRiskService); // pv01s at the marks, applied at the end of each price batch
 	BondRiskHistoricalDataConnector risktoHistoricalDataConnector(oRiskPath);
 	BondRiskHistoricalDataService bondRiskHistoricalDataService(&risktoHistoricalDataConnector);
 	BondPositionHistoricalDataConnector positiontoHistoricalDataConnector(oPositionPath);
@@ -147,18 +150,30 @@ int main()
 	ToBondRiskHistoricalDataListener risktoHistoricalDataListener(&bondProductService,&bondRiskHistoricalDataService, &bondRiskService, bucketTreasury);
 	ToBondPositionHistoricalDataListener positiontoHistoricalDataListener(&bondPositionHistoricalDataService);
 
+	// pipeline stages (one thread each)
+	PipelineStage<BondTrade> tradeBookingtoPositionStage(&tradeBookingtoPositionListener);
+	// the position shards push concurrently, so these two stages take several producers
+	PipelineStage<BondPos, ServiceListener<BondPos>, true> positiontoRiskStage(&positiontoRiskListener);
+	PipelineStage<BondPos, ServiceListener<BondPos>, true> positiontoHistoricalDataStage(&positiontoHistoricalDataListener);
+
 	// link the service components
-	bondTradeBookingService.AddListener(&tradeBookingtoPositionListener);
-	bondPositionService.AddListener(&positiontoRiskListener);
-	bondPositionService.AddListener(&positiontoHistoricalDataListener);
+	bondTradeBookingService.AddListener(&tradeBookingtoPositionStage);
+	bondPositionService.AddListener(&positiontoRiskStage, true);
+	bondPositionService.AddListener(&positiontoHistoricalDataStage, true);
 	bondRiskService.AddListener(&risktoHistoricalDataListener);
 
-	//start
-	tm.Start();
-	BondTradeBookingConnector bondTradeBookingConnector(iTradePath, &bondTradeBookingService, &bondProductService);
-	tm.Stop();
-	std::cout << "Time elapse: " << tm.GetTime() << " seconds\n"<<endl;
-	tm.Reset();
+	// risk aggregation tree: books roll up into desks, desks into the firm
+	RiskTree riskTree;
+	riskTree.AddNode("Firm");
+	riskTree.AddNode("RatesDesk1", "Firm");
+	riskTree.AddNode("RatesDesk2", "Firm");
+	riskTree.AddNode("TRSY1", "RatesDesk1");
+	riskTree.AddNode("TRSY2", "RatesDesk1");
+	riskTree.AddNode("TRSY3", "RatesDesk2");
+	riskTree.AttachBook("TRSY1", "TRSY1");
+	riskTree.AttachBook("TRSY2", "TRSY2");
+	riskTree.AttachBook("TRSY3", "TRSY3");
+	bondRiskService.SetRiskTree(&riskTree);
 
 	std::cout << "marketdata.txt ==> execution.txt, position.txt and risk.txt" << endl;
 	std::cout << "Data flow: " << endl;
@@ -175,18 +190,17 @@ int main()
 	BondExecutionHistoricalDataService bondExecutionHistoricalDataService(&bondExecutionHistoricalDataConnector);
 	BondExecutionHistoricalDataListener bondExecutionHistoricalDataListener(&bondExecutionHistoricalDataService);
 
-	// link the service components
-	bondMarketDataService.AddListener(&bondAlgoExecutionListener);
-	bondAlgoExecutionService.AddListener(&bondExecutionListener);
-	bondExecutionService.AddListener(&bondTradeBookingListener);
-	bondExecutionService.AddListener(&bondExecutionHistoricalDataListener);
+	// pipeline stages (one thread each)
+	PipelineStage<BondOrderBook> marketDatatoAlgoExecutionStage(&bondAlgoExecutionListener);
+	PipelineStage<Bond_AgEx> algoExecutiontoExecutionStage(&bondExecutionListener);
+	PipelineStage<Bond_ExOrder> executiontoTradeBookingStage(&bondTradeBookingListener);
+	PipelineStage<Bond_ExOrder> executiontoHistoricalDataStage(&bondExecutionHistoricalDataListener);
 
-	// start
-	tm.Start();
-	BondMarketDataConnector bondMarketDataConnector(iMarketdataPath, &bondMarketDataService, &bondProductService);
-	tm.Stop();
-	std::cout << "Time spent: " << tm.GetTime() << " seconds\n" << endl;
-	tm.Reset();
+	// link the service components
+	bondMarketDataService.AddListener(&marketDatatoAlgoExecutionStage);
+	bondAlgoExecutionService.AddListener(&algoExecutiontoExecutionStage);
+	bondExecutionService.AddListener(&executiontoTradeBookingStage);
+	bondExecutionService.AddListener(&executiontoHistoricalDataStage);
 
 	std::cout << "price.txt ==> streaming.txt and gui.txt"<<endl;
 	std::cout << "Data flow: " << endl;
@@ -194,13 +208,12 @@ int main()
 	std::cout << "BondPricingService ==> BondAlgoStreamingService ==> BondStreamingService ==> bondStreamingHistoricalDataService\n" << endl;
 	// build service components
 	int throttleVal = 300; // miliseconds
-	BondPricingService bondPricingService;
 	BondAlgoStreamingService bondAlgoStreamingService;
 	BondStreamingService bondStreamingService;
 	BondStreamingHistoricalDataConnector bondStreamingHistoricalDataConnector(oStreamPath);
 	BondStreamingHistoricalDataService bondStreamingHistoricalDataService(&bondStreamingHistoricalDataConnector);
 	BondGUIConnector bondGUIConnector(oGUIPath);
-	BondGUIService bondGUIService(throttleVal, &bondGUIConnector);
+	BondGUIService bondGUIService(throttleVal, &bondGUIConnector, &bondProductService);
 	
 	//build listener
 	ToBondAlgoStreamingListener pricingToAlgoStreamingListener(&bondAlgoStreamingService);
@@ -208,18 +221,19 @@ int main()
 	ToBondStreamingHistoricalDataListener streamingToStreamingHistoricalDataListener(&bondStreamingHistoricalDataService);
 	ToBondGUIListener pricingtoGUIListener(&bondGUIService);
 
-	// link the service components
-	bondPricingService.AddListener(&pricingToAlgoStreamingListener);
-	bondPricingService.AddListener(&pricingtoGUIListener);
-	bondAlgoStreamingService.AddListener(&algoStreamingToStreamingListener);
-	bondStreamingService.AddListener(&streamingToStreamingHistoricalDataListener);
+	// pipeline stages (one thread each)
+	PipelineStage<BondPrice, ToBondAlgoStreamingListener> pricingToAlgoStreamingStage(&pricingToAlgoStreamingListener);
+	PipelineStage<Bond_Ags, ToBondStreamingListener> algoStreamingToStreamingStage(&algoStreamingToStreamingListener);
+	PipelineStage<Bond_Ps, ToBondStreamingHistoricalDataListener> streamingToStreamingHistoricalDataStage(&streamingToStreamingHistoricalDataListener);
 
-	// start
-	tm.Start();
-	BondPricingConnector bondPricingConnector(iPricePath, &bondPricingService, &bondProductService);
-	tm.Stop();
-	std::cout << "Time spent: " << tm.GetTime() << " seconds\n"<<endl;
-	tm.Reset();
+	// link the service components: the pricing service is wired at compile time
+	// the GUI listener only stores the latest price of the bond, the GUI service conflates and
+	// throttles, so it is called directly
+	typedef StaticListeners<BondPrice, PipelineStage<BondPrice, ToBondAlgoStreamingListener>, ToBondGUIListener> PricingListeners;
+	BondPricingServiceT<PricingListeners> bondPricingService(PricingListeners(&pricingToAlgoStreamingStage, &pricingtoGUIListener));
+	bondPricingService.AddListener(&bondAnalytics); // recomputes pv01s on the marks
+	bondAlgoStreamingService.AddListener(&algoStreamingToStreamingStage);
+	bondStreamingService.AddListener(&streamingToStreamingHistoricalDataStage);
 
 	std::cout << "inquiry.txt ==> allinquiry.txt"<<endl;
 	std::cout << "Data flow: " << endl;
@@ -234,16 +248,116 @@ int main()
 	ToBondInquiryListener bondInquiryListener(&bondInquiryService);
 	ToBondInquiryHistoricalDataListener InquirytoHistoricalDataListener(&bondInquiryHistoricalDataService);
 
+	// pipeline stage (the quote listener calls back into the inquiry service, it stays on the flow thread)
+	PipelineStage<BondInq> InquirytoHistoricalDataStage(&InquirytoHistoricalDataListener);
+
 	// link the service components
-	bondInquiryService.AddListener(&InquirytoHistoricalDataListener);
+	bondInquiryService.AddListener(&InquirytoHistoricalDataStage);
 	bondInquiryService.AddListener(&bondInquiryListener);
 
-	// start
-	tm.Start();
-	BondInquiryConnector bondInquiryConnector(iInquiryPath, &bondInquiryService, &bondProductService);
-	tm.Stop();
-	std::cout << "Time spent: " << tm.GetTime() << " seconds"<<endl;
-	tm.Reset();
+	// event buses between the connectors and the services they feed, so reading the files
+	// overlaps with processing (more market data venues can publish to the same bus)
+	EventBus<BondOrderBook> marketDataBus(&bondMarketDataService);
+	EventBus<BondPrice> pricingBus(&bondPricingService);
+
+	// start the stages
+	tradeBookingtoPositionStage.Start();
+	bondPositionService.Start(); // position shards
+	positiontoRiskStage.Start();
+	positiontoHistoricalDataStage.Start();
+	marketDatatoAlgoExecutionStage.Start();
+	algoExecutiontoExecutionStage.Start();
+	executiontoTradeBookingStage.Start();
+	executiontoHistoricalDataStage.Start();
+	pricingToAlgoStreamingStage.Start();
+	algoStreamingToStreamingStage.Start();
+	streamingToStreamingHistoricalDataStage.Start();
+	InquirytoHistoricalDataStage.Start();
+	bondGUIService.Start(); // GUI throttle timer
+	marketDataBus.Start();
+	pricingBus.Start();
+
+	Timer total;
+	total.Start();
+
+	// trades and market data share the trade booking, position and risk services,
+	// so they run one after the other on one flow thread
+	std::thread tradeFlow([&]()
+	{
+		Timer tm;
+		tm.Start();
+		BondTradeBookingConnector bondTradeBookingConnector(iTradePath, &bondTradeBookingService, &bondProductService, MAPPED);
+		tradeBookingtoPositionStage.Drain();
+		bondPositionService.Drain();
+		positiontoRiskStage.Drain();
+		positiontoHistoricalDataStage.Drain();
+		tm.Stop();
+		std::cout << "Trades: time elapse: " << tm.GetTime() << " seconds\n" << endl;
+		tm.Reset();
+
+		tm.Start();
+		BondMarketDataConnector bondMarketDataConnector(iMarketdataPath, &marketDataBus, &bondProductService, MAPPED);
+		marketDataBus.Drain();
+		marketDatatoAlgoExecutionStage.Drain();
+		algoExecutiontoExecutionStage.Drain();
+		executiontoTradeBookingStage.Drain();
+		executiontoHistoricalDataStage.Drain();
+		tradeBookingtoPositionStage.Drain();
+		bondPositionService.Drain();
+		positiontoRiskStage.Drain();
+		positiontoHistoricalDataStage.Drain();
+		tm.Stop();
+		std::cout << "Market data: time spent: " << tm.GetTime() << " seconds" << endl;
+		std::cout << "Throughput: " << bondMarketDataConnector.GetRowCount() / tm.GetTime() << " rows/sec" << endl;
+		std::cout << "Market data bus: " << marketDataBus.GetBatchCount() << " batches, " << marketDataBus.GetFullCount() << " waits on a full queue, max depth " << marketDataBus.GetMaxDepth() << "\n" << endl;
+	});
+
+	std::thread priceFlow([&]()
+	{
+		Timer tm;
+		tm.Start();
+		BondPricingConnector bondPricingConnector(iPricePath, &pricingBus, &bondProductService, MAPPED);
+		pricingBus.Drain();
+		pricingToAlgoStreamingStage.Drain();
+		algoStreamingToStreamingStage.Drain();
+		streamingToStreamingHistoricalDataStage.Drain();
+		tm.Stop();
+		std::cout << "Price: time spent: " << tm.GetTime() << " seconds" << endl;
+		std::cout << "Price bus: " << pricingBus.GetBatchCount() << " batches, " << pricingBus.GetFullCount() << " waits on a full queue, max depth " << pricingBus.GetMaxDepth() << "\n" << endl;
+	});
+
+	std::thread inquiryFlow([&]()
+	{
+		Timer tm;
+		tm.Start();
+		BondInquiryConnector bondInquiryConnector(iInquiryPath, &bondInquiryService, &bondProductService, MAPPED);
+		InquirytoHistoricalDataStage.Drain();
+		tm.Stop();
+		std::cout << "Inquiry: time spent: " << tm.GetTime() << " seconds\n" << endl;
+	});
+
+	tradeFlow.join();
+	priceFlow.join();
+	inquiryFlow.join();
+	marketDataBus.Stop();
+	pricingBus.Stop();
+	bondPositionService.Stop();
+	bondGUIService.Stop(); // publish the last prices
+	total.Stop();
+	std::cout << "Total time spent: " << total.GetTime() << " seconds" << endl;
+	std::cout << "GUI: " << bondGUIService.GetPublishedCount() << " of " << bondGUIService.GetReceivedCount() << " prices published, one per bond at most every "
+		<< throttleVal << " ms" << endl;
+
+	// apply the marks staged after the last price batch
+	bondRiskService.ApplyPendingPV01s();
+
+	// risk of every node of the aggregation tree; the tree and the engine hold the same
+	// quantities, so the Firm node agrees with the portfolio PV01 (up to the rounding of the
+	// running sums of the tree when the books net out)
+	for (const RiskNode& node : riskTree.GetNodes())
+		std::cout << "Risk " << node.name << ": quantity " << node.quantity << ", PV01 " << node.pv01 << endl;
+	const PV01Engine& riskEngine = bondRiskService.GetEngine();
+	std::cout << "Portfolio PV01: " << riskEngine.GetPortfolioPV01() << ", P&L of a +1bp parallel shift: " << riskEngine.GetParallelShiftPnL(1.0) << endl;
 
 	std::cout << "==============================================================" << endl;
 
@@ -10,6 +10,9 @@
 #include <string>
 #include <vector>
 #include "soa.hpp"
+#include "products.hpp"
+#include "Tick.hpp"
+#include "ProductHandle.hpp"
 
 using namespace std;
 
@@ -18,17 +21,20 @@ enum PricingSide { BID, OFFER };
 
 /**
  * A market data order with price, quantity, and side.
+ * Type P is the price type (double, or Tick for exact 1/256 prices).
  */
-class Order
+template<typename P = double>
+class BasicOrder
 {
 
 public:
 
   // ctor for an order
-  Order(double _price, long _quantity, PricingSide _side);
+  BasicOrder(P _price, long _quantity, PricingSide _side);
+  BasicOrder();
 
   // Get the price on the order
-  double GetPrice() const;
+  P GetPrice() const;
 
   // Get the quantity on the order
   long GetQuantity() const;
@@ -37,142 +43,222 @@ public:
   PricingSide GetSide() const;
 
 private:
-  double price;
+  P price;
   long quantity;
   PricingSide side;
 
 };
 
+typedef BasicOrder<double> Order;
+typedef BasicOrder<Tick> TickOrder;
+
 /**
  * Class representing a bid and offer order
+ * Type P is the price type.
  */
-class BidOffer
+template<typename P = double>
+class BasicBidOffer
 {
 
 public:
 
   // ctor for bid/offer
-  BidOffer(const Order &_bidOrder, const Order &_offerOrder);
+  BasicBidOffer(const BasicOrder<P> &_bidOrder, const BasicOrder<P> &_offerOrder);
+  BasicBidOffer();
 
   // Get the bid order
-  const Order& GetBidOrder() const;
+  const BasicOrder<P>& GetBidOrder() const;
 
   // Get the offer order
-  const Order& GetOfferOrder() const;
+  const BasicOrder<P>& GetOfferOrder() const;
 
 private:
-  Order bidOrder;
-  Order offerOrder;
+  BasicOrder<P> bidOrder;
+  BasicOrder<P> offerOrder;
 
 };
 
+typedef BasicBidOffer<double> BidOffer;
+typedef BasicBidOffer<Tick> TickBidOffer;
+
 /**
  * Order book with a bid and offer stack.
- * Type T is the product type.
+ * Type T is the product type, type P is the price type.
  */
-template<typename T>
+template<typename T, typename P = double>
 class OrderBook
 {
 
 public:
 
   // ctor for the order book
-  OrderBook(const T &_product, const vector<Order> &_bidStack, const vector<Order> &_offerStack);
+  OrderBook(const ProductHandle<T> &_product, const vector< BasicOrder<P> > &_bidStack, const vector< BasicOrder<P> > &_offerStack);
+  OrderBook(const T &_product, const vector< BasicOrder<P> > &_bidStack, const vector< BasicOrder<P> > &_offerStack);
 
   // Get the product
   const T& GetProduct() const;
 
+  // Get the interned product handle
+  const ProductHandle<T>& GetProductHandle() const;
+
   // Get the bid stack
-  const vector<Order>& GetBidStack() const;
+  const vector< BasicOrder<P> >& GetBidStack() const;
 
   // Get the offer stack
-  const vector<Order>& GetOfferStack() const;
+  const vector< BasicOrder<P> >& GetOfferStack() const;
+
+  // Get the stacks to refill in place, keeping their capacity
+  vector< BasicOrder<P> >& GetBidStack();
+  vector< BasicOrder<P> >& GetOfferStack();
+
+  // Get the best bid/offer order (highest bid, lowest offer)
+  BasicBidOffer<P> GetBestBidOffer() const;
 
 private:
-  T product;
-  vector<Order> bidStack;
-  vector<Order> offerStack;
+  ProductHandle<T> product;
+  vector< BasicOrder<P> > bidStack;
+  vector< BasicOrder<P> > offerStack;
 
 };
 
 /**
  * Market Data Service which distributes market data
  * Keyed on product identifier.
- * Type T is the product type.
+ * Type T is the product type, type P is the price type.
  */
-template<typename T>
-class MarketDataService : public Service<string,OrderBook <T> >
+template<typename T, typename P = double>
+class MarketDataService : public Service<string,OrderBook <T,P> >
 {
 
 public:
 
   // Get the best bid/offer order
-  virtual const BidOffer& GetBestBidOffer(const string &productId) = 0;
+  virtual const BasicBidOffer<P>& GetBestBidOffer(const string &productId) = 0;
 
   // Aggregate the order book
-  virtual const OrderBook<T>& AggregateDepth(const string &productId) = 0;
+  virtual const OrderBook<T,P>& AggregateDepth(const string &productId) = 0;
 
 };
 
-Order::Order(double _price, long _quantity, PricingSide _side)
+template<typename P>
+BasicOrder<P>::BasicOrder(P _price, long _quantity, PricingSide _side)
 {
   price = _price;
   quantity = _quantity;
   side = _side;
 }
 
-double Order::GetPrice() const
+template<typename P>
+BasicOrder<P>::BasicOrder() :
+  price(), quantity(0), side(BID)
+{
+}
+
+template<typename P>
+P BasicOrder<P>::GetPrice() const
 {
   return price;
 }
  
-long Order::GetQuantity() const
+template<typename P>
+long BasicOrder<P>::GetQuantity() const
 {
   return quantity;
 }
  
-PricingSide Order::GetSide() const
+template<typename P>
+PricingSide BasicOrder<P>::GetSide() const
 {
   return side;
 }
 
-BidOffer::BidOffer(const Order &_bidOrder, const Order &_offerOrder) :
+template<typename P>
+BasicBidOffer<P>::BasicBidOffer(const BasicOrder<P> &_bidOrder, const BasicOrder<P> &_offerOrder) :
   bidOrder(_bidOrder), offerOrder(_offerOrder)
 {
 }
 
-const Order& BidOffer::GetBidOrder() const
+template<typename P>
+BasicBidOffer<P>::BasicBidOffer() :
+  bidOrder(P(), 0, BID), offerOrder(P(), 0, OFFER)
+{
+}
+
+template<typename P>
+const BasicOrder<P>& BasicBidOffer<P>::GetBidOrder() const
 {
   return bidOrder;
 }
 
-const Order& BidOffer::GetOfferOrder() const
+template<typename P>
+const BasicOrder<P>& BasicBidOffer<P>::GetOfferOrder() const
 {
   return offerOrder;
 }
 
-template<typename T>
-OrderBook<T>::OrderBook(const T &_product, const vector<Order> &_bidStack, const vector<Order> &_offerStack) :
+template<typename T, typename P>
+OrderBook<T,P>::OrderBook(const ProductHandle<T> &_product, const vector< BasicOrder<P> > &_bidStack, const vector< BasicOrder<P> > &_offerStack) :
+  product(_product), bidStack(_bidStack), offerStack(_offerStack)
+{
+}
+
+template<typename T, typename P>
+OrderBook<T,P>::OrderBook(const T &_product, const vector< BasicOrder<P> > &_bidStack, const vector< BasicOrder<P> > &_offerStack) :
   product(_product), bidStack(_bidStack), offerStack(_offerStack)
 {
 }
 
-template<typename T>
-const T& OrderBook<T>::GetProduct() const
+template<typename T, typename P>
+const T& OrderBook<T,P>::GetProduct() const
+{
+  return *product;
+}
+
+template<typename T, typename P>
+const ProductHandle<T>& OrderBook<T,P>::GetProductHandle() const
 {
   return product;
 }
 
-template<typename T>
-const vector<Order>& OrderBook<T>::GetBidStack() const
+template<typename T, typename P>
+const vector< BasicOrder<P> >& OrderBook<T,P>::GetBidStack() const
 {
   return bidStack;
 }
 
-template<typename T>
-const vector<Order>& OrderBook<T>::GetOfferStack() const
+template<typename T, typename P>
+const vector< BasicOrder<P> >& OrderBook<T,P>::GetOfferStack() const
 {
   return offerStack;
 }
 
+template<typename T, typename P>
+vector< BasicOrder<P> >& OrderBook<T,P>::GetBidStack()
+{
+  return bidStack;
+}
+
+template<typename T, typename P>
+vector< BasicOrder<P> >& OrderBook<T,P>::GetOfferStack()
+{
+  return offerStack;
+}
+
+template<typename T, typename P>
+BasicBidOffer<P> OrderBook<T,P>::GetBestBidOffer() const
+{
+  BasicOrder<P> bestBid(P(), 0, BID);
+  BasicOrder<P> bestOffer(P(), 0, OFFER);
+  for (auto &order : bidStack)
+    if (bestBid.GetQuantity() == 0 || order.GetPrice() > bestBid.GetPrice())
+      bestBid = order;
+  for (auto &order : offerStack)
+    if (bestOffer.GetQuantity() == 0 || order.GetPrice() < bestOffer.GetPrice())
+      bestOffer = order;
+  return BasicBidOffer<P>(bestBid, bestOffer);
+}
+
+// bond order books
+typedef OrderBook<Bond> BondOrderBook;
+
 #endif
@@ -10,6 +10,8 @@
 #include <string>
 #include <map>
 #include "soa.hpp"
+#include "products.hpp"
+#include "ProductHandle.hpp"
 #include "tradebookingservice.hpp"
 
 using namespace std;
@@ -25,19 +27,29 @@ class Position
 public:
 
   // ctor for a position
+  Position(const ProductHandle<T> &_product);
   Position(const T &_product);
 
   // Get the product
   const T& GetProduct() const;
 
+  // Get the interned product handle
+  const ProductHandle<T>& GetProductHandle() const;
+
   // Get the position quantity
-  long GetPosition(string &book);
+  long GetPosition(const string &book) const;
 
   // Get the aggregate position
-  long GetAggregatePosition();
+  long GetAggregatePosition() const;
+
+  // Get the position quantity of every book
+  const map<string,long>& GetPositions() const;
+
+  // Add a quantity (negative to sell) to the position of a book
+  void AddNewPosition(const string &book, long quantity);
 
 private:
-  T product;
+  ProductHandle<T> product;
   map<string,long> positions;
 
 };
@@ -58,6 +70,12 @@ public:
 
 };
 
+template<typename T>
+Position<T>::Position(const ProductHandle<T> &_product) :
+  product(_product)
+{
+}
+
 template<typename T>
 Position<T>::Position(const T &_product) :
   product(_product)
@@ -66,21 +84,45 @@ Position<T>::Position(const T &_product) :
 
 template<typename T>
 const T& Position<T>::GetProduct() const
+{
+  return *product;
+}
+
+template<typename T>
+const ProductHandle<T>& Position<T>::GetProductHandle() const
 {
   return product;
 }
 
 template<typename T>
-long Position<T>::GetPosition(string &book)
+long Position<T>::GetPosition(const string &book) const
+{
+  auto iter = positions.find(book);
+  return (iter == positions.end()) ? 0 : iter->second;
+}
+
+template<typename T>
+long Position<T>::GetAggregatePosition() const
 {
-  return positions[book];
+  long aggregate = 0;
+  for (auto& book : positions)
+    aggregate += book.second;
+  return aggregate;
 }
 
 template<typename T>
-long Position<T>::GetAggregatePosition()
+const map<string,long>& Position<T>::GetPositions() const
 {
-  // No-op implementation - should be filled out for implementations
-  return 0;
+  return positions;
 }
 
+template<typename T>
+void Position<T>::AddNewPosition(const string &book, long quantity)
+{
+  positions[book] += quantity;
+}
+
+// bond positions
+typedef Position<Bond> BondPos;
+
 #endif
@@ -9,70 +9,94 @@
 
 #include <string>
 #include "soa.hpp"
+#include "products.hpp"
+#include "Tick.hpp"
+#include "ProductHandle.hpp"
 
 /**
  * A price object consisting of mid and bid/offer spread.
- * Type T is the product type.
+ * Type T is the product type, type P is the price type (double, or Tick for exact 1/256 prices).
  */
-template<typename T>
+template<typename T, typename P = double>
 class Price
 {
 
 public:
 
   // ctor for a price
-  Price(const T &_product, double _mid, double _bidOfferSpread);
+  Price(const ProductHandle<T> &_product, P _mid, P _bidOfferSpread);
+  Price(const T &_product, P _mid, P _bidOfferSpread);
 
   // Get the product
   const T& GetProduct() const;
 
+  // Get the interned product handle
+  const ProductHandle<T>& GetProductHandle() const;
+
   // Get the mid price
-  double GetMid() const;
+  P GetMid() const;
 
   // Get the bid/offer spread around the mid
-  double GetBidOfferSpread() const;
+  P GetBidOfferSpread() const;
 
 private:
-  const T& product;
-  double mid;
-  double bidOfferSpread;
+  ProductHandle<T> product;
+  P mid;
+  P bidOfferSpread;
 
 };
 
 /**
  * Pricing Service managing mid prices and bid/offers.
  * Keyed on product identifier.
- * Type T is the product type.
+ * Type T is the product type, type P is the price type.
  */
-template<typename T>
-class PricingService : public Service<string,Price <T> >
+template<typename T, typename P = double>
+class PricingService : public Service<string,Price <T,P> >
 {
 };
 
-template<typename T>
-Price<T>::Price(const T &_product, double _mid, double _bidOfferSpread) :
+template<typename T, typename P>
+Price<T,P>::Price(const ProductHandle<T> &_product, P _mid, P _bidOfferSpread) :
   product(_product)
 {
   mid = _mid;
   bidOfferSpread = _bidOfferSpread;
 }
 
-template<typename T>
-const T& Price<T>::GetProduct() const
+template<typename T, typename P>
+Price<T,P>::Price(const T &_product, P _mid, P _bidOfferSpread) :
+  product(_product)
+{
+  mid = _mid;
+  bidOfferSpread = _bidOfferSpread;
+}
+
+template<typename T, typename P>
+const T& Price<T,P>::GetProduct() const
+{
+  return *product;
+}
+
+template<typename T, typename P>
+const ProductHandle<T>& Price<T,P>::GetProductHandle() const
 {
   return product;
 }
 
-template<typename T>
-double Price<T>::GetMid() const
+template<typename T, typename P>
+P Price<T,P>::GetMid() const
 {
   return mid;
 }
 
-template<typename T>
-double Price<T>::GetBidOfferSpread() const
+template<typename T, typename P>
+P Price<T,P>::GetBidOfferSpread() const
 {
   return bidOfferSpread;
 }
 
+// bond prices
+typedef Price<Bond> BondPrice;
+
 #endif
@@ -11,8 +11,11 @@
 
 #include <iostream>
 #include <map>
+#include <vector>
+#include <unordered_map>
 #include "products.hpp"
 #include "soa.hpp"
+#include "ProductHandle.hpp"
 
  /**
  * Bond Product Service to own reference data over a set of bond securities.
@@ -31,6 +34,15 @@ public:
 	// Add a bond to the service (convenience method)
 	void Add(Bond &bond);
 
+	// Get the interned handle of a bond product identifier (an empty handle if it is unknown)
+	ProductHandle<Bond> GetHandle(const string& productId) const;
+
+	// Get the interned handle of a dense product id
+	ProductHandle<Bond> GetHandle(int id) const;
+
+	// Get the # of bonds added, dense ids are 0 to count - 1
+	int GetProductCount() const;
+
 	// Get all Bonds with the specified ticker
 	vector<Bond> GetBonds(string& _ticker);
 
@@ -46,6 +58,8 @@ public:
 
 private:
 	map<string, Bond> bondMap; // cache of bond products
+	std::vector<const Bond*> bondsById; // dense id -> bond in bondMap (map nodes do not move)
+	std::unordered_map<string, int> idMap; // product identifier -> dense id
 	std::vector<ServiceListener<Bond>*> listeners;
 
 };
@@ -105,7 +119,33 @@ Bond& BondProductService::GetData(string productId)
 
 void BondProductService::Add(Bond &bond)
 {
-	bondMap.insert(pair<string, Bond>(bond.GetProductId(), bond));
+	auto result = bondMap.insert(pair<string, Bond>(bond.GetProductId(), bond));
+	if (result.second)
+	{
+		// intern the new bond under the next dense id
+		idMap[bond.GetProductId()] = static_cast<int>(bondsById.size());
+		bondsById.push_back(&result.first->second);
+	}
+}
+
+ProductHandle<Bond> BondProductService::GetHandle(const string& productId) const
+{
+	auto iter = idMap.find(productId);
+	if (iter == idMap.end())
+		return ProductHandle<Bond>();
+	return ProductHandle<Bond>(iter->second, bondsById[iter->second]);
+}
+
+ProductHandle<Bond> BondProductService::GetHandle(int id) const
+{
+	if (id < 0 || id >= static_cast<int>(bondsById.size()))
+		return ProductHandle<Bond>();
+	return ProductHandle<Bond>(id, bondsById[id]);
+}
+
+int BondProductService::GetProductCount() const
+{
+	return static_cast<int>(bondsById.size());
 }
 
 vector<Bond> BondProductService::GetBonds(string& _ticker)
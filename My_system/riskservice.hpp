@@ -8,7 +8,9 @@
 #define RISK_SERVICE_HPP
 
 #include "soa.hpp"
+#include "products.hpp"
 #include "positionservice.hpp"
+#include "ProductHandle.hpp"
 
 /**
  * PV01 risk.
@@ -21,11 +23,15 @@ class PV01
 public:
 
   // ctor for a PV01 value
+  PV01(const ProductHandle<T> &_product, double _pv01, long _quantity);
   PV01(const T &_product, double _pv01, long _quantity);
 
   // Get the product on this PV01 value
   const T& GetProduct() const;
 
+  // Get the interned product handle
+  const ProductHandle<T>& GetProductHandle() const;
+
   // Get the PV01 value
   double GetPV01() const;
 
@@ -33,7 +39,7 @@ public:
   long GetQuantity() const;
 
 private:
-  T product;
+  ProductHandle<T> product;
   double pv01;
   long quantity;
 
@@ -77,21 +83,51 @@ class RiskService : public Service<string,PV01 <T> >
 public:
 
   // Add a position that the service will risk
-  void AddPosition(Position<T> &position) = 0;
+  virtual void AddPosition(Position<T> &position) = 0;
 
   // Get the bucketed risk for the bucket sector
-  const PV01< BucketedSector<T> >& GetBucketedRisk(const BucketedSector<T> &sector) const = 0;
+  virtual const PV01< BucketedSector<T> >& GetBucketedRisk(const BucketedSector<T> &sector) const = 0;
 
 };
 
 template<typename T>
-PV01<T>::PV01(const T &_product, double _pv01, long _quantity) :
+PV01<T>::PV01(const ProductHandle<T> &_product, double _pv01, long _quantity) :
   product(_product)
 {
   pv01 = _pv01;
   quantity = _quantity;
 }
 
+template<typename T>
+PV01<T>::PV01(const T &_product, double _pv01, long _quantity) :
+  PV01(ProductHandle<T>(_product), _pv01, _quantity)
+{
+}
+
+template<typename T>
+const T& PV01<T>::GetProduct() const
+{
+  return *product;
+}
+
+template<typename T>
+const ProductHandle<T>& PV01<T>::GetProductHandle() const
+{
+  return product;
+}
+
+template<typename T>
+double PV01<T>::GetPV01() const
+{
+  return pv01;
+}
+
+template<typename T>
+long PV01<T>::GetQuantity() const
+{
+  return quantity;
+}
+
 template<typename T>
 BucketedSector<T>::BucketedSector(const vector<T>& _products, string _name) :
   products(_products)
@@ -111,4 +147,7 @@ const string& BucketedSector<T>::GetName() const
   return name;
 }
 
+// bond pv01s
+typedef PV01<Bond> BondPV01;
+
 #endif
@@ -9,6 +9,7 @@
 #define SOA_HPP
 
 #include <vector>
+#include <cstddef>
 
 using namespace std;
 
@@ -32,6 +33,21 @@ public:
   // Listener callback to process an update event to the Service
   virtual void ProcessUpdate(V &data) = 0;
 
+  // Listener callbacks for data the Service keeps resident, the listener must not modify it.
+  // By default the listener gets a copy; listeners that only read the data override these.
+  virtual void ProcessAdd(const V &data) { V copy(data); ProcessAdd(copy); }
+  virtual void ProcessRemove(const V &data) { V copy(data); ProcessRemove(copy); }
+  virtual void ProcessUpdate(const V &data) { V copy(data); ProcessUpdate(copy); }
+
+  // Listener callbacks for data the Service hands over, no copy is made
+  virtual void ProcessAdd(V &&data) { ProcessAdd(data); }
+  virtual void ProcessRemove(V &&data) { ProcessRemove(data); }
+  virtual void ProcessUpdate(V &&data) { ProcessUpdate(data); }
+
+  // Listener callback to process a batch of add events to the Service, in order.
+  // By default each event goes through ProcessAdd; listeners that can amortize work override this.
+  virtual void ProcessBatch(V *data, size_t count) { for (size_t i = 0; i < count; i++) ProcessAdd(data[i]); }
+
 };
 
 /**
@@ -50,6 +66,10 @@ public:
   // The callback that a Connector should invoke for any new or updated data
   virtual void OnMessage(V &data) = 0;
 
+  // The callback that a Connector can invoke for a batch of new or updated data, in order.
+  // By default each item goes through OnMessage; services that can amortize work override this.
+  virtual void OnMessageBatch(V *data, size_t count) { for (size_t i = 0; i < count; i++) OnMessage(data[i]); }
+
   // Add a listener to the Service for callbacks on add, remove, and update events
   // for data to the Service.
   virtual void AddListener(ServiceListener<V> *listener) = 0;
@@ -76,6 +96,10 @@ public:
   // Publish data to the Connector
   virtual void Publish(V &data) = 0;
 
+  // Publish data the Service keeps resident to the Connector.
+  // By default the Connector gets a copy; Connectors that only read the data override this.
+  virtual void Publish(const V &data) { V copy(data); Publish(copy); }
+
 };
 
 #endif
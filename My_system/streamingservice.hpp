@@ -8,24 +8,28 @@
 #define STREAMING_SERVICE_HPP
 
 #include "soa.hpp"
+#include "products.hpp"
 #include "marketdataservice.hpp"
+#include "ProductHandle.hpp"
 
 /**
  * A price stream order with price and quantity (visible and hidden)
+ * Type P is the price type (double, or Tick for exact 1/256 prices).
  */
-class PriceStreamOrder
+template<typename P = double>
+class BasicPriceStreamOrder
 {
 
 public:
 
   // ctor for an order
-  PriceStreamOrder(double _price, long _visibleQuantity, long _hiddenQuantity, PricingSide _side);
+  BasicPriceStreamOrder(P _price, long _visibleQuantity, long _hiddenQuantity, PricingSide _side);
 
   // The side on this order
   PricingSide GetSide() const;
 
   // Get the price on this order
-  double GetPrice() const;
+  P GetPrice() const;
 
   // Get the visible quantity on this order
   long GetVisibleQuantity() const;
@@ -34,59 +38,67 @@ public:
   long GetHiddenQuantity() const;
 
 private:
-  double price;
+  P price;
   long visibleQuantity;
   long hiddenQuantity;
   PricingSide side;
 
 };
 
+typedef BasicPriceStreamOrder<double> PriceStreamOrder;
+typedef BasicPriceStreamOrder<Tick> TickPriceStreamOrder;
+
 /**
  * Price Stream with a two-way market.
- * Type T is the product type.
+ * Type T is the product type, type P is the price type.
  */
-template<typename T>
+template<typename T, typename P = double>
 class PriceStream
 {
 
 public:
 
   // ctor
-  PriceStream(const T &_product, const PriceStreamOrder &_bidOrder, const PriceStreamOrder &_offerOrder);
+  PriceStream(const ProductHandle<T> &_product, const BasicPriceStreamOrder<P> &_bidOrder, const BasicPriceStreamOrder<P> &_offerOrder);
+  PriceStream(const T &_product, const BasicPriceStreamOrder<P> &_bidOrder, const BasicPriceStreamOrder<P> &_offerOrder);
 
   // Get the product
   const T& GetProduct() const;
 
+  // Get the interned product handle
+  const ProductHandle<T>& GetProductHandle() const;
+
   // Get the bid order
-  const PriceStreamOrder& GetBidOrder() const;
+  const BasicPriceStreamOrder<P>& GetBidOrder() const;
 
   // Get the offer order
-  const PriceStreamOrder& GetOfferOrder() const;
+  const BasicPriceStreamOrder<P>& GetOfferOrder() const;
 
 private:
-  T product;
-  PriceStreamOrder bidOrder;
-  PriceStreamOrder offerOrder;
+  ProductHandle<T> product;
+  BasicPriceStreamOrder<P> bidOrder;
+  BasicPriceStreamOrder<P> offerOrder;
 
 };
 
 /**
  * Streaming service to publish two-way prices.
  * Keyed on product identifier.
- * Type T is the product type.
+ * Type T is the product type, type P is the price type.
  */
-template<typename T>
-class StreamingService : public Service<string,PriceStream <T> >
+template<typename T, typename P = double>
+class StreamingService : public Service<string,PriceStream <T,P> >
 {
 
 public:
 
   // Publish two-way prices
-  void PublishPrice(const PriceStream<T>& priceStream) = 0;
+  virtual void PublishPrice(const PriceStream<T,P>& priceStream) = 0;
 
 };
 
-PriceStreamOrder::PriceStreamOrder(double _price, long _visibleQuantity, long _hiddenQuantity, PricingSide _side)
+template<typename P>
+BasicPriceStreamOrder<P>::BasicPriceStreamOrder(P _price, long _visibleQuantity, long _hiddenQuantity, PricingSide _side)
 {
   price = _price;
   visibleQuantity = _visibleQuantity;
@@ -94,43 +106,61 @@ PriceStreamOrder::PriceStreamOrder(double _price, long _visibleQuantity, long _h
   side = _side;
 }
 
-double PriceStreamOrder::GetPrice() const
+template<typename P>
+P BasicPriceStreamOrder<P>::GetPrice() const
 {
   return price;
 }
 
-long PriceStreamOrder::GetVisibleQuantity() const
+template<typename P>
+long BasicPriceStreamOrder<P>::GetVisibleQuantity() const
 {
   return visibleQuantity;
 }
 
-long PriceStreamOrder::GetHiddenQuantity() const
+template<typename P>
+long BasicPriceStreamOrder<P>::GetHiddenQuantity() const
 {
   return hiddenQuantity;
 }
 
-template<typename T>
-PriceStream<T>::PriceStream(const T &_product, const PriceStreamOrder &_bidOrder, const PriceStreamOrder &_offerOrder) :
+template<typename T, typename P>
+PriceStream<T,P>::PriceStream(const ProductHandle<T> &_product, const BasicPriceStreamOrder<P> &_bidOrder, const BasicPriceStreamOrder<P> &_offerOrder) :
+  product(_product), bidOrder(_bidOrder), offerOrder(_offerOrder)
+{
+}
+
+template<typename T, typename P>
+PriceStream<T,P>::PriceStream(const T &_product, const BasicPriceStreamOrder<P> &_bidOrder, const BasicPriceStreamOrder<P> &_offerOrder) :
   product(_product), bidOrder(_bidOrder), offerOrder(_offerOrder)
 {
 }
 
-template<typename T>
-const T& PriceStream<T>::GetProduct() const
+template<typename T, typename P>
+const T& PriceStream<T,P>::GetProduct() const
+{
+  return *product;
+}
+
+template<typename T, typename P>
+const ProductHandle<T>& PriceStream<T,P>::GetProductHandle() const
 {
   return product;
 }
 
-template<typename T>
-const PriceStreamOrder& PriceStream<T>::GetBidOrder() const
+template<typename T, typename P>
+const BasicPriceStreamOrder<P>& PriceStream<T,P>::GetBidOrder() const
 {
   return bidOrder;
 }
 
-template<typename T>
-const PriceStreamOrder& PriceStream<T>::GetOfferOrder() const
+template<typename T, typename P>
+const BasicPriceStreamOrder<P>& PriceStream<T,P>::GetOfferOrder() const
 {
   return offerOrder;
 }
 
+// bond price streams
+typedef PriceStream<Bond> Bond_Ps;
+
 #endif
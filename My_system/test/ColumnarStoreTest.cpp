@@ -0,0 +1,255 @@
+// ColumnarStoreTest
+// rows written to the columnar format with and without delta compression read back column
+// by column as written, FindBlocks picks the blocks by time range and product, ToCsv of the
+// position connector gives the lines of its text output, and a reader of a file with any
+// byte of the footer changed either rejects it or only indexes columns inside the file
+
+#include "BondPositionHistoricalDataService.hpp"
+#include "productservice.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// exposes the record formats of the position connector
+class PositionFormats : public BondPositionHistoricalDataConnector
+{
+public:
+	using BondPositionHistoricalDataConnector::Format;
+	using BondPositionHistoricalDataConnector::Append;
+};
+
+// the rows written, one vector per column
+struct Rows
+{
+	std::vector<std::int64_t> times; // microseconds
+	std::vector<std::string> products;
+	std::vector<std::int64_t> quantities;
+	std::vector<std::int64_t> ticks;
+	std::vector<double> pv01s;
+};
+
+const RecordTime START = RecordTime(std::chrono::duration_cast<RecordTime::duration>(std::chrono::microseconds(1543600000123456LL)));
+const std::size_t ROWS = 2500;
+const std::size_t BLOCK_ROWS = 1000;
+
+int failures = 0;
+
+// Report a failed check
+void Fail(const std::string& what)
+{
+	if (++failures <= 10)
+		std::cout << what << std::endl;
+}
+
+// Read a whole file
+std::string ReadFile(const std::string& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Write a whole file
+void WriteFile(const std::string& path, const std::string& bytes)
+{
+	std::ofstream out(path, std::ios::binary);
+	out.write(bytes.data(), bytes.size());
+}
+
+// Write ROWS rows of every column type; "ONLY" is the product of the first 10 rows only
+Rows WriteRows(const std::string& path, ColumnCompression compression)
+{
+	Rows rows;
+	ColumnarWriter writer(path, { {"Time",COLUMN_TIME},{"BondID",COLUMN_STRING},{"Quantity",COLUMN_LONG},{"Price",COLUMN_PRICE},{"PV01",COLUMN_DOUBLE} },
+		0, 1, compression, BLOCK_ROWS);
+	for (std::size_t i = 0; i < ROWS; i++)
+	{
+		RecordTime time = START + std::chrono::microseconds(1000 * i + i % 7);
+		std::string product = (i < 10) ? "ONLY" : ((i % 3 == 0) ? "9128285M8" : "9128285N6");
+		long quantity = static_cast<long>((i * 37) % 1000) * 1000000 - 500000000;
+		long ticks = 99 * TICKS_PER_POINT + static_cast<long>(i % 512);
+		double pv01 = 0.01 + i * 0.0001;
+
+		writer.SetTime(0, time);
+		writer.SetString(1, product);
+		writer.SetLong(2, quantity);
+		writer.SetPrice(3, TickstoPrice(ticks));
+		writer.SetDouble(4, pv01);
+		writer.EndRow();
+
+		rows.times.push_back(std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count());
+		rows.products.push_back(product);
+		rows.quantities.push_back(quantity);
+		rows.ticks.push_back(ticks);
+		rows.pv01s.push_back(pv01);
+	}
+	writer.Close();
+	return rows;
+}
+
+// Check that the columns of every block read back as written
+void ExpectRows(const std::string& name, const ColumnarReader& reader, const Rows& rows)
+{
+	if (reader.GetRowCount() != ROWS || reader.GetBlocks().size() != (ROWS + BLOCK_ROWS - 1) / BLOCK_ROWS)
+	{
+		Fail(name + ": " + std::to_string(reader.GetRowCount()) + " rows in " + std::to_string(reader.GetBlocks().size()) + " blocks");
+		return;
+	}
+
+	std::vector<std::int64_t> times, codes, quantities, ticks;
+	std::vector<double> pv01s;
+	std::size_t row = 0;
+	for (std::size_t b = 0; b < reader.GetBlocks().size(); b++)
+	{
+		reader.ReadLongs(b, 0, times);
+		reader.ReadLongs(b, 1, codes);
+		reader.ReadLongs(b, 2, quantities);
+		reader.ReadLongs(b, 3, ticks);
+		reader.ReadDoubles(b, 4, pv01s);
+		for (std::size_t r = 0; r < times.size(); r++, row++)
+		{
+			if (times[r] != rows.times[row] || reader.GetString(static_cast<std::uint32_t>(codes[r])) != rows.products[row]
+				|| quantities[r] != rows.quantities[row] || ticks[r] != rows.ticks[row] || pv01s[r] != rows.pv01s[row])
+			{
+				Fail(name + ": row " + std::to_string(row) + " does not read back as written");
+				return;
+			}
+		}
+	}
+}
+
+// Check the blocks found for a time range and product
+void ExpectBlocks(const std::string& name, const ColumnarReader& reader, std::int64_t from, std::int64_t to, const std::string& product,
+	const std::vector<std::size_t>& expected)
+{
+	if (reader.FindBlocks(from, to, product) != expected)
+		Fail(name + ": FindBlocks(" + std::to_string(from) + ", " + std::to_string(to) + ", " + product + ") gives the wrong blocks");
+}
+
+// Round trip in one compression mode
+void TestRoundTrip(const std::string& name, ColumnCompression compression)
+{
+	const std::string path = "ColumnarStoreTest.bin";
+	Rows rows = WriteRows(path, compression);
+	ColumnarReader reader(path);
+	if (!reader.is_open())
+	{
+		Fail(name + ": the file cannot be read");
+		return;
+	}
+	ExpectRows(name, reader, rows);
+
+	// block b holds the rows [b * BLOCK_ROWS, (b + 1) * BLOCK_ROWS)
+	std::int64_t first = rows.times.front(), last = rows.times.back();
+	ExpectBlocks(name, reader, first, last, "", { 0, 1, 2 });
+	ExpectBlocks(name, reader, rows.times[1500], rows.times[1600], "", { 1 });
+	ExpectBlocks(name, reader, rows.times[999], rows.times[1000], "", { 0, 1 });
+	ExpectBlocks(name, reader, last + 1, last + 1000, "", {});
+	ExpectBlocks(name, reader, first, last, "ONLY", { 0 });
+	ExpectBlocks(name, reader, first, last, "9128285M8", { 0, 1, 2 });
+	ExpectBlocks(name, reader, rows.times[1500], last, "ONLY", {});
+	ExpectBlocks(name, reader, first, last, "912828XX0", {});
+	std::remove(path.c_str());
+}
+
+// The position connector's columnar output converts back to its text output
+void TestPositionCsv(const std::string& name, ColumnCompression compression)
+{
+	BondProductService bondProductService;
+	std::vector<ProductHandle<Bond>> products;
+	for (int i = 0; i < 3; i++)
+	{
+		Bond bond("912828" + std::to_string(100 + i), (i == 2) ? ISIN : CUSIP, "T", 2.0f + i, boost::gregorian::date(2020 + i, boost::gregorian::Nov, 30));
+		bondProductService.Add(bond);
+		products.push_back(bondProductService.GetHandle(bond.GetProductId()));
+	}
+
+	const std::string storePath = "ColumnarStoreTest.position.bin";
+	const std::string csvPath = "ColumnarStoreTest.position.csv";
+	std::string text = "Time,BondIDType,BondID,BookId,Positions\n";
+	{
+		ColumnarWriter columnar(storePath, { {"Time",COLUMN_TIME},{"BondIDType",COLUMN_STRING},{"BondID",COLUMN_STRING},
+			{"TRSY1",COLUMN_LONG},{"TRSY2",COLUMN_LONG},{"TRSY3",COLUMN_LONG},{"AGGREGATED",COLUMN_LONG} }, 0, 2, compression, BLOCK_ROWS);
+		for (std::size_t i = 0; i < ROWS; i++)
+		{
+			PositionRecord record;
+			record.time = START + std::chrono::milliseconds(i);
+			record.product = products[i % 3];
+			record.positions[3] = 0;
+			for (int b = 0; b < 3; b++)
+			{
+				record.positions[b] = static_cast<long>((i * (b + 7)) % 41) * 1000000 - 20000000;
+				record.positions[3] += record.positions[b];
+			}
+			PositionFormats::Format(record, text);
+			PositionFormats::Append(record, columnar);
+		}
+	}
+
+	BondPositionHistoricalDataConnector::ToCsv(storePath, csvPath);
+	if (ReadFile(csvPath) != text)
+		Fail(name + ": ToCsv does not give the text output");
+	std::remove(storePath.c_str());
+	std::remove(csvPath.c_str());
+}
+
+// Change every byte of the footer in turn: the reader rejects the file or indexes columns inside it
+void TestCorruptFooter()
+{
+	const std::string path = "ColumnarStoreTest.corrupt.bin";
+	WriteRows(path, COMPRESSION_DELTA);
+	const std::string bytes = ReadFile(path);
+
+	std::uint64_t footerOffset;
+	std::memcpy(&footerOffset, bytes.data() + bytes.size() - 12, sizeof(footerOffset));
+	std::streambuf* console = std::cout.rdbuf();
+	std::ostringstream rejected; // the readers report every rejected file
+	long accepted = 0;
+	for (std::size_t i = footerOffset; i < bytes.size() - 4; i++)
+	{
+		for (unsigned char change : { 0x01, 0x80, 0xff })
+		{
+			std::string corrupt = bytes;
+			corrupt[i] = static_cast<char>(static_cast<unsigned char>(corrupt[i]) ^ change);
+			WriteFile(path, corrupt);
+
+			std::cout.rdbuf(rejected.rdbuf());
+			ColumnarReader reader(path);
+			std::cout.rdbuf(console);
+			if (!reader.is_open())
+				continue;
+			accepted++;
+			for (const BlockInfo& block : reader.GetBlocks())
+				for (std::size_t c = 0; c < block.columnOffsets.size(); c++)
+					if (block.columnOffsets[c] + block.columnLengths[c] > footerOffset || block.columnLengths[c] < block.rows)
+						Fail("corrupt footer: byte " + std::to_string(i) + " gives a column outside the blocks");
+		}
+	}
+
+	// names, strings and times can change without the file being inconsistent
+	if (accepted == 0)
+		Fail("corrupt footer: every change was rejected");
+	std::remove(path.c_str());
+}
+
+int main()
+{
+	TestRoundTrip("no compression", COMPRESSION_NONE);
+	TestRoundTrip("delta", COMPRESSION_DELTA);
+	TestPositionCsv("position csv, no compression", COMPRESSION_NONE);
+	TestPositionCsv("position csv, delta", COMPRESSION_DELTA);
+	TestCorruptFooter();
+
+	if (failures != 0)
+	{
+		std::cout << "ColumnarStoreTest: " << failures << " failures" << std::endl;
+		return 1;
+	}
+	std::cout << "ColumnarStoreTest: " << ROWS << " rows round trip in both compression modes" << std::endl;
+	return 0;
+}
@@ -0,0 +1,184 @@
+// ConflatingListenerTest
+// the conflating listener hands the latest event of each key to its listener, in order per
+// key: events kept before the worker runs, events arriving as soon as it is free (interval 0)
+// and once per interval, and what is left when it stops; every event received is either
+// delivered or counted as coalesced once Drain or Stop returns
+
+#include "ConflatingListener.hpp"
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// an event of a key, seq grows with every event of the key
+struct Quote
+{
+	std::string key;
+	long seq;
+};
+
+// records what the conflating listener delivers, called from its worker
+class RecordingListener final : public ServiceListener<Quote>
+{
+private:
+	std::mutex lock;
+
+	void Record(StageAction action, const Quote &data)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		std::vector<long>& seqs = delivered[data.key];
+		if (!seqs.empty() && seqs.back() >= data.seq)
+			outOfOrder++;
+		seqs.push_back(data.seq);
+		lastAction[data.key] = action;
+	}
+
+public:
+	std::map<std::string, std::vector<long>> delivered; // seqs delivered for each key
+	std::map<std::string, StageAction> lastAction;
+	long outOfOrder = 0;
+
+	using ServiceListener<Quote>::ProcessAdd;
+	using ServiceListener<Quote>::ProcessRemove;
+	using ServiceListener<Quote>::ProcessUpdate;
+
+	virtual void ProcessAdd(Quote &data) { Record(STAGE_ADD, data); }
+	virtual void ProcessRemove(Quote &data) { Record(STAGE_REMOVE, data); }
+	virtual void ProcessUpdate(Quote &data) { Record(STAGE_UPDATE, data); }
+};
+
+int failures = 0;
+
+// Report a failed check
+void Fail(const std::string& what)
+{
+	if (++failures <= 10)
+		std::cout << what << std::endl;
+}
+
+// Check the counters and that the last event of each key was delivered last
+void ExpectDelivered(const std::string& name, const ConflatingListener<Quote>& conflating, const RecordingListener& recorder,
+	const std::map<std::string, long>& lastSeq, long received)
+{
+	if (conflating.GetReceivedCount() != received)
+		Fail(name + ": received " + std::to_string(conflating.GetReceivedCount()) + ", expected " + std::to_string(received));
+	if (conflating.GetDeliveredCount() + conflating.GetCoalescedCount() != received)
+		Fail(name + ": delivered " + std::to_string(conflating.GetDeliveredCount()) + " + coalesced "
+			+ std::to_string(conflating.GetCoalescedCount()) + " is not the " + std::to_string(received) + " received");
+	if (recorder.outOfOrder != 0)
+		Fail(name + ": " + std::to_string(recorder.outOfOrder) + " events delivered out of order");
+	for (const auto& kv : lastSeq)
+	{
+		auto iter = recorder.delivered.find(kv.first);
+		if (iter == recorder.delivered.end() || iter->second.back() != kv.second)
+			Fail(name + ": the last event of " + kv.first + " was not delivered last");
+	}
+}
+
+ConflatingListener<Quote>::KeyFunction QuoteKey()
+{
+	return [](const Quote& quote) { return quote.key; };
+}
+
+// Events kept before the worker starts collapse into one per key
+void TestBeforeStart()
+{
+	RecordingListener recorder;
+	ConflatingListener<Quote> conflating(&recorder, QuoteKey());
+	std::map<std::string, long> lastSeq;
+	for (long seq = 0; seq < 100; seq++)
+		for (const std::string key : { "A", "B", "C" })
+		{
+			Quote quote{ key, seq };
+			conflating.ProcessUpdate(quote);
+			lastSeq[key] = seq;
+		}
+	if (conflating.GetCoalescedCount() != 297)
+		Fail("before start: coalesced " + std::to_string(conflating.GetCoalescedCount()) + ", expected 297");
+
+	conflating.Start();
+	conflating.Drain();
+	ExpectDelivered("before start", conflating, recorder, lastSeq, 300);
+	if (conflating.GetDeliveredCount() != 3)
+		Fail("before start: delivered " + std::to_string(conflating.GetDeliveredCount()) + ", expected 3");
+	if (recorder.lastAction["B"] != STAGE_UPDATE)
+		Fail("before start: the action of the last event was not kept");
+
+	// a batch after the first delivery
+	std::vector<Quote> batch;
+	for (long seq = 100; seq < 110; seq++)
+		batch.push_back(Quote{ "A", seq });
+	conflating.ProcessBatch(batch.data(), batch.size());
+	lastSeq["A"] = 109;
+	conflating.Drain();
+	ExpectDelivered("batch", conflating, recorder, lastSeq, 310);
+	if (recorder.lastAction["A"] != STAGE_ADD)
+		Fail("batch: the events of a batch are not delivered as adds");
+	conflating.Stop();
+}
+
+// Events from a running service, delivered as soon as the worker is free or once per interval
+void TestRunning(const std::string& name, std::chrono::milliseconds interval)
+{
+	RecordingListener recorder;
+	ConflatingListener<Quote> conflating(&recorder, QuoteKey(), interval);
+	conflating.Start();
+
+	const long events = 200000;
+	std::map<std::string, long> lastSeq;
+	for (long seq = 0; seq < events; seq++)
+	{
+		Quote quote{ (seq % 2 == 0) ? "A" : "B", seq };
+		conflating.ProcessUpdate(quote);
+		lastSeq[quote.key] = seq;
+	}
+	conflating.Drain();
+	ExpectDelivered(name, conflating, recorder, lastSeq, events);
+
+	// with an interval every key is delivered at most once per interval, so most events coalesce
+	if (interval.count() > 0 && conflating.GetCoalescedCount() == 0)
+		Fail(name + ": no event was coalesced");
+	conflating.Stop();
+}
+
+// Stop delivers the events still kept, Drain after Stop returns
+void TestStop()
+{
+	RecordingListener recorder;
+	ConflatingListener<Quote> conflating(&recorder, QuoteKey(), std::chrono::milliseconds(10000));
+	conflating.Start();
+	std::map<std::string, long> lastSeq;
+	for (long seq = 0; seq < 50; seq++)
+	{
+		Quote quote{ "A", seq };
+		conflating.ProcessRemove(quote);
+		lastSeq["A"] = seq;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	conflating.Stop();
+	conflating.Drain();
+	if (std::chrono::steady_clock::now() - start > std::chrono::seconds(5))
+		Fail("stop: waited for the interval");
+	ExpectDelivered("stop", conflating, recorder, lastSeq, 50);
+	if (recorder.lastAction["A"] != STAGE_REMOVE)
+		Fail("stop: the action of the last event was not kept");
+}
+
+int main()
+{
+	TestBeforeStart();
+	TestRunning("interval 0", std::chrono::milliseconds(0));
+	TestRunning("interval 5 ms", std::chrono::milliseconds(5));
+	TestStop();
+
+	if (failures != 0)
+	{
+		std::cout << "ConflatingListenerTest: " << failures << " failures" << std::endl;
+		return 1;
+	}
+	std::cout << "ConflatingListenerTest: last value of each key delivered, counters add up" << std::endl;
+	return 0;
+}
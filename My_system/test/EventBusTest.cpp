@@ -0,0 +1,216 @@
+// EventBusTest
+// stress of the MPSC queue and of the event bus on it: items from one and from several
+// producers through a small ring are popped once each and in order per producer, by Pop
+// and by PopBatch, which return nothing only once the queue is closed and empty, and the
+// items left in a queue are destroyed with it; every message published to the bus by
+// several connectors reaches the service in order per connector, after Drain and when
+// stopped without draining, and the counters agree
+
+#include "EventBus.hpp"
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// a message of a producer, seq counts its messages
+struct Item
+{
+	int producer;
+	long seq;
+};
+
+const long ITEMS = 200000;
+
+int failures = 0;
+
+// Report a failed check
+void Fail(const std::string& what)
+{
+	if (++failures <= 10)
+		std::cout << what << std::endl;
+}
+
+// checks that the items of each producer come in order, once each
+class OrderCheck
+{
+private:
+	std::vector<long> next; // next seq expected from each producer
+
+public:
+	long received = 0;
+	long outOfOrder = 0;
+
+	OrderCheck(int producers) : next(producers, 0) {}
+
+	void Take(const Item& item)
+	{
+		if (item.seq != next[item.producer])
+			outOfOrder++;
+		next[item.producer] = item.seq + 1;
+		received++;
+	}
+
+	// Check that every item of every producer came in order
+	void Expect(const std::string& name, int producers) const
+	{
+		if (received != ITEMS * producers)
+			Fail(name + ": " + std::to_string(received) + " of " + std::to_string(ITEMS * producers) + " items received");
+		if (outOfOrder != 0)
+			Fail(name + ": " + std::to_string(outOfOrder) + " items out of order");
+	}
+};
+
+// the service behind the bus, records the messages dispatched to it
+class RecordingService : public Service<string, Item>
+{
+private:
+	vector< ServiceListener<Item>* > listeners;
+
+public:
+	OrderCheck check;
+	long batches = 0;
+
+	RecordingService(int producers) : check(producers) {}
+
+	virtual Item& GetData(string) { throw std::out_of_range("no data is kept"); }
+	virtual void OnMessage(Item &data) { check.Take(data); }
+	virtual void OnMessageBatch(Item *data, std::size_t count)
+	{
+		batches++;
+		for (std::size_t i = 0; i < count; i++)
+			OnMessage(data[i]);
+	}
+	virtual void AddListener(ServiceListener<Item> *listener) { listeners.push_back(listener); }
+	virtual const vector< ServiceListener<Item>* >& GetListeners() const { return listeners; }
+};
+
+// Push from producers through a small queue while the consumer pops, one by one or in batches
+void TestMpscQueue(const std::string& name, int producers, bool batched)
+{
+	MpscQueue<Item> queue(64);
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; p++)
+		threads.emplace_back([&queue, p]() {
+			for (long seq = 0; seq < ITEMS; seq++)
+				queue.Push(Item{ p, seq });
+		});
+	std::thread closer([&threads, &queue]() {
+		for (auto& thread : threads)
+			thread.join();
+		queue.Close();
+	});
+
+	OrderCheck check(producers);
+	if (batched)
+	{
+		std::vector<Item> batch;
+		while (queue.PopBatch(batch, 16) > 0)
+		{
+			for (const Item& item : batch)
+				check.Take(item);
+			batch.clear();
+		}
+		if (queue.PopBatch(batch, 16) != 0)
+			Fail(name + ": PopBatch after the queue closed and emptied gives items");
+	}
+	else
+	{
+		Item item{ -1, -1 };
+		while (queue.Pop(item))
+			check.Take(item);
+		if (queue.Pop(item))
+			Fail(name + ": Pop after the queue closed and emptied gives an item");
+	}
+	closer.join();
+	check.Expect(name, producers);
+	if (queue.Size() != 0)
+		Fail(name + ": " + std::to_string(queue.Size()) + " items left");
+}
+
+// A full ring refuses a push, the items left are destroyed with the queue
+void TestMpscFull()
+{
+	std::shared_ptr<int> shared = std::make_shared<int>(0);
+	{
+		MpscQueue<std::shared_ptr<int>> queue(4);
+		for (int i = 0; i < 4; i++)
+			if (!queue.TryPush(shared))
+				Fail("mpsc full: a push into a free slot failed");
+		if (queue.TryPush(shared))
+			Fail("mpsc full: a push into a full queue succeeded");
+
+		std::shared_ptr<int> item;
+		if (!queue.TryPop(item) || item != shared)
+			Fail("mpsc full: the first item is not popped");
+		item.reset();
+		if (shared.use_count() != 4)
+			Fail("mpsc full: " + std::to_string(shared.use_count() - 1) + " copies held, expected 3");
+	}
+	if (shared.use_count() != 1)
+		Fail("mpsc full: the items left were not destroyed with the queue");
+}
+
+// Connectors publish to the bus, by message and in batches, then the bus is drained or stopped
+void TestEventBus(const std::string& name, int producers, bool drain)
+{
+	RecordingService service(producers);
+	EventBus<Item> bus(&service, 64, 16);
+	bus.Start();
+
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; p++)
+		threads.emplace_back([&bus, p]() {
+			// runs of 8 messages, every other run as one batch
+			std::vector<Item> run;
+			for (long seq = 0; seq < ITEMS; seq += 8)
+			{
+				run.clear();
+				for (long i = seq; i < seq + 8 && i < ITEMS; i++)
+					run.push_back(Item{ p, i });
+				if ((seq / 8) % 2 == 0)
+					bus.OnMessageBatch(run.data(), run.size());
+				else
+					for (Item& item : run)
+						bus.OnMessage(item);
+			}
+		});
+	for (auto& thread : threads)
+		thread.join();
+
+	// Stop closes the queue, the dispatcher still hands over what is in it
+	if (drain)
+		bus.Drain();
+	else
+		bus.Stop();
+
+	service.check.Expect(name, producers);
+	if (bus.GetPublishedCount() != ITEMS * producers || bus.GetDispatchedCount() != bus.GetPublishedCount())
+		Fail(name + ": published " + std::to_string(bus.GetPublishedCount()) + ", dispatched " + std::to_string(bus.GetDispatchedCount()));
+	if (bus.GetBatchCount() != service.batches)
+		Fail(name + ": " + std::to_string(bus.GetBatchCount()) + " batches counted, the service got " + std::to_string(service.batches));
+
+	// the depth is taken with the batch just popped, so up to a batch over the capacity
+	if (bus.GetMaxDepth() == 0 || bus.GetMaxDepth() > 64 + 16)
+		Fail(name + ": max depth " + std::to_string(bus.GetMaxDepth()));
+	bus.Stop();
+}
+
+int main()
+{
+	TestMpscQueue("mpsc, 1 producer", 1, false);
+	TestMpscQueue("mpsc, 4 producers", 4, false);
+	TestMpscQueue("mpsc, 4 producers, batches", 4, true);
+	TestMpscFull();
+	TestEventBus("bus, 1 connector, drained", 1, true);
+	TestEventBus("bus, 4 connectors, drained", 4, true);
+	TestEventBus("bus, 4 connectors, stopped", 4, false);
+
+	if (failures != 0)
+	{
+		std::cout << "EventBusTest: " << failures << " failures" << std::endl;
+		return 1;
+	}
+	std::cout << "EventBusTest: " << ITEMS << " items per producer in order through 64 slots" << std::endl;
+	return 0;
+}
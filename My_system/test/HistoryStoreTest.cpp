@@ -0,0 +1,137 @@
+// HistoryStoreTest
+// time range and last-n queries of the history store match a plain scan of the values
+// appended, for every range over small chunks (ranges starting and ending on chunk
+// boundaries, runs of equal times across a boundary, times appended out of order), and
+// once the oldest chunks are dropped; a store built with the default limit stops growing
+
+#include "HistoryStore.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+int failures = 0;
+
+// Report a failed check
+void Fail(const std::string& what)
+{
+	if (++failures <= 10)
+		std::cout << what << std::endl;
+}
+
+// Get a time, seconds after a fixed start
+RecordTime At(long second)
+{
+	return RecordTime(std::chrono::duration_cast<RecordTime::duration>(std::chrono::seconds(1543600000 + second)));
+}
+
+// Get the values of a plain list with from <= time <= to
+std::vector<int> Scan(const std::vector< TimedValue<int> >& all, RecordTime from, RecordTime to)
+{
+	std::vector<int> values;
+	for (const TimedValue<int>& entry : all)
+		if (!(entry.time < from) && !(to < entry.time))
+			values.push_back(entry.value);
+	return values;
+}
+
+// Get the values of a query result
+std::vector<int> Values(const std::vector< TimedValue<int> >& entries)
+{
+	std::vector<int> values;
+	for (const TimedValue<int>& entry : entries)
+		values.push_back(entry.value);
+	return values;
+}
+
+// Check every range between first and last seconds, and every last n, against the values kept
+void ExpectQueries(const std::string& name, const HistoryStore<int>& store, const std::string& key,
+	const std::vector< TimedValue<int> >& kept, long first, long last)
+{
+	if (store.GetCount(key) != kept.size())
+		Fail(name + ": " + std::to_string(store.GetCount(key)) + " values kept, expected " + std::to_string(kept.size()));
+
+	for (long from = first; from <= last; from++)
+		for (long to = from - 1; to <= last; to++)
+			if (Values(store.GetRange(key, At(from), At(to))) != Scan(kept, At(from), At(to)))
+				Fail(name + ": range [" + std::to_string(from) + ", " + std::to_string(to) + "] does not match");
+
+	for (std::size_t n = 0; n <= kept.size() + 2; n++)
+	{
+		std::vector< TimedValue<int> > expected(kept.end() - std::min(n, kept.size()), kept.end());
+		if (Values(store.GetLast(key, n)) != Values(expected))
+			Fail(name + ": last " + std::to_string(n) + " does not match");
+	}
+}
+
+// Ranges and last n over chunks of 4, nothing dropped
+void TestChunks()
+{
+	HistoryStore<int> store(0, 4);
+	std::vector< TimedValue<int> > a, b;
+	for (int i = 0; i < 50; i++)
+	{
+		// A: one value a second; B: runs of 3 equal times, so runs cross the chunk boundaries
+		store.Append("A", At(i), i);
+		a.push_back(TimedValue<int>{ At(i), i });
+		store.Append("B", At(i / 3), i);
+		b.push_back(TimedValue<int>{ At(i / 3), i });
+	}
+	ExpectQueries("chunks", store, "A", a, -2, 52);
+	ExpectQueries("equal times", store, "B", b, -2, 18);
+
+	// a time earlier than the last one is kept at the last time
+	store.Append("A", At(10), 50);
+	a.push_back(TimedValue<int>{ At(49), 50 });
+	ExpectQueries("out of order", store, "A", a, 45, 52);
+
+	if (!store.GetRange("C", At(0), At(100)).empty() || !store.GetLast("C", 5).empty() || store.GetCount("C") != 0)
+		Fail("unknown key: values returned");
+}
+
+// The oldest chunks are dropped beyond the limit, the queries see the values kept
+void TestEviction()
+{
+	HistoryStore<int> store(10, 4);
+	std::vector< TimedValue<int> > all;
+	for (int i = 0; i < 100; i++)
+	{
+		store.Append("A", At(i), i);
+		all.push_back(TimedValue<int>{ At(i), i });
+	}
+
+	// whole chunks are dropped, at least the limit and less than two more chunks stay
+	std::size_t count = store.GetCount("A");
+	if (count < 10 || count >= 10 + 2 * 4 || count % 4 != 0)
+		Fail("eviction: " + std::to_string(count) + " values kept");
+	std::vector< TimedValue<int> > kept(all.end() - std::min(count, all.size()), all.end());
+	ExpectQueries("eviction", store, "A", kept, 0, 101);
+}
+
+// The default limit bounds the values kept for a key
+void TestDefaultLimit()
+{
+	HistoryStore<int> store;
+	for (int i = 0; i < 3 * static_cast<int>(HISTORY_LIMIT); i++)
+		store.Append("A", At(i), i);
+	std::size_t count = store.GetCount("A");
+	if (count < HISTORY_LIMIT || count >= HISTORY_LIMIT + 2 * 4096)
+		Fail("default limit: " + std::to_string(count) + " values kept");
+	std::vector< TimedValue<int> > last = store.GetLast("A", 1);
+	if (last.size() != 1 || last[0].value != 3 * static_cast<int>(HISTORY_LIMIT) - 1)
+		Fail("default limit: the last value is not kept");
+}
+
+int main()
+{
+	TestChunks();
+	TestEviction();
+	TestDefaultLimit();
+
+	if (failures != 0)
+	{
+		std::cout << "HistoryStoreTest: " << failures << " failures" << std::endl;
+		return 1;
+	}
+	std::cout << "HistoryStoreTest: ranges and last values match across chunks and after eviction" << std::endl;
+	return 0;
+}
@@ -0,0 +1,84 @@
+// PV01EngineTest
+// the PV01Engine of the risk service agrees with its bucketed risk when products are in
+// several buckets (and twice in one): after a set of trades, the engine pv01 of every bucket
+// matches pv01 * quantity of GetBucketedRisk, and the portfolio pv01 matches the sum over
+// the products
+
+#include "BondPosition.hpp"
+#include "BondRisk.hpp"
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int failures = 0;
+
+// Check that two values agree to a relative 1e-12
+void ExpectClose(const std::string& name, double expected, double actual)
+{
+	if (std::abs(expected - actual) > 1e-12 * std::max(1.0, std::abs(expected)))
+	{
+		failures++;
+		std::cout << name << ": " << actual << ", expected " << expected << std::endl;
+	}
+}
+
+int main()
+{
+	BondProductService bondProductService;
+	std::vector<Bond> bonds;
+	for (int i = 0; i < 6; i++)
+		bonds.push_back(Bond("912828" + std::to_string(100 + i), CUSIP, "T", 2.0f + i, boost::gregorian::date(2020 + i, boost::gregorian::Nov, 30)));
+	for (Bond& bond : bonds)
+		bondProductService.Add(bond);
+
+	std::unordered_map<string, double> pv01s;
+	for (int i = 0; i < 6; i++)
+		pv01s[bonds[i].GetProductId()] = 0.01 * (i + 1);
+	BondRiskService bondRiskService(&bondProductService, pv01s);
+
+	// bond 2 is in two buckets, bond 3 in two buckets and twice in the last one
+	std::vector<BucketedSector<Bond>> sectors{
+		BucketedSector<Bond>({ bonds[0], bonds[1], bonds[2] }, "Front"),
+		BucketedSector<Bond>({ bonds[2], bonds[3] }, "Belly"),
+		BucketedSector<Bond>({ bonds[3], bonds[3], bonds[4], bonds[5] }, "Long") };
+	std::vector<std::size_t> ids;
+	for (const BucketedSector<Bond>& sector : sectors)
+		ids.push_back(bondRiskService.AddBucket(sector));
+
+	BondPositionService bondPositionService(&bondProductService, "T");
+	BondRiskListener positiontoRiskListener(&bondRiskService);
+	bondPositionService.AddListener(&positiontoRiskListener);
+	const string books[] = { "TRSY1", "TRSY2", "TRSY3" };
+	for (int i = 0; i < 60; i++)
+	{
+		BondTrade trade(bondProductService.GetHandle(bonds[i % 6].GetProductId()), "T" + std::to_string(i), 99.5,
+			books[i % 3], 1000000 * (1 + i % 7), (i % 4 == 0) ? SELL : BUY);
+		bondPositionService.AddTrade(trade);
+	}
+
+	const PV01Engine& engine = bondRiskService.GetEngine();
+	std::vector<double> bucketPv01s(ids.size());
+	engine.GetBucketPV01s(bucketPv01s.data(), bucketPv01s.size());
+	for (std::size_t i = 0; i < ids.size(); i++)
+	{
+		const PV01<BucketedSector<Bond>>& risk = bondRiskService.UpdateBucketedRisk(ids[i]);
+		ExpectClose("bucket " + sectors[i].GetName(), risk.GetPV01() * risk.GetQuantity(), bucketPv01s[ids[i]]);
+	}
+
+	double portfolio = 0.0;
+	for (const Bond& bond : bonds)
+	{
+		const BondPV01& pv01 = bondRiskService.GetData(bond.GetProductId());
+		portfolio += pv01.GetPV01() * pv01.GetQuantity();
+	}
+	ExpectClose("portfolio", portfolio, engine.GetPortfolioPV01());
+
+	if (failures != 0)
+	{
+		std::cout << "PV01EngineTest: " << failures << " failures" << std::endl;
+		return 1;
+	}
+	std::cout << "PV01EngineTest: " << ids.size() << " overlapping buckets match the bucketed risk" << std::endl;
+	return 0;
+}
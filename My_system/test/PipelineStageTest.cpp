@@ -0,0 +1,193 @@
+// PipelineStageTest
+// stress of the SPSC queue and of the pipeline stage on it: every item pushed is popped
+// once and in order through a small ring that is full most of the time, Pop returns false
+// only once the queue is closed and empty; the stage hands every event to its listener in
+// the order pushed with its action, from one producer and, with MultiProducer, from
+// several (in order per producer), after Drain and when stopped without draining
+
+#include "PipelineStage.hpp"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// an item of a producer, seq counts its items
+struct Item
+{
+	int producer;
+	long seq;
+};
+
+const long ITEMS = 200000;
+
+int failures = 0;
+
+// Report a failed check
+void Fail(const std::string& what)
+{
+	if (++failures <= 10)
+		std::cout << what << std::endl;
+}
+
+// records the events the stage hands over, called from its worker only
+class RecordingListener final : public ServiceListener<Item>
+{
+private:
+	std::vector<long> next; // next seq expected from each producer
+
+	void Record(StageAction action, const Item &data)
+	{
+		if (data.producer >= static_cast<int>(next.size()))
+			next.resize(data.producer + 1, 0);
+		if (data.seq != next[data.producer])
+			outOfOrder++;
+		next[data.producer] = data.seq + 1;
+
+		// the producers push add, update and remove in turn
+		if (action != static_cast<StageAction>(data.seq % 3))
+			wrongAction++;
+		received++;
+	}
+
+public:
+	long received = 0;
+	long outOfOrder = 0;
+	long wrongAction = 0;
+
+	using ServiceListener<Item>::ProcessAdd;
+	using ServiceListener<Item>::ProcessRemove;
+	using ServiceListener<Item>::ProcessUpdate;
+
+	virtual void ProcessAdd(Item &data) { Record(STAGE_ADD, data); }
+	virtual void ProcessRemove(Item &data) { Record(STAGE_REMOVE, data); }
+	virtual void ProcessUpdate(Item &data) { Record(STAGE_UPDATE, data); }
+};
+
+// Push items one by one through a small queue while the consumer pops them
+void TestSpscQueue()
+{
+	SpscQueue<Item> queue(64);
+	std::thread producer([&queue]() {
+		for (long seq = 0; seq < ITEMS; seq++)
+			queue.Push(Item{ 0, seq });
+		queue.Close();
+	});
+
+	Item item{ -1, -1 };
+	long expected = 0;
+	while (queue.Pop(item))
+	{
+		if (item.seq != expected)
+		{
+			Fail("spsc: popped " + std::to_string(item.seq) + ", expected " + std::to_string(expected));
+			break;
+		}
+		expected++;
+	}
+	producer.join();
+	if (expected != ITEMS)
+		Fail("spsc: " + std::to_string(expected) + " of " + std::to_string(ITEMS) + " items popped");
+	if (queue.Pop(item) || queue.Size() != 0)
+		Fail("spsc: Pop after the queue closed and emptied gives an item");
+
+	// a full ring refuses a push, the items come back in order
+	SpscQueue<Item> small(4);
+	for (long seq = 0; seq < 4; seq++)
+		if (!small.TryPush(Item{ 0, seq }))
+			Fail("spsc: a push into a free slot failed");
+	if (small.TryPush(Item{ 0, 4 }))
+		Fail("spsc: a push into a full queue succeeded");
+	for (long seq = 0; seq < 4; seq++)
+		if (!small.TryPop(item) || item.seq != seq)
+			Fail("spsc: item " + std::to_string(seq) + " not popped in order");
+	if (small.TryPop(item))
+		Fail("spsc: an empty queue gave an item");
+}
+
+// Push a producer's items through the stage, in turn as add, update and remove, through
+// every callback (copied, read-only, moved, in batches)
+template<typename Stage>
+void Produce(Stage& stage, int producer)
+{
+	std::vector<Item> batch;
+	for (long seq = 0; seq < ITEMS; seq++)
+	{
+		Item item{ producer, seq };
+		StageAction action = static_cast<StageAction>(seq % 3);
+		if (action == STAGE_ADD && seq % 5 == 0)
+		{
+			batch.push_back(item); // one add batched
+			stage.ProcessBatch(batch.data(), batch.size());
+			batch.clear();
+		}
+		else if (action == STAGE_ADD)
+			stage.ProcessAdd(static_cast<const Item&>(item));
+		else if (action == STAGE_UPDATE)
+			stage.ProcessUpdate(std::move(item));
+		else
+			stage.ProcessRemove(item);
+	}
+}
+
+// Check that the listener got every item of every producer
+void ExpectReceived(const std::string& name, const RecordingListener& listener, int producers)
+{
+	if (listener.received != ITEMS * producers)
+		Fail(name + ": " + std::to_string(listener.received) + " of " + std::to_string(ITEMS * producers) + " events received");
+	if (listener.outOfOrder != 0)
+		Fail(name + ": " + std::to_string(listener.outOfOrder) + " events out of order");
+	if (listener.wrongAction != 0)
+		Fail(name + ": " + std::to_string(listener.wrongAction) + " events with the wrong action");
+}
+
+// One producer, drained while the worker runs, then stopped
+void TestSingleProducer()
+{
+	RecordingListener listener;
+	PipelineStage<Item, RecordingListener> stage(&listener, 64);
+	stage.Start();
+	Produce(stage, 0);
+	stage.Drain();
+	ExpectReceived("single producer", listener, 1);
+	stage.Stop();
+	stage.Stop(); // a second stop does nothing
+}
+
+// Several producers on the MPSC queue, drained, or stopped without draining
+void TestMultiProducer(const std::string& name, bool drain)
+{
+	const int producers = 4;
+	RecordingListener listener;
+	PipelineStage<Item, RecordingListener, true> stage(&listener, 64);
+	stage.Start();
+
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; p++)
+		threads.emplace_back([&stage, p]() { Produce(stage, p); });
+	for (auto& thread : threads)
+		thread.join();
+
+	// Stop closes the queue, the worker still hands over what is in it
+	if (drain)
+		stage.Drain();
+	else
+		stage.Stop();
+	ExpectReceived(name, listener, producers);
+	stage.Stop();
+}
+
+int main()
+{
+	TestSpscQueue();
+	TestSingleProducer();
+	TestMultiProducer("multi producer, drained", true);
+	TestMultiProducer("multi producer, stopped", false);
+
+	if (failures != 0)
+	{
+		std::cout << "PipelineStageTest: " << failures << " failures" << std::endl;
+		return 1;
+	}
+	std::cout << "PipelineStageTest: " << ITEMS << " items per producer in order through 64 slots" << std::endl;
+	return 0;
+}
@@ -0,0 +1,62 @@
+// PriceCodecTest
+// round trip of every tick of 1/256 between 99 and 101 through the price codec: the
+// formatted text matches a reference built digit by digit, parsing it gives back the
+// tick, and the double price path (FormatPrice / ParsePrice) gives back the price exactly
+
+#include "PriceCodec.hpp"
+#include <iostream>
+#include <string>
+#include <string_view>
+
+int failures = 0;
+
+// Report a failed check
+void Fail(long ticks, const std::string& what)
+{
+	if (++failures <= 10)
+		std::cout << "tick " << ticks << ": " << what << std::endl;
+}
+
+// Reference text of a tick count: whole-32nds then the 256ths digit, '+' for a half 32nd
+std::string ReferenceText(long ticks)
+{
+	long whole = ticks / TICKS_PER_POINT;
+	long x = (ticks % TICKS_PER_POINT) / 8;
+	long z = ticks % 8;
+	return std::to_string(whole) + "-" + (x < 10 ? "0" : "") + std::to_string(x) + (z == 4 ? "+" : std::to_string(z));
+}
+
+int main()
+{
+	long checked = 0;
+	char buf[PRICE_BUFFER_SIZE];
+	for (long ticks = 99 * TICKS_PER_POINT; ticks <= 101 * TICKS_PER_POINT; ticks++, checked++)
+	{
+		int length = FormatTicks(ticks, buf);
+		std::string_view text(buf, length);
+		std::string reference = ReferenceText(ticks);
+		if (text != reference)
+			Fail(ticks, "formatted " + std::string(text) + ", expected " + reference);
+
+		if (ParseTicks(text.data(), text.data() + text.size()) != ticks)
+			Fail(ticks, "parsing " + std::string(text) + " does not give the tick back");
+
+		double price = TickstoPrice(ticks);
+		length = FormatPrice(price, buf);
+		if (ParsePrice(std::string_view(buf, length)) != price)
+			Fail(ticks, "price " + std::to_string(price) + " does not round trip");
+	}
+
+	// the decimal notation is rounded to the nearest tick
+	const char decimal[] = "99.5";
+	if (ParseTicks(decimal, decimal + 4) != 99 * TICKS_PER_POINT + 128)
+		Fail(99 * TICKS_PER_POINT + 128, "decimal 99.5 is not parsed");
+
+	if (failures != 0)
+	{
+		std::cout << "PriceCodecTest: " << failures << " failures in " << checked << " ticks" << std::endl;
+		return 1;
+	}
+	std::cout << "PriceCodecTest: " << checked << " ticks round trip" << std::endl;
+	return 0;
+}
@@ -0,0 +1,110 @@
+// ShardTest
+// 200k trades over 1000 bonds give the same book positions with 4 shards running on their
+// own threads as with one shard applying them inline, and every trade reaches a thread-safe
+// listener; a listener not added as thread-safe keeps the shards from running in parallel
+
+#include "BondPosition.hpp"
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// counts the position updates, may be called from several shards at once
+class CountingListener final : public ServiceListener<BondPos>
+{
+public:
+	std::atomic<long> updates{ 0 };
+
+	using ServiceListener<BondPos>::ProcessAdd;
+	using ServiceListener<BondPos>::ProcessRemove;
+	using ServiceListener<BondPos>::ProcessUpdate;
+
+	virtual void ProcessAdd(BondPos &) {}
+	virtual void ProcessRemove(BondPos &) {}
+	virtual void ProcessUpdate(BondPos &data) { ProcessUpdate(static_cast<const BondPos&>(data)); }
+	virtual void ProcessUpdate(const BondPos &) { updates.fetch_add(1, std::memory_order_relaxed); }
+};
+
+int failures = 0;
+
+// Report a failed check
+void Fail(const std::string& what)
+{
+	if (++failures <= 10)
+		std::cout << what << std::endl;
+}
+
+// Check that two services hold the same book positions for every bond
+void ExpectSamePositions(const std::string& name, BondPositionService& expected, BondPositionService& actual, const std::vector<Bond>& bonds)
+{
+	for (const Bond& bond : bonds)
+	{
+		const string& id = bond.GetProductId();
+		if (actual.GetData(id).GetPositions() != expected.GetData(id).GetPositions())
+			Fail(name + ": the positions of " + id + " differ from one shard");
+	}
+}
+
+int main()
+{
+	const int bondCount = 1000;
+	const long tradeCount = 200000;
+	const string books[] = { "TRSY1", "TRSY2", "TRSY3" };
+
+	BondProductService bondProductService;
+	std::vector<Bond> bonds;
+	for (int i = 0; i < bondCount; i++)
+		bonds.push_back(Bond("B" + std::to_string(100000 + i), CUSIP, "T", 2.0f + (i % 40) / 8.0f, boost::gregorian::date(2020 + i % 30, boost::gregorian::Nov, 30)));
+	for (Bond& bond : bonds)
+		bondProductService.Add(bond);
+
+	std::mt19937 random(7);
+	std::uniform_int_distribution<int> product(0, bondCount - 1);
+	std::uniform_int_distribution<long> size(1, 9);
+	std::vector<BondTrade> trades;
+	trades.reserve(tradeCount);
+	for (long i = 0; i < tradeCount; i++)
+	{
+		const Bond& bond = bonds[product(random)];
+		trades.push_back(BondTrade(bondProductService.GetHandle(bond.GetProductId()), "T" + std::to_string(i), 99.5,
+			books[i % 3], size(random) * 1000000, (random() % 2 == 0) ? BUY : SELL));
+	}
+
+	// one shard, trades applied inline
+	BondPositionService inlineService(&bondProductService, "T");
+	for (const BondTrade& trade : trades)
+		inlineService.AddTrade(trade);
+
+	// 4 shards on their own threads
+	BondPositionService shardedService(&bondProductService, "T", 4);
+	CountingListener listener;
+	shardedService.AddListener(&listener, true);
+	if (!shardedService.Start())
+		Fail("4 shards with a thread-safe listener do not start");
+	for (const BondTrade& trade : trades)
+		shardedService.AddTrade(trade);
+	shardedService.Drain();
+	shardedService.Stop();
+	ExpectSamePositions("4 shards", inlineService, shardedService, bonds);
+	if (listener.updates.load() != tradeCount)
+		Fail("the listener got " + std::to_string(listener.updates.load()) + " updates for " + std::to_string(tradeCount) + " trades");
+
+	// a listener that is not thread-safe: the shards must not start, trades are applied inline
+	BondPositionService guardedService(&bondProductService, "T", 4);
+	CountingListener unsafeListener;
+	guardedService.AddListener(&unsafeListener);
+	if (guardedService.Start())
+		Fail("4 shards start with a listener that is not thread-safe");
+	for (const BondTrade& trade : trades)
+		guardedService.AddTrade(trade);
+	ExpectSamePositions("guarded 4 shards", inlineService, guardedService, bonds);
+
+	if (failures != 0)
+	{
+		std::cout << "ShardTest: " << failures << " failures" << std::endl;
+		return 1;
+	}
+	std::cout << "ShardTest: " << tradeCount << " trades over " << bondCount << " bonds, 4 shards match one" << std::endl;
+	return 0;
+}
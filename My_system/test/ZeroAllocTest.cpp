@@ -0,0 +1,127 @@
+// ZeroAllocTest
+// steady state of the hot paths does not allocate: once every product and book was seen
+// once, a price through pricing, algo streaming and streaming, and a trade through trade
+// booking, position and risk, make no heap allocation; the services hand read-only views
+// to the listeners and a listener must take them without copying
+// this holds for products interned by the product service, as the connectors carry them; an
+// event built from a product reference instead allocates a private copy of the product
+
+#include "BondPricing.hpp"
+#include "BondAlgoStreaming.hpp"
+#include "BondStreaming.hpp"
+#include "BondTradeBooking.hpp"
+#include "BondPosition.hpp"
+#include "BondRisk.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+long allocations = 0; // the tests run on one thread
+
+void* operator new(std::size_t size)
+{
+	++allocations;
+	if (void* p = std::malloc(size == 0 ? 1 : size))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+int failures = 0;
+
+// Check that rounds calls of f allocate nothing, after one call to warm up
+template<typename F>
+void ExpectNoAllocation(const std::string& name, long rounds, F f)
+{
+	f(0);
+	long before = allocations;
+	for (long i = 1; i <= rounds; i++)
+		f(i);
+	long count = allocations - before;
+	if (count != 0)
+	{
+		failures++;
+		std::cout << name << ": " << count << " allocations in " << rounds << " rounds" << std::endl;
+	}
+}
+
+int main()
+{
+	const long rounds = 10000;
+	BondProductService bondProductService;
+	std::vector<Bond> bonds;
+	for (int i = 0; i < 6; i++)
+		bonds.push_back(Bond("912828" + std::to_string(100 + i), CUSIP, "T", 2.0f + i, boost::gregorian::date(2020 + i, boost::gregorian::Nov, 30)));
+	for (Bond& bond : bonds)
+		bondProductService.Add(bond);
+	std::vector<ProductHandle<Bond>> products;
+	for (const Bond& bond : bonds)
+	{
+		products.push_back(bondProductService.GetHandle(bond.GetProductId()));
+		if (!products.back().IsInterned())
+		{
+			failures++;
+			std::cout << bond.GetProductId() << " is not interned" << std::endl;
+		}
+	}
+
+	// pricing ==> algo streaming ==> streaming
+	BondPricingService bondPricingService;
+	BondAlgoStreamingService bondAlgoStreamingService;
+	BondStreamingService bondStreamingService;
+	ToBondAlgoStreamingListener pricingToAlgoStreamingListener(&bondAlgoStreamingService);
+	ToBondStreamingListener algoStreamingToStreamingListener(&bondStreamingService);
+	bondPricingService.AddListener(&pricingToAlgoStreamingListener);
+	bondAlgoStreamingService.AddListener(&algoStreamingToStreamingListener);
+
+	std::vector<BondPrice> prices;
+	for (int i = 0; i < 64; i++)
+		prices.push_back(BondPrice(products[i % 6], 99.0 + i / 256.0, 1.0 / 128));
+	ExpectNoAllocation("price ==> stream", rounds, [&](long i) {
+		if (i == 0)
+		{
+			for (BondPrice& price : prices)
+				bondPricingService.OnMessage(price);
+			return;
+		}
+		bondPricingService.OnMessage(prices[i % prices.size()]);
+	});
+
+	// trade booking ==> position ==> risk
+	std::unordered_map<string, double> pv01s;
+	for (const Bond& bond : bonds)
+		pv01s[bond.GetProductId()] = 0.01;
+	BondTradeBookingService bondTradeBookingService;
+	BondPositionService bondPositionService(&bondProductService, "T");
+	BondRiskService bondRiskService(&bondProductService, pv01s);
+	ToBondPositionListener tradeBookingtoPositionListener(&bondPositionService);
+	BondRiskListener positiontoRiskListener(&bondRiskService);
+	bondTradeBookingService.AddListener(&tradeBookingtoPositionListener);
+	bondPositionService.AddListener(&positiontoRiskListener);
+
+	const string books[] = { "TRSY1", "TRSY2", "TRSY3" };
+	std::vector<BondTrade> trades;
+	for (int i = 0; i < 64; i++)
+		trades.push_back(BondTrade(products[i % 6], "T" + std::to_string(i % 18), 99.5, books[i % 3], 1000000 * (1 + i % 5), (i % 2 == 0) ? BUY : SELL));
+	ExpectNoAllocation("trade ==> position ==> risk", rounds, [&](long i) {
+		if (i == 0)
+		{
+			for (BondTrade& trade : trades)
+				bondTradeBookingService.OnMessage(trade);
+			return;
+		}
+		bondTradeBookingService.OnMessage(trades[i % trades.size()]);
+	});
+
+	if (failures != 0)
+	{
+		std::cout << "ZeroAllocTest: " << failures << " paths allocate in steady state" << std::endl;
+		return 1;
+	}
+	std::cout << "ZeroAllocTest: no allocation in " << rounds << " events per path" << std::endl;
+	return 0;
+}
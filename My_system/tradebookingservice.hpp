@@ -10,6 +10,8 @@
 #include <string>
 #include <vector>
 #include "soa.hpp"
+#include "products.hpp"
+#include "ProductHandle.hpp"
 
 // Trade sides
 enum Side { BUY, SELL };
@@ -25,11 +27,15 @@ class Trade
 public:
 
   // ctor for a trade
+  Trade(const ProductHandle<T> &_product, string _tradeId, double _price, string _book, long _quantity, Side _side);
   Trade(const T &_product, string _tradeId, double _price, string _book, long _quantity, Side _side);
 
   // Get the product
   const T& GetProduct() const;
 
+  // Get the interned product handle
+  const ProductHandle<T>& GetProductHandle() const;
+
   // Get the trade ID
   const string& GetTradeId() const;
 
@@ -46,7 +52,7 @@ public:
   Side GetSide() const;
 
 private:
-  T product;
+  ProductHandle<T> product;
   string tradeId;
   double price;
   string book;
@@ -67,12 +73,12 @@ class TradeBookingService : public Service<string,Trade <T> >
 public:
 
   // Book the trade
-  void BookTrade(const Trade<T> &trade) = 0;
+  virtual void BookTrade(const Trade<T> &trade) = 0;
 
 };
 
 template<typename T>
-Trade<T>::Trade(const T &_product, string _tradeId, double _price, string _book, long _quantity, Side _side) :
+Trade<T>::Trade(const ProductHandle<T> &_product, string _tradeId, double _price, string _book, long _quantity, Side _side) :
   product(_product)
 {
   tradeId = _tradeId;
@@ -82,8 +88,20 @@ Trade<T>::Trade(const T &_product, string _tradeId, double _price, string _book,
   side = _side;
 }
 
+template<typename T>
+Trade<T>::Trade(const T &_product, string _tradeId, double _price, string _book, long _quantity, Side _side) :
+  Trade(ProductHandle<T>(_product), _tradeId, _price, _book, _quantity, _side)
+{
+}
+
 template<typename T>
 const T& Trade<T>::GetProduct() const
+{
+  return *product;
+}
+
+template<typename T>
+const ProductHandle<T>& Trade<T>::GetProductHandle() const
 {
   return product;
 }
@@ -118,9 +136,7 @@ Side Trade<T>::GetSide() const
   return side;
 }
 
-template<typename T>
-void TradeBookingService<T>::BookTrade(const Trade<T> &trade)
-{
-}
+// bond trades
+typedef Trade<Bond> BondTrade;
 
 #endif